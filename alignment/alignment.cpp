@@ -92,6 +92,9 @@ void cmaple::Alignment::read(std::istream& aln_stream,
     // sort sequences by their distances to the reference sequence
     sortSeqsByDistances();
 
+    // group identical sequences
+    groupIdenticalSeqs();
+
     // avoid using DNA build for protein data
     if (NUM_STATES < num_states) {
       throw std::invalid_argument(
@@ -215,6 +218,7 @@ auto cmaple::operator>>(std::istream& in_stream,
 void cmaple::Alignment::reset() {
   setSeqType(cmaple::SeqRegion::SEQ_AUTO);
   data.clear();
+  representative_seqs.clear();
   ref_seq.clear();
   aln_format = IN_AUTO;
   attached_trees.clear();
@@ -861,76 +865,7 @@ void cmaple::Alignment::readMaple(std::istream& aln_stream) {
     }
     // Read a Mutation
     else {
-      // validate the input
-      char separator = '\t';
-      long num_items = std::count(line.begin(), line.end(), separator) + 1;
-      if (num_items < 2 || num_items > 3) {
-        throw std::logic_error(
-            "Invalid input. Each difference must be presented be <Type>    "
-            "<Position>  [<Length>]. Please check and try again!");
-      }
-
-      // extract mutation info
-      stringstream ssin(line);
-      string tmp;
-
-      // extract <Type>
-      ssin >> tmp;
-      StateType state;
-      try
-      {
-        state = convertChar2State(toupper(tmp[0]));
-      }
-      catch(std::invalid_argument& e)
-      {
-        throw std::invalid_argument("Line " + convertIntToString(line_num + 1) + ": " + e.what());
-      }
-
-      // extract <Position>
-      ssin >> tmp;
-      PositionType pos = convert_positiontype(tmp.c_str());
-      if (pos <= 0 || pos > static_cast<PositionType>(ref_seq.size())) {
-        throw std::logic_error(
-            "<Position> must be greater than 0 and less than the reference "
-            "sequence length (" +
-            convertPosTypeToString(static_cast<PositionType>(ref_seq.size())) + ")!");
-      }
-
-      // extract <Length>
-      PositionType length = 1;
-      if (ssin.good()) {
-        ssin >> tmp;
-        if (state == TYPE_N || state == TYPE_DEL) {
-          length = convert_positiontype(tmp.c_str());
-          if (length <= 0) {
-            throw std::logic_error("<Length> must be greater than 0!");
-          }
-          if (length + pos - 1 > static_cast<PositionType>(ref_seq.size())) {
-            throw std::logic_error(
-                "<Length> + <Position> must be less than the reference "
-                "sequence length (" +
-                convertPosTypeToString(static_cast<PositionType>(ref_seq.size())) + ")!");
-          }
-          } else if (cmaple::verbose_mode >= cmaple::VB_MED) {
-            outWarning("Ignoring <Length> of " + tmp +
-                      ". <Length> is only appliable for 'N' or '-'.");
-          }
-        }
-
-      // add a new mutation into mutations
-      if (state == TYPE_N || state == TYPE_DEL) {
-        mutations.emplace_back(state, pos - 1, length);
-      } else {
-        StateType refState = ref_seq[pos - 1];
-        if(refState == state)
-        {
-          throw std::logic_error(
-                "Mutation at position " + convertPosTypeToString(pos) +
-                " in sequence " + seq_name + 
-                " is equal to reference nucleotide. Check reference and alignment are correct.");
-        }
-        mutations.emplace_back(state, pos - 1);
-      }
+      parseMapleMutation(line, line_num, seq_name, mutations);
     }
   }
 
@@ -952,6 +887,131 @@ void cmaple::Alignment::readMaple(std::istream& aln_stream) {
   resetStream(aln_stream);
 }
 
+void cmaple::Alignment::parseMapleMutation(const std::string& line,
+                                           const PositionType line_num,
+                                           const std::string& seq_name,
+                                           std::vector<Mutation>& mutations) {
+  // validate the input
+  char separator = '\t';
+  long num_items = std::count(line.begin(), line.end(), separator) + 1;
+  if (num_items < 2 || num_items > 3) {
+    throw std::logic_error(
+        "Invalid input. Each difference must be presented be <Type>    "
+        "<Position>  [<Length>]. Please check and try again!");
+  }
+
+  // extract mutation info
+  stringstream ssin(line);
+  string tmp;
+
+  // extract <Type>
+  ssin >> tmp;
+  StateType state;
+  try
+  {
+    state = convertChar2State(toupper(tmp[0]));
+  }
+  catch(std::invalid_argument& e)
+  {
+    throw std::invalid_argument("Line " + convertIntToString(line_num + 1) + ": " + e.what());
+  }
+
+  // extract <Position>
+  ssin >> tmp;
+  PositionType pos = convert_positiontype(tmp.c_str());
+  if (pos <= 0 || pos > static_cast<PositionType>(ref_seq.size())) {
+    throw std::logic_error(
+        "<Position> must be greater than 0 and less than the reference "
+        "sequence length (" +
+        convertPosTypeToString(static_cast<PositionType>(ref_seq.size())) + ")!");
+  }
+
+  // extract <Length>
+  PositionType length = 1;
+  if (ssin.good()) {
+    ssin >> tmp;
+    if (state == TYPE_N || state == TYPE_DEL) {
+      length = convert_positiontype(tmp.c_str());
+      if (length <= 0) {
+        throw std::logic_error("<Length> must be greater than 0!");
+      }
+      if (length + pos - 1 > static_cast<PositionType>(ref_seq.size())) {
+        throw std::logic_error(
+            "<Length> + <Position> must be less than the reference "
+            "sequence length (" +
+            convertPosTypeToString(static_cast<PositionType>(ref_seq.size())) + ")!");
+      }
+    } else if (cmaple::verbose_mode >= cmaple::VB_MED) {
+      outWarning("Ignoring <Length> of " + tmp +
+                 ". <Length> is only appliable for 'N' or '-'.");
+    }
+  }
+
+  // add a new mutation into mutations
+  if (state == TYPE_N || state == TYPE_DEL) {
+    mutations.emplace_back(state, pos - 1, length);
+  } else {
+    StateType refState = ref_seq[pos - 1];
+    if(refState == state)
+    {
+      throw std::logic_error(
+            "Mutation at position " + convertPosTypeToString(pos) +
+            " in sequence " + seq_name + 
+            " is equal to reference nucleotide. Check reference and alignment are correct.");
+    }
+    mutations.emplace_back(state, pos - 1);
+  }
+}
+
+auto cmaple::Alignment::readMapleSeq(std::istream& seq_stream,
+                                     Sequence& sequence,
+                                     PositionType& line_num) -> bool {
+  string seq_name;
+  vector<Mutation> mutations;
+  string line;
+
+  // seek the name of the next sequence
+  while (!seq_name.length()) {
+    if (seq_stream.eof()) {
+      return false;
+    }
+    safeGetline(seq_stream, line);
+    ++line_num;
+    if (line == "") {
+      continue;
+    }
+
+    if (line[0] != '>') {
+      throw std::logic_error("Line " + convertIntToString(line_num) +
+                             ": a sequence name (starting by '>') is "
+                             "expected. Please check and try again!");
+    }
+    string::size_type pos = line.find_first_of("\n\r");
+    seq_name = line.substr(1, pos - 1);
+    renameString(seq_name);
+    if (!seq_name.length()) {
+      throw std::logic_error("Empty sequence name found at line " +
+                             convertIntToString(line_num) +
+                             ". Please check and try again!");
+    }
+  }
+
+  // read its differences from the reference sequence until an empty line or
+  // the name of the next sequence (without consuming it), so that a sequence
+  // can be processed as soon as it is complete
+  while (!seq_stream.eof() && seq_stream.rdbuf()->sgetc() != '>') {
+    safeGetline(seq_stream, line);
+    ++line_num;
+    if (line == "") {
+      break;
+    }
+    parseMapleMutation(line, line_num, seq_name, mutations);
+  }
+
+  sequence = Sequence(std::move(seq_name), std::move(mutations));
+  return true;
+}
+
 auto cmaple::Alignment::convertState2Char(
     const cmaple::StateType& state,
     const cmaple::SeqRegion::SeqType& seqtype) -> char {
@@ -1235,6 +1295,48 @@ void cmaple::Alignment::sortSeqsByDistances() {
   delete[] sequence_indexes;
 }
 
+void cmaple::Alignment::groupIdenticalSeqs() {
+  const std::vector<cmaple::Sequence>::size_type num_seqs = data.size();
+  representative_seqs.resize(num_seqs);
+
+  // hash the mutations of each sequence, then compare sequences having the
+  // same hash value
+  std::unordered_map<size_t, std::vector<NumSeqsType>> seqs_by_hash;
+  seqs_by_hash.reserve(num_seqs);
+  for (std::vector<cmaple::Sequence>::size_type i = 0; i < num_seqs; ++i) {
+    const Sequence& sequence = data[i];
+    size_t hash_value = sequence.size();
+    for (const Mutation& mutation : sequence) {
+      const size_t mutation_hash =
+          (static_cast<size_t>(mutation.position) << 24) ^
+          (static_cast<size_t>(mutation.getLength()) << 8) ^ mutation.type;
+      hash_value ^= mutation_hash + 0x9e3779b97f4a7c15ULL + (hash_value << 6) +
+                    (hash_value >> 2);
+    }
+
+    representative_seqs[i] = static_cast<NumSeqsType>(i);
+    std::vector<NumSeqsType>& candidates = seqs_by_hash[hash_value];
+    for (const NumSeqsType candidate : candidates) {
+      const Sequence& candidate_seq = data[candidate];
+      if (std::equal(sequence.begin(), sequence.end(), candidate_seq.begin(),
+                     candidate_seq.end(),
+                     [](const Mutation& mut_1, const Mutation& mut_2) {
+                       return mut_1.type == mut_2.type &&
+                              mut_1.position == mut_2.position &&
+                              mut_1.getLength() == mut_2.getLength();
+                     })) {
+        representative_seqs[i] = candidate;
+        break;
+      }
+    }
+
+    // only representatives need to be compared with the next sequences
+    if (representative_seqs[i] == i) {
+      candidates.push_back(static_cast<NumSeqsType>(i));
+    }
+  }
+}
+
 auto cmaple::Alignment::getRefSeqStr() -> std::string {
   const std::basic_string<char>::size_type seq_length = ref_seq.size();
   std::string ref_sequence(seq_length, ' ');
@@ -191,12 +191,34 @@ class Alignment {
    */
   static InputType parseAlnFormat(const std::string& n_format);
 
+  /**
+   Read the next sequence in MAPLE format (i.e., a line ">name" followed by
+   the differences from the reference sequence) from a stream. The sequence
+   ends at an empty line or right before the name of the next sequence.
+   @param seq_stream A stream of sequences
+   @param sequence the output sequence
+   @param line_num the number of lines read so far from the stream (updated)
+   @return FALSE if no sequence was found before the end of the stream
+   @throw std::logic\_error if the sequence is in an incorrect format or
+   contains invalid states
+   */
+  auto readMapleSeq(std::istream& seq_stream,
+                    Sequence& sequence,
+                    cmaple::PositionType& line_num) -> bool;
+
   /**
    A vector stores all sequences
    */
   std::vector<Sequence>
       data;  // note: this is inefficient, but only used briefly
 
+  /**
+   For each sequence in data, the index of the first sequence (in data) that
+   is identical to it (i.e., having the same vector of mutations); or its own
+   index if no such sequence precedes it
+   */
+  std::vector<cmaple::NumSeqsType> representative_seqs;
+
   /**
    The reference sequence
    */
@@ -258,6 +280,12 @@ class Alignment {
    */
   void sortSeqsByDistances();
 
+  /**
+   Group identical sequences (i.e., sequences having the same vector of
+   mutations) by computing representative_seqs
+   */
+  void groupIdenticalSeqs();
+
   /**
    Convert a raw character state into ID, indexed from 0
    @param state input raw state
@@ -289,6 +317,21 @@ class Alignment {
    */
   void readMaple(std::istream& aln_stream);
 
+  /**
+   Parse a line presenting a difference from the reference sequence (i.e.,
+   <Type> <Position> [<Length>]) in MAPLE format
+   @param line the input line
+   @param line_num the line number (for error messages)
+   @param seq_name the name of the sequence containing the difference
+   @param mutations the vector of mutations to add the difference into
+   @throw std::logic\_error if the line is in an incorrect format
+   @throw std::invalid\_argument if the line contains an invalid state
+   */
+  void parseMapleMutation(const std::string& line,
+                          const cmaple::PositionType line_num,
+                          const std::string& seq_name,
+                          std::vector<Mutation>& mutations);
+
   /**
    Read an alignment in FASTA or PHYLIP format from a stream
    @param aln_stream A stream of an alignment file
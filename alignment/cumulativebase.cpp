@@ -0,0 +1,93 @@
+#include "cumulativebase.h"
+
+using namespace cmaple;
+
+void cmaple::CumulativeBase::build(const std::vector<StateType>& ref_seq,
+                                   const StateType num_states_,
+                                   Layout layout_) {
+  assert(num_states_ > 0);
+  length = static_cast<PositionType>(ref_seq.size());
+  num_states = num_states_;
+  const size_t num_positions = static_cast<size_t>(length) + 1;
+  if (layout_ == AUTO) {
+    layout_ = num_positions * num_states * sizeof(PositionType) >
+                      MAX_DENSE_BYTES
+                  ? BLOCKED
+                  : DENSE;
+  }
+  layout = layout_;
+
+  // count the bases of each block, then accumulate them into the counts at
+  // the start of each block
+  const PositionType num_blocks = length / BLOCK_SIZE + 1;
+  std::vector<PositionType> start_counts(
+      static_cast<size_t>(num_blocks) * num_states, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (PositionType block = 0; block < num_blocks - 1; ++block) {
+    PositionType* const block_count =
+        start_counts.data() + static_cast<size_t>(block + 1) * num_states;
+    const PositionType end = block * BLOCK_SIZE + BLOCK_SIZE;
+    for (PositionType pos = block * BLOCK_SIZE; pos < end; ++pos) {
+      assert(ref_seq[static_cast<size_t>(pos)] < num_states);
+      ++block_count[ref_seq[static_cast<size_t>(pos)]];
+    }
+  }
+  for (size_t i = num_states; i < start_counts.size(); ++i) {
+    start_counts[i] += start_counts[i - num_states];
+  }
+
+  // fill the counts of the positions of each block
+  counts.reset();
+  relative_counts.reset();
+  if (layout == DENSE) {
+    counts = allocateTable<PositionType>(num_positions * num_states);
+    block_counts.clear();
+  } else {
+    relative_counts = allocateTable<uint8_t>(num_positions * num_states);
+  }
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (PositionType block = 0; block < num_blocks; ++block) {
+    // the counts from the start of the genome (DENSE) or of the block
+    // (BLOCKED)
+    std::vector<PositionType> count(num_states, 0);
+    if (layout == DENSE) {
+      std::copy_n(start_counts.begin() + block * num_states, num_states,
+                  count.begin());
+    }
+    const PositionType start = block * BLOCK_SIZE;
+    const PositionType end = std::min(start + BLOCK_SIZE, length + 1);
+    for (PositionType pos = start; pos < end; ++pos) {
+      const size_t index = static_cast<size_t>(pos) * num_states;
+      for (StateType i = 0; i < num_states; ++i) {
+        if (layout == DENSE) {
+          counts[index + i] = count[i];
+        } else {
+          relative_counts[index + i] = static_cast<uint8_t>(count[i]);
+        }
+      }
+      if (pos < length) {
+        ++count[ref_seq[static_cast<size_t>(pos)]];
+      }
+    }
+  }
+
+  if (layout == BLOCKED) {
+    block_counts = std::move(start_counts);
+  }
+}
+
+auto cmaple::CumulativeBase::getMemorySize() const -> size_t {
+  if (empty()) {
+    return 0;
+  }
+  const size_t num_entries = (static_cast<size_t>(length) + 1) * num_states;
+  if (layout == DENSE) {
+    return num_entries * sizeof(PositionType);
+  }
+  return num_entries * sizeof(uint8_t) +
+         block_counts.size() * sizeof(PositionType);
+}
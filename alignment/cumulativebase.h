@@ -0,0 +1,131 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <vector>
+#include "../utils/tools.h"
+
+namespace cmaple {
+
+/** Prefix counts of the bases of the reference genome: getCount(pos, state)
+ *  is the number of sites in [0, pos) of the reference genome with that
+ *  state. The counts are kept in a single contiguous (cache-line aligned),
+ *  position-major table. For long genomes, a blocked variant keeps the counts
+ *  at the start of every block of BLOCK_SIZE sites plus one-byte counts
+ *  relative to the start of the block, i.e., one extra add per lookup for 4x
+ *  less memory
+ */
+class CumulativeBase {
+ public:
+  /** The layouts of the prefix counts */
+  enum Layout {
+    /** One count (PositionType) per site and state */
+    DENSE,
+    /** One count per block and state + one byte per site and state */
+    BLOCKED,
+    /** DENSE unless its table exceeds MAX_DENSE_BYTES */
+    AUTO,
+  };
+
+  /** The number of sites of a block of the BLOCKED layout (the relative
+   counts must fit in a byte) */
+  static constexpr cmaple::PositionType BLOCK_SIZE = 256;
+
+  /** The maximum size (in bytes) of the table of the DENSE layout chosen by
+   AUTO */
+  static constexpr size_t MAX_DENSE_BYTES = 8 << 20;
+
+  /** The alignment (in bytes) of the tables */
+  static constexpr size_t ALIGNMENT = 64;
+
+  /**
+   Build the prefix counts of a reference genome (in parallel if OpenMP is
+   enabled)
+   @param[in] ref_seq The reference genome
+   @param[in] num_states The number of states
+   @param[in] layout The layout of the counts
+   */
+  void build(const std::vector<cmaple::StateType>& ref_seq,
+             const cmaple::StateType num_states,
+             Layout layout = AUTO);
+
+  /**
+   Get the number of sites in [0, pos) of the reference genome with a state
+   */
+  inline cmaple::PositionType getCount(const cmaple::PositionType pos,
+                                       const cmaple::StateType state) const {
+    assert(pos >= 0 && pos <= length);
+    assert(state < num_states);
+    const size_t index = static_cast<size_t>(pos) * num_states + state;
+    if (layout == DENSE) {
+      return counts.get()[index];
+    }
+    return block_counts[static_cast<size_t>(pos / BLOCK_SIZE) * num_states +
+                        state] +
+           relative_counts.get()[index];
+  }
+
+  /**
+   Get the number of sites in [start, end] of the reference genome with a
+   state
+   */
+  inline cmaple::PositionType getCount(const cmaple::PositionType start,
+                                       const cmaple::PositionType end,
+                                       const cmaple::StateType state) const {
+    return getCount(end + 1, state) - getCount(start, state);
+  }
+
+  /**
+   TRUE if the counts haven't been built
+   */
+  bool empty() const { return length < 0; }
+
+  /**
+   Get the layout of the counts
+   */
+  Layout getLayout() const { return layout; }
+
+  /**
+   Get the memory (in bytes) of the counts
+   */
+  size_t getMemorySize() const;
+
+ private:
+  /** Delete a table allocated with ALIGNMENT */
+  struct AlignedDelete {
+    void operator()(void* table) const {
+      ::operator delete[](table, std::align_val_t(ALIGNMENT));
+    }
+  };
+
+  template <typename T>
+  using AlignedTable = std::unique_ptr<T[], AlignedDelete>;
+
+  /** Allocate a table with ALIGNMENT */
+  template <typename T>
+  static AlignedTable<T> allocateTable(const size_t size) {
+    return AlignedTable<T>(static_cast<T*>(
+        ::operator new[](size * sizeof(T), std::align_val_t(ALIGNMENT))));
+  }
+
+  /** The length of the reference genome (-1 if the counts haven't been
+   built) */
+  cmaple::PositionType length = -1;
+
+  /** The number of states */
+  cmaple::StateType num_states = 0;
+
+  /** The layout of the counts */
+  Layout layout = DENSE;
+
+  /** DENSE: the counts of each position (position-major) */
+  AlignedTable<cmaple::PositionType> counts;
+
+  /** BLOCKED: the counts at the start of each block (block-major) */
+  std::vector<cmaple::PositionType> block_counts;
+
+  /** BLOCKED: the counts of each position relative to the start of its block
+   (position-major) */
+  AlignedTable<uint8_t> relative_counts;
+};
+}  // namespace cmaple
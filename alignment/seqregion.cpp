@@ -7,8 +7,157 @@
 
 #include "seqregion.h"
 #include <iomanip>
+#include <mutex>
 using namespace cmaple;
 
+namespace {
+/** A block of the likelihood pool: a likelihood vector (when allocated) or
+ the next free block (when free) */
+union LHBlock {
+  LHBlock* next;
+  alignas(SeqRegion::LHType) unsigned char lh[sizeof(SeqRegion::LHType)];
+};
+
+/** The number of blocks moved at once between a thread cache and the shared
+ pool (and allocated per slab) */
+constexpr size_t LH_BATCH_SIZE = 1024;
+
+struct LHThreadCache;
+
+/** The blocks freed by all threads, in chains of (up to) LH_BATCH_SIZE blocks,
+ plus the slabs of blocks and the registry of the thread caches. The slabs and
+ caches are never released (the pool is intentionally leaked) so that a vector
+ can outlive any thread and the pool */
+struct LHSharedPool {
+  std::mutex mutex;
+  std::vector<std::pair<LHBlock*, size_t>> free_chains;
+  std::vector<LHThreadCache*> thread_caches;
+
+  static LHSharedPool& get() {
+    static LHSharedPool* const pool = new LHSharedPool();
+    return *pool;
+  }
+};
+
+/** The free blocks of a thread, exchanged with the shared pool in batches.
+ It is trivially destructible and allocated on the heap (see getLHThreadCache())
+ so that it stays valid for the vectors freed during the teardown of the
+ thread, e.g., by static objects destroyed after the thread_local ones */
+struct LHThreadCache {
+  LHBlock* free_list = nullptr;
+  size_t num_free_blocks = 0;
+
+  // refill the cache with a chain from the shared pool (or a new slab)
+  void refill() {
+    LHSharedPool& pool = LHSharedPool::get();
+    {
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      if (!pool.free_chains.empty()) {
+        free_list = pool.free_chains.back().first;
+        num_free_blocks = pool.free_chains.back().second;
+        pool.free_chains.pop_back();
+        return;
+      }
+    }
+    LHBlock* const slab = new LHBlock[LH_BATCH_SIZE];
+    for (size_t i = 0; i < LH_BATCH_SIZE - 1; ++i) {
+      slab[i].next = slab + i + 1;
+    }
+    slab[LH_BATCH_SIZE - 1].next = nullptr;
+    free_list = slab;
+    num_free_blocks = LH_BATCH_SIZE;
+  }
+
+  // return a chain of (up to) num_blocks blocks to the shared pool
+  void release(size_t num_blocks) {
+    num_blocks = std::min(num_blocks, num_free_blocks);
+    if (!num_blocks) {
+      return;
+    }
+    LHBlock* const head = free_list;
+    LHBlock* tail = head;
+    for (size_t i = 1; i < num_blocks; ++i) {
+      tail = tail->next;
+    }
+    free_list = tail->next;
+    tail->next = nullptr;
+    num_free_blocks -= num_blocks;
+
+    LHSharedPool& pool = LHSharedPool::get();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.free_chains.emplace_back(head, num_blocks);
+  }
+};
+
+/** Return the free blocks of the cache of a thread to the shared pool when the
+ thread exits. The cache itself remains usable afterwards */
+struct LHThreadCacheReleaser {
+  LHThreadCache* cache = nullptr;
+
+  ~LHThreadCacheReleaser() {
+    if (cache) {
+      cache->release(cache->num_free_blocks);
+    }
+  }
+};
+
+thread_local LHThreadCache* lh_thread_cache = nullptr;
+
+// get the cache of the current thread (allocated on its first use)
+LHThreadCache& getLHThreadCache() {
+  if (!lh_thread_cache) {
+    LHThreadCache* const cache = new LHThreadCache();
+    {
+      LHSharedPool& pool = LHSharedPool::get();
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      pool.thread_caches.push_back(cache);
+    }
+    static thread_local LHThreadCacheReleaser releaser;
+    releaser.cache = cache;
+    lh_thread_cache = cache;
+  }
+  return *lh_thread_cache;
+}
+}  // namespace
+
+void* cmaple::SeqRegion::LHType::operator new(std::size_t size) {
+  // vectors of derived types (if any) are not pooled
+  if (size != sizeof(LHType)) {
+    return ::operator new(size);
+  }
+
+  LHThreadCache& cache = getLHThreadCache();
+  if (!cache.free_list) {
+    cache.refill();
+  }
+  LHBlock* const block = cache.free_list;
+  cache.free_list = block->next;
+  --cache.num_free_blocks;
+  return block;
+}
+
+void cmaple::SeqRegion::LHType::operator delete(void* ptr,
+                                                std::size_t size) noexcept {
+  if (!ptr) {
+    return;
+  }
+  if (size != sizeof(LHType)) {
+    ::operator delete(ptr);
+    return;
+  }
+
+  LHThreadCache& cache = getLHThreadCache();
+  LHBlock* const block = static_cast<LHBlock*>(ptr);
+  block->next = cache.free_list;
+  cache.free_list = block;
+  ++cache.num_free_blocks;
+
+  // don't let a thread hoard the vectors freed from those of other threads
+  if (cache.num_free_blocks >= 2 * LH_BATCH_SIZE) {
+    cache.release(LH_BATCH_SIZE);
+  }
+}
+
 cmaple::SeqRegion::SeqRegion(StateType n_type,
                              PositionType n_position,
                              RealNumType n_plength_observation,
@@ -10,9 +10,20 @@ class SeqRegion : public Mutation {
  public:
   /*! \cond PRIVATE */
   /*!
-      Type of likelihood
-   */
-  using LHType = std::array<cmaple::RealNumType, NUM_STATES>;
+      Type of likelihood. The likelihood vectors (of O regions) are allocated
+      from per-thread pools of fixed-size blocks, thus, a vector freed when
+      replacing a region is recycled for the next one in O(1)
+   */
+  struct LHType : public std::array<cmaple::LhNumType, NUM_STATES> {
+    /*!
+        Allocate a likelihood vector from the pool of the current thread
+     */
+    static void* operator new(std::size_t size);
+    /*!
+        Return a likelihood vector to the pool of the current thread
+     */
+    static void operator delete(void* ptr, std::size_t size) noexcept;
+  };
   /*!
       Type of likelihood pointer
    */
@@ -64,7 +75,7 @@ class SeqRegion : public Mutation {
    Length of the path between the current phylo node and the node where the
    likelihood is calculated
    */
-  cmaple::RealNumType plength_observation2node = -1;
+  cmaple::LhNumType plength_observation2node = -1;
 
   /**
    Distance separates the observation at root from the observation at the
@@ -76,7 +87,7 @@ class SeqRegion : public Mutation {
    0.0001, while a distance of 0.0002 separates the root from the current node
    (or position along a branch) considered.
    */
-  cmaple::RealNumType plength_observation2root = -1;
+  cmaple::LhNumType plength_observation2root = -1;
 
   /**
    The relative partial likelihood
@@ -25,6 +25,63 @@ cmaple::SeqRegions::SeqRegions(const std::unique_ptr<SeqRegions>& n_regions) {
   }
 }
 
+void cmaple::SeqRegions::writeCheckpoint(
+    BinaryWriter& writer,
+    const std::unique_ptr<SeqRegions>& regions,
+    const StateType num_states) {
+  writer.write<uint8_t>(regions != nullptr);
+  if (!regions) {
+    return;
+  }
+
+  // write the fixed-size parts of all regions at once, then the likelihoods
+  std::vector<RegionRecord> records;
+  records.reserve(regions->size());
+  std::vector<RealNumType> likelihoods;
+  for (const SeqRegion& region : *regions) {
+    records.push_back({region.plength_observation2node,
+                       region.plength_observation2root, region.position,
+                       region.type, region.likelihood != nullptr});
+    if (region.likelihood) {
+      likelihoods.insert(likelihoods.end(), region.likelihood->begin(),
+                         region.likelihood->begin() + num_states);
+    }
+  }
+  writer.writeVector(records);
+  writer.writeVector(likelihoods);
+}
+
+auto cmaple::SeqRegions::readCheckpoint(BinaryReader& reader,
+                                        const StateType num_states)
+    -> std::unique_ptr<SeqRegions> {
+  if (!reader.read<uint8_t>()) {
+    return nullptr;
+  }
+  std::vector<RegionRecord> records;
+  std::vector<RealNumType> likelihoods;
+  reader.readVector(records);
+  reader.readVector(likelihoods);
+
+  std::unique_ptr<SeqRegions> regions = cmaple::make_unique<SeqRegions>();
+  regions->reserve(records.size());
+  const RealNumType* likelihood = likelihoods.data();
+  for (const RegionRecord& record : records) {
+    SeqRegion::LHPtrType lh = nullptr;
+    if (record.has_likelihood) {
+      if (likelihood + num_states > likelihoods.data() + likelihoods.size()) {
+        throw std::logic_error("Invalid likelihoods found in the checkpoint!");
+      }
+      lh = cmaple::make_unique<SeqRegion::LHType>();
+      std::copy(likelihood, likelihood + num_states, lh->begin());
+      likelihood += num_states;
+    }
+    regions->emplace_back(record.type, record.position,
+                          record.plength_observation2node,
+                          record.plength_observation2root, std::move(lh));
+  }
+  return regions;
+}
+
 auto cmaple::SeqRegions::compareWithSample(const SeqRegions& sequence2,
                                            PositionType seq_length,
                                            const Alignment* aln,
@@ -435,7 +492,8 @@ void cmaple::calSiteLhs_identicalRACGT(std::vector<RealNumType>&site_lh_contribu
                                const ModelBase* model,
                                const RealNumType* const cumulative_rate,
                                RealNumType& log_lh,
-                               SeqRegions& merged_regions) {
+                               SeqRegions& merged_regions,
+                               std::vector<RealNumType>* rate_breakpoints) {
   assert(seq1_region.type != TYPE_N && seq1_region.type != TYPE_O);
   assert(model);
   assert(cumulative_rate);
@@ -458,11 +516,19 @@ void cmaple::calSiteLhs_identicalRACGT(std::vector<RealNumType>&site_lh_contribu
     log_lh +=
         total_blength * (cumulative_rate[end_pos + 1] - cumulative_rate[pos]);
 
-    // compute site lh contributions
-    for (PositionType i = pos; i < end_pos + 1; ++i) {
-      site_lh_contributions[static_cast<std::vector<RealNumType>
-                            ::size_type>(i)] += total_blength
-        * (cumulative_rate[i + 1] - cumulative_rate[i]);
+    // compute site lh contributions (or record the breakpoints of the
+    // region)
+    if (rate_breakpoints) {
+      (*rate_breakpoints)[static_cast<std::vector<RealNumType>::size_type>(
+          pos)] += total_blength;
+      (*rate_breakpoints)[static_cast<std::vector<RealNumType>::size_type>(
+          end_pos + 1)] -= total_blength;
+    } else {
+      for (PositionType i = pos; i < end_pos + 1; ++i) {
+        site_lh_contributions[static_cast<std::vector<RealNumType>
+                              ::size_type>(i)] += total_blength
+          * (cumulative_rate[i + 1] - cumulative_rate[i]);
+      }
     }
   } else {
     log_lh += model->getDiagonalMutationMatrixEntry(seq1_region.type, pos) * total_blength;
@@ -517,7 +583,7 @@ void cmaple::SeqRegions::addNonConsecutiveRRegion(
                        plength_observation2root);
 }
 
-auto cmaple::SeqRegions::simplifyO(cmaple::RealNumType* const partial_lh,
+auto cmaple::SeqRegions::simplifyO(cmaple::LhNumType* const partial_lh,
                                    cmaple::StateType ref_state,
                                    cmaple::StateType num_states,
                                    cmaple::RealNumType threshold)
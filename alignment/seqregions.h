@@ -3,7 +3,9 @@
 #include <algorithm>
 #include "../model/modelbase.h"
 #include "alignment.h"
+#include "cumulativebase.h"
 #include "seqregion.h"
+#include "../utils/binaryio.h"
 #include "../utils/tools.h"
 
 namespace cmaple {
@@ -30,6 +32,15 @@ static constexpr DoubleState ON = (DoubleState(TYPE_O) << 8) | TYPE_N;
  */
 class SeqRegions : public std::vector<SeqRegion> {
  private:
+  /** The fixed-size part of a region in a checkpoint */
+  struct RegionRecord {
+    cmaple::RealNumType plength_observation2node;
+    cmaple::RealNumType plength_observation2root;
+    cmaple::PositionType position;
+    cmaple::StateType type;
+    uint8_t has_likelihood;
+  };
+
  public:
   /**
    *  Regions constructor
@@ -47,6 +58,22 @@ class SeqRegions : public std::vector<SeqRegion> {
   /// Move Assignment
   SeqRegions& operator=(SeqRegions&& regions) = default;
 
+  /**
+   Write regions (which may be null) into a checkpoint
+   */
+  static void writeCheckpoint(BinaryWriter& writer,
+                              const std::unique_ptr<SeqRegions>& regions,
+                              const cmaple::StateType num_states);
+
+  /**
+   Read regions written by writeCheckpoint()
+   @return the regions (null if null regions were written)
+   @throw std::logic\_error if the checkpoint is truncated
+   */
+  static std::unique_ptr<SeqRegions> readCheckpoint(
+      BinaryReader& reader,
+      const cmaple::StateType num_states);
+
   /**
    Add a new region and automatically merged consecutive R regions
    @throw std::logic\_error if unexpected values/behaviors found during the
@@ -181,6 +208,14 @@ class SeqRegions : public std::vector<SeqRegion> {
    @param model the model of evolution
    @param threshold the threshold for approximation
    @param return_log_lh TRUE to return the log likelihood
+   @param rate_breakpoints if not null, the contributions of the R regions
+   (which are proportional to the site rates) are not spread over
+   site_lh_contributions but recorded as breakpoints: the total branch length
+   of a region [pos, end_pos] is added at pos and subtracted at end_pos + 1
+   (thus, rate_breakpoints has seq_length + 1 entries)
+   @param updated_positions if not null, the positions of site_lh_contributions
+   and rate_breakpoints written by this call are appended to it (possibly with
+   duplicates), so that the caller only needs to scan/reset those positions
    @throw std::logic\_error if unexpected values/behaviors found during the
    operations
    */
@@ -194,7 +229,9 @@ class SeqRegions : public std::vector<SeqRegion> {
       const Alignment* aln,
       const ModelBase* model,
       const RealNumType* const cumulative_rate,
-      const cmaple::RealNumType threshold_prob) const;
+      const cmaple::RealNumType threshold_prob,
+      std::vector<cmaple::RealNumType>* rate_breakpoints = nullptr,
+      std::vector<cmaple::PositionType>* updated_positions = nullptr) const;
 
   /**
    Compute total lh/upper left_right for root node
@@ -214,7 +251,26 @@ class SeqRegions : public std::vector<SeqRegion> {
   template <const cmaple::StateType num_states>
   cmaple::RealNumType computeAbsoluteLhAtRoot(
       const ModelBase* model,
-      const std::vector<std::vector<PositionType>>& cumulative_base);
+      const CumulativeBase& cumulative_base);
+
+  /**
+   Compute the differences between the site likelihoods at root of these
+   regions and those of other_regions (i.e., what computeSiteLhAtRoot()
+   would give for this minus for other_regions) without visiting the shared R
+   segments, whose contributions cancel out
+   @param other_regions the regions to compare against (e.g., the current
+   lower regions at root)
+   @param site_lh_diffs the output differences (added to)
+   @param updated_positions the positions written to site_lh_diffs are
+   appended to it
+   */
+  template <const cmaple::StateType num_states>
+  void computeSiteLhDiffAtRoot(
+      const SeqRegions& other_regions,
+      std::vector<cmaple::RealNumType>& site_lh_diffs,
+      std::vector<cmaple::PositionType>& updated_positions,
+      const ModelBase* model,
+      const CumulativeBase& cumulative_base) const;
 
   /**
    Compute the site likelihood at root by merging the lower lh with root
@@ -224,13 +280,13 @@ class SeqRegions : public std::vector<SeqRegion> {
   cmaple::RealNumType computeSiteLhAtRoot(
       std::vector<cmaple::RealNumType>& site_lh_contributions,
       const ModelBase* model,
-      const std::vector<std::vector<PositionType>>& cumulative_base);
+      const CumulativeBase& cumulative_base);
 
   /**
    Convert an entry 'O' into a normal nucleotide if its probability dominated
    others
    */
-  static cmaple::StateType simplifyO(cmaple::RealNumType* const partial_lh,
+  static cmaple::StateType simplifyO(cmaple::LhNumType* const partial_lh,
                                      cmaple::StateType ref_state,
                                      cmaple::StateType num_states,
                                      cmaple::RealNumType threshold);
@@ -258,6 +314,7 @@ class SeqRegions : public std::vector<SeqRegion> {
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 void merge_N_O(const cmaple::RealNumType lower_plength,
                const SeqRegion& reg_o,
                const ModelBase* model,
@@ -283,6 +340,7 @@ void merge_N_RACGT(const SeqRegion& reg_racgt,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 void merge_O_N(const SeqRegion& reg_o,
                const cmaple::RealNumType upper_plength,
                const cmaple::PositionType end_pos,
@@ -323,6 +381,7 @@ bool merge_Zero_Distance(const SeqRegion& seq1_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 void merge_O_ORACGT(const SeqRegion& seq1_region,
                     const SeqRegion& seq2_region,
                     const cmaple::RealNumType total_blength_1,
@@ -340,6 +399,7 @@ void merge_O_ORACGT(const SeqRegion& seq1_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 void merge_RACGT_O(const SeqRegion& seq2_region,
                    const cmaple::RealNumType total_blength_2,
                    const cmaple::PositionType end_pos,
@@ -356,6 +416,7 @@ void merge_RACGT_O(const SeqRegion& seq2_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 void merge_RACGT_RACGT(const SeqRegion& seq2_region,
                        const cmaple::RealNumType total_blength_2,
                        const cmaple::PositionType end_pos,
@@ -371,6 +432,7 @@ void merge_RACGT_RACGT(const SeqRegion& seq2_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 void merge_RACGT_ORACGT(const SeqRegion& seq1_region,
                         const SeqRegion& seq2_region,
                         const cmaple::RealNumType total_blength_1,
@@ -426,6 +488,7 @@ void merge_identicalRACGT_TwoLowers(const SeqRegion& seq1_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 bool merge_O_O_TwoLowers(const SeqRegion& seq2_region,
                          cmaple::RealNumType total_blength_2,
                          const cmaple::PositionType end_pos,
@@ -444,6 +507,7 @@ bool merge_O_O_TwoLowers(const SeqRegion& seq2_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 bool merge_O_RACGT_TwoLowers(const SeqRegion& seq2_region,
                              cmaple::RealNumType total_blength_2,
                              const cmaple::PositionType end_pos,
@@ -463,6 +527,7 @@ bool merge_O_RACGT_TwoLowers(const SeqRegion& seq2_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 bool merge_O_ORACGT_TwoLowers(const SeqRegion& seq1_region,
                               const SeqRegion& seq2_region,
                               cmaple::RealNumType total_blength_1,
@@ -482,6 +547,7 @@ bool merge_O_ORACGT_TwoLowers(const SeqRegion& seq1_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 bool merge_RACGT_O_TwoLowers(const SeqRegion& seq2_region,
                              cmaple::RealNumType total_blength_2,
                              const cmaple::PositionType end_pos,
@@ -500,6 +566,7 @@ bool merge_RACGT_O_TwoLowers(const SeqRegion& seq2_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 bool merge_RACGT_RACGT_TwoLowers(const SeqRegion& seq2_region,
                                  cmaple::RealNumType total_blength_2,
                                  const cmaple::PositionType end_pos,
@@ -519,6 +586,7 @@ bool merge_RACGT_RACGT_TwoLowers(const SeqRegion& seq2_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 bool merge_RACGT_ORACGT_TwoLowers(const SeqRegion& seq1_region,
                                   const SeqRegion& seq2_region,
                                   cmaple::RealNumType total_blength_1,
@@ -538,6 +606,7 @@ bool merge_RACGT_ORACGT_TwoLowers(const SeqRegion& seq1_region,
  operations
  */
 template <const cmaple::StateType num_states>
+CMAPLE_SIMD_KERNEL
 bool merge_notN_notN_TwoLowers(const SeqRegion& seq1_region,
                                const SeqRegion& seq2_region,
                                const cmaple::RealNumType plength1,
@@ -559,19 +628,24 @@ auto updateLHwithModel(const ModelBase* model,
                        const RealNumType total_blength,
                        const PositionType pos) -> RealNumType {
   assert(model);
+  if constexpr (num_states > NUM_STATES) {
+    // e.g., the 20-state instantiation in the DNA build: LHType is too short
+    throw std::logic_error("The likelihood vectors have fewer than num_states entries");
+  }
   RealNumType sum_lh = 0;
-  for (StateType i = 0; i < num_states; ++i) {
-    RealNumType tot = 0;
-    if (total_blength > 0)  // TODO: avoid
-    {
-
-      const RealNumType* mutation_mat_row = model->getMutationMatrixRow(i, pos);
-      tot += dotProduct<num_states>(&(prior)[0], mutation_mat_row);
-
-      tot *= total_blength;
+  RealNumType mut_lh[num_states];
+  if (total_blength > 0)  // TODO: avoid
+  {
+    matrixVectorProduct<num_states>(model->getMutationMatrix(pos),
+                                    prior.data(), mut_lh);
+    for (StateType i = 0; i < num_states; ++i) {
+      mut_lh[i] *= total_blength;
     }
-
-    tot += prior[i];
+  } else {
+    std::fill_n(mut_lh, num_states, 0);
+  }
+  for (StateType i = 0; i < num_states; ++i) {
+    const RealNumType tot = mut_lh[i] + prior[i];
     posterior[i] = tot * model->getRootFreq(i);
     sum_lh += posterior[i];
   }
@@ -584,12 +658,15 @@ auto updateLHwithMat(const RealNumType* mat_row,
                      SeqRegion::LHType& posterior,
                      const RealNumType total_blength) -> RealNumType {
   assert(mat_row);
+  if constexpr (num_states > NUM_STATES) {
+    // e.g., the 20-state instantiation in the DNA build: LHType is too short
+    throw std::logic_error("The likelihood vectors have fewer than num_states entries");
+  }
   RealNumType sum_lh = 0;
-  for (StateType i = 0; i < num_states; ++i, mat_row += num_states) {
-    RealNumType tot = 0;
-    tot += dotProduct<num_states>(&(prior)[0], mat_row);
-    tot *= total_blength;
-    tot += prior[i];
+  RealNumType mut_lh[num_states];
+  matrixVectorProduct<num_states>(mat_row, prior.data(), mut_lh);
+  for (StateType i = 0; i < num_states; ++i) {
+    const RealNumType tot = mut_lh[i] * total_blength + prior[i];
     posterior[i] = tot;
     sum_lh += tot;
   }
@@ -602,16 +679,23 @@ auto updateMultLHwithMat(const RealNumType* mat_row,
                          SeqRegion::LHType& posterior,
                          const RealNumType total_blength) -> RealNumType {
   assert(mat_row);
+  if constexpr (num_states > NUM_STATES) {
+    // e.g., the 20-state instantiation in the DNA build: LHType is too short
+    throw std::logic_error("The likelihood vectors have fewer than num_states entries");
+  }
   RealNumType sum_lh = 0;
-  for (StateType i = 0; i < num_states; ++i, mat_row += num_states) {
-    RealNumType tot = 0;
-    if (total_blength > 0)  // TODO: avoid
-    {
-      tot += dotProduct<num_states>(&(prior)[0], mat_row);
-      tot *= total_blength;
+  RealNumType mut_lh[num_states];
+  if (total_blength > 0)  // TODO: avoid
+  {
+    matrixVectorProduct<num_states>(mat_row, prior.data(), mut_lh);
+    for (StateType i = 0; i < num_states; ++i) {
+      mut_lh[i] *= total_blength;
     }
-    tot += prior[i];
-    posterior[i] *= tot;
+  } else {
+    std::fill_n(mut_lh, num_states, 0);
+  }
+  for (StateType i = 0; i < num_states; ++i) {
+    posterior[i] *= mut_lh[i] + prior[i];
     sum_lh += posterior[i];
   }
   return sum_lh;
@@ -830,6 +914,10 @@ void merge_RACGT_ORACGT(const SeqRegion& seq1_region,
   assert(seq2_region.type != TYPE_N);
   assert(model);
   assert(aln);
+  if constexpr (num_states > NUM_STATES) {
+    // e.g., the 20-state instantiation in the DNA build: LHType is too short
+    throw std::logic_error("The likelihood vectors have fewer than num_states entries");
+  }
     
   StateType seq1_state = seq1_region.type;
   if (seq1_state == TYPE_R) {
@@ -850,7 +938,8 @@ void merge_RACGT_ORACGT(const SeqRegion& seq1_region,
     
     /*memcpy(root_vec.data(), model->root_freqs,
            sizeof(RealNumType) * num_states);*/
-    memcpy(root_vec.data(), model->root_freqs, sizeof(SeqRegion::LHType));
+    // root_freqs only has num_states entries (e.g., DNA data in the AA build)
+    std::copy_n(model->root_freqs, num_states, root_vec.begin());
 
 
     updateVecWithState<num_states>(root_vec.data(), seq1_state,
@@ -1483,7 +1572,7 @@ RealNumType SeqRegions::mergeTwoLowers(
 template <const StateType num_states>
 auto SeqRegions::computeAbsoluteLhAtRoot(
     const ModelBase* model,
-    const std::vector<std::vector<PositionType>>& cumulative_base)
+    const CumulativeBase& cumulative_base)
     -> RealNumType {
   assert(model);
   assert(size() > 0);
@@ -1500,8 +1589,7 @@ auto SeqRegions::computeAbsoluteLhAtRoot(
     if (region.type == TYPE_R) {
       for (StateType i = 0; i < num_states; ++i) {
         log_lh += model->getRootLogFreq(i) *
-                  (cumulative_base[static_cast<size_t>(region.position) + 1][i] -
-                   cumulative_base[static_cast<size_t>(start_pos)][i]); 
+                  cumulative_base.getCount(start_pos, region.position, i); 
       }
     }
     // type ACGT
@@ -1541,7 +1629,7 @@ template <const StateType num_states>
 RealNumType SeqRegions::computeSiteLhAtRoot(
     std::vector<RealNumType>& site_lh_contributions,
     const ModelBase* model,
-    const std::vector<std::vector<PositionType>>& cumulative_base) {
+    const CumulativeBase& cumulative_base) {
   assert(model);
   assert(size() > 0);
     
@@ -1557,8 +1645,7 @@ RealNumType SeqRegions::computeSiteLhAtRoot(
     if (region.type == TYPE_R) {
       for (StateType i = 0; i < num_states; ++i) {
         log_lh += model->getRootLogFreq(i) *
-                  (cumulative_base[static_cast<size_t>(region.position) + 1][i] -
-                   cumulative_base[static_cast<size_t>(start_pos)][i]);
+                  cumulative_base.getCount(start_pos, region.position, i);
       }
 
       // calculate site lhs
@@ -1566,8 +1653,7 @@ RealNumType SeqRegions::computeSiteLhAtRoot(
         for (StateType i = 0; i < num_states; ++i) {
           site_lh_contributions[static_cast<std::vector<RealNumType>::size_type>(pos)] +=
               model->getRootLogFreq(i) *
-              (cumulative_base[static_cast<size_t>(pos) + 1][i] -
-               cumulative_base[static_cast<size_t>(pos)][i]);
+              cumulative_base.getCount(pos, pos, i);
         }
       }
     }
@@ -1614,6 +1700,82 @@ RealNumType SeqRegions::computeSiteLhAtRoot(
   return log_lh;
 }
 
+template <const StateType num_states>
+void SeqRegions::computeSiteLhDiffAtRoot(
+    const SeqRegions& other_regions,
+    std::vector<RealNumType>& site_lh_diffs,
+    std::vector<PositionType>& updated_positions,
+    const ModelBase* model,
+    const CumulativeBase& cumulative_base) const {
+  assert(model);
+  assert(size() > 0 && other_regions.size() > 0);
+
+  // the site lh at root of a region at pos (the same terms as
+  // computeSiteLhAtRoot())
+  const auto site_lh_at_root = [&](const SeqRegion& region,
+                                   const PositionType pos) -> RealNumType {
+    if (region.type == TYPE_R) {
+      RealNumType site_lh = 0;
+      for (StateType i = 0; i < num_states; ++i) {
+        site_lh += model->getRootLogFreq(i) *
+                   cumulative_base.getCount(pos, pos, i);
+      }
+      return site_lh;
+    }
+    if (region.type < num_states) {
+      return model->getRootLogFreq(region.type);
+    }
+    if (region.type == TYPE_O) {
+      return log(dotProduct<num_states>(&(*region.likelihood)[0],
+                                        model->getRootFreqs()));
+    }
+    return 0;
+  };
+
+  PositionType pos = 0;
+  size_t iseq1 = 0;
+  size_t iseq2 = 0;
+  // the last region ends at the last site
+  const PositionType seq_length = back().position + 1;
+  while (pos < seq_length) {
+    PositionType end_pos;
+    getNextSharedSegment(pos, *this, other_regions, iseq1, iseq2, end_pos);
+    const SeqRegion& region = (*this)[iseq1];
+    const SeqRegion& other_region = other_regions[iseq2];
+
+    // shared R (and N) segments give the same contributions
+    if (region.type != other_region.type || region.type < num_states ||
+        region.type == TYPE_O) {
+      // ACGT/O regions are single-site; computeSiteLhAtRoot() records their
+      // contributions at the first position of the region
+      const PositionType region_start =
+          iseq1 > 0 ? (*this)[iseq1 - 1].position + 1 : 0;
+      const PositionType other_start =
+          iseq2 > 0 ? other_regions[iseq2 - 1].position + 1 : 0;
+      for (PositionType i = pos; i <= end_pos; ++i) {
+        RealNumType diff = 0;
+        if (region.type == TYPE_R) {
+          diff += site_lh_at_root(region, i);
+        } else if (i == region_start) {
+          diff += site_lh_at_root(region, i);
+        }
+        if (other_region.type == TYPE_R) {
+          diff -= site_lh_at_root(other_region, i);
+        } else if (i == other_start) {
+          diff -= site_lh_at_root(other_region, i);
+        }
+        if (diff != 0) {
+          site_lh_diffs[static_cast<std::vector<RealNumType>::size_type>(i)] +=
+              diff;
+          updated_positions.push_back(i);
+        }
+      }
+    }
+
+    pos = end_pos + 1;
+  }
+}
+
 template <const StateType num_states>
 void SeqRegions::computeTotalLhAtRoot(std::unique_ptr<SeqRegions>& total_lh,
                                       const ModelBase* model,
@@ -1699,7 +1861,8 @@ void calSiteLhs_identicalRACGT(std::vector<RealNumType>& site_lh_contributions,
                                const ModelBase* model,
                                const RealNumType* const cumulative_rate,
                                RealNumType& log_lh,
-                               SeqRegions& merged_regions);
+                               SeqRegions& merged_regions,
+                               std::vector<RealNumType>* rate_breakpoints);
 
 template <const StateType num_states>
 inline void addSimplifyOAndCalSiteLh(std::vector<RealNumType>& site_lh_contributions,
@@ -1991,7 +2154,8 @@ bool calSiteLhs_notN_notN(std::vector<RealNumType>& site_lh_contributions,
                           const RealNumType* const cumulative_rate,
                           const RealNumType threshold_prob,
                           RealNumType& log_lh,
-                          std::unique_ptr<SeqRegions>& merged_regions) {
+                          std::unique_ptr<SeqRegions>& merged_regions,
+                          std::vector<RealNumType>* rate_breakpoints) {
   assert(seq1_region.type != TYPE_N);
   assert(seq2_region.type != TYPE_N);
   assert(aln);
@@ -2020,7 +2184,7 @@ bool calSiteLhs_notN_notN(std::vector<RealNumType>& site_lh_contributions,
     calSiteLhs_identicalRACGT(site_lh_contributions, seq1_region, end_pos,
                               total_blength_1, total_blength_2, pos,
                               threshold_prob, model, cumulative_rate, log_lh,
-                              *merged_regions);
+                              *merged_regions, rate_breakpoints);
   }
   // #0 distance between different nucleotides: merge is not possible
   else if (total_blength_1 == 0 && total_blength_2 == 0 &&
@@ -2058,7 +2222,9 @@ RealNumType SeqRegions::calculateSiteLhContributions(
     const Alignment* aln,
     const ModelBase* model,
     const RealNumType* const cumulative_rate,
-    const RealNumType threshold_prob) const {
+    const RealNumType threshold_prob,
+    std::vector<RealNumType>* rate_breakpoints,
+    std::vector<PositionType>* updated_positions) const {
   assert(aln);
   assert(model);
   assert(cumulative_rate);
@@ -2072,6 +2238,7 @@ RealNumType SeqRegions::calculateSiteLhContributions(
   size_t iseq2 = 0;
   const PositionType seq_length = static_cast<PositionType>(aln->ref_seq.size());
   assert(site_lh_contributions.size() == seq_length);
+  assert(!rate_breakpoints || rate_breakpoints->size() == seq_length + 1);
 
   // init merged_regions
   if (merged_regions) {
@@ -2131,12 +2298,23 @@ RealNumType SeqRegions::calculateSiteLhContributions(
       if (!calSiteLhs_notN_notN<num_states>(
               site_lh_contributions, *seq1_region, *seq2_region, plength1,
               plength2, end_pos, pos, aln, model, cumulative_rate,
-              threshold_prob, log_lh, merged_regions)) {
+              threshold_prob, log_lh, merged_regions, rate_breakpoints)) {
         if (cmaple::verbose_mode >= cmaple::VB_DEBUG) {
           outWarning("calculateSiteLhContributions() returns MIN_NEGATIVE!");
         }
         return MIN_NEGATIVE;
       }
+
+      // record the written positions (only this case writes)
+      if (updated_positions) {
+        updated_positions->push_back(pos);
+        if (end_pos != pos) {
+          updated_positions->push_back(end_pos);
+        }
+        if (rate_breakpoints) {
+          updated_positions->push_back(end_pos + 1);
+        }
+      }
     }
 
     // NHANLT: LOGS FOR DEBUGGING
@@ -0,0 +1,41 @@
+#include "seqregionssoa.h"
+
+using namespace cmaple;
+
+cmaple::SeqRegionsSoA::SeqRegionsSoA(const SeqRegions& regions) {
+  const size_t num_regions = regions.size();
+  positions.reserve(num_regions);
+  types.reserve(num_regions);
+  plengths_observation2node.reserve(num_regions);
+  plengths_observation2root.reserve(num_regions);
+  lh_indexes.reserve(num_regions);
+
+  for (const SeqRegion& region : regions) {
+    positions.push_back(region.position);
+    types.push_back(region.type);
+    plengths_observation2node.push_back(region.plength_observation2node);
+    plengths_observation2root.push_back(region.plength_observation2root);
+    if (region.likelihood) {
+      lh_indexes.push_back(static_cast<uint32_t>(likelihoods.size()));
+      likelihoods.push_back(*region.likelihood);
+    } else {
+      lh_indexes.push_back(NO_LH);
+    }
+  }
+}
+
+auto cmaple::SeqRegionsSoA::toSeqRegions() const -> SeqRegions {
+  SeqRegions regions;
+  regions.reserve(size());
+  for (size_t i = 0; i < size(); ++i) {
+    if (lh_indexes[i] != NO_LH) {
+      regions.emplace_back(types[i], positions[i], plengths_observation2node[i],
+                           plengths_observation2root[i],
+                           likelihoods[lh_indexes[i]]);
+    } else {
+      regions.emplace_back(types[i], positions[i], plengths_observation2node[i],
+                           plengths_observation2root[i]);
+    }
+  }
+  return regions;
+}
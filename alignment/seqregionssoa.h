@@ -0,0 +1,122 @@
+#pragma once
+
+#include "seqregions.h"
+
+namespace cmaple {
+
+/** Regions of a sequence stored as a structure of arrays (SoA): the positions,
+ *  the types and the branch lengths of the regions are kept in separate
+ *  contiguous arrays, and the likelihood vectors of O regions in a side
+ *  buffer. The loops that mostly touch the positions and the types of the
+ *  regions (e.g., getNextSharedSegment()) then use every byte of the cache
+ *  lines they load. It's an alternative (read-only) layout of SeqRegions
+ */
+class SeqRegionsSoA {
+ public:
+  /** A region of SeqRegionsSoA, with the same members as SeqRegion (thus, it
+   *  can be passed to the templates processing a SeqRegion)
+   */
+  struct Region {
+    /// Type of the region
+    cmaple::StateType type;
+
+    /// Position of the region
+    cmaple::PositionType position;
+
+    /// See SeqRegion::plength_observation2node
+    cmaple::LhNumType plength_observation2node;
+
+    /// See SeqRegion::plength_observation2root
+    cmaple::LhNumType plength_observation2root;
+
+    /// The relative partial likelihood (null if the region is not an O region)
+    const SeqRegion::LHType* likelihood;
+
+    /// Get the likelihood of a state
+    cmaple::RealNumType getLH(int pos) const {
+      assert(type == TYPE_O);
+      return (*likelihood)[static_cast<unsigned long>(pos)];
+    }
+  };
+
+  /**
+   *  Regions constructor
+   */
+  SeqRegionsSoA() = default;
+
+  /**
+   *  Convert regions from the AoS layout (SeqRegions)
+   */
+  explicit SeqRegionsSoA(const SeqRegions& regions);
+
+  /**
+   *  Convert the regions back to the AoS layout (SeqRegions)
+   */
+  SeqRegions toSeqRegions() const;
+
+  /**
+   *  Get the number of regions
+   */
+  size_t size() const { return positions.size(); }
+
+  /**
+   *  Get a region
+   */
+  Region operator[](const size_t i) const {
+    const uint32_t lh_index = lh_indexes[i];
+    return Region{types[i], positions[i], plengths_observation2node[i],
+                  plengths_observation2root[i],
+                  lh_index == NO_LH ? nullptr : &likelihoods[lh_index]};
+  }
+
+  /**
+   Get the shared segment between the next regions of two sequences (the
+   same as SeqRegions::getNextSharedSegment() but only touching the positions)
+   @param current_pos: current site position;
+   @return seq1_region, seq2_region: the regions contains the shared segment;
+   end_pos: ending position of the shared segment
+   */
+  inline static void getNextSharedSegment(cmaple::PositionType current_pos,
+                                          const SeqRegionsSoA& seq1_region,
+                                          const SeqRegionsSoA& seq2_region,
+                                          size_t& i1,
+                                          size_t& i2,
+                                          cmaple::PositionType& end_pos) {
+    assert(seq1_region.size() > i1);
+    assert(seq2_region.size() > i2);
+
+    const cmaple::PositionType* const positions1 = seq1_region.positions.data();
+    const cmaple::PositionType* const positions2 = seq2_region.positions.data();
+    if (current_pos > positions1[i1])
+      ++i1;
+    if (current_pos > positions2[i2])
+      ++i2;
+
+    // compute the end_pos for the shared segment
+    end_pos = minFast(positions1[i1], positions2[i2]);
+  }
+
+ private:
+  /** The index of the likelihood vector of a region without one */
+  static constexpr uint32_t NO_LH = UINT32_MAX;
+
+  /** The (end) positions of the regions */
+  std::vector<cmaple::PositionType> positions;
+
+  /** The types of the regions */
+  std::vector<cmaple::StateType> types;
+
+  /** See SeqRegion::plength_observation2node */
+  std::vector<cmaple::LhNumType> plengths_observation2node;
+
+  /** See SeqRegion::plength_observation2root */
+  std::vector<cmaple::LhNumType> plengths_observation2root;
+
+  /** The index (in likelihoods) of the likelihood vector of each region, or
+   NO_LH */
+  std::vector<uint32_t> lh_indexes;
+
+  /** The likelihood vectors of the O regions */
+  std::vector<SeqRegion::LHType> likelihoods;
+};
+}  // namespace cmaple
@@ -0,0 +1,158 @@
+/*
+ Microbenchmark of the layouts of the regions: SeqRegions (array of structures)
+ vs SeqRegionsSoA (structure of arrays) on the placement cost of subtrees.
+
+ Usage: seqregions_layout [alignment] [tree] [num_placements_per_subtree]
+ By default, it places the samples of example/test_5K.maple to build a tree,
+ then computes the cost of placing each subtree at the mid-branch points of
+ num_placements_per_subtree (default: 100) random branches in both layouts.
+ */
+#include <random>
+#include "../tree/placementcostaccess.h"
+#include "../utils/timeutil.h"
+
+namespace cmaple {
+/** Compares the layouts of the regions on the placement cost of subtrees */
+class SeqRegionsLayoutBenchmark {
+ public:
+  /**
+   Run the benchmark on a tree (with all the likelihoods computed)
+   */
+  template <const StateType num_states>
+  static void run(Tree& tree, const size_t num_placements_per_subtree) {
+    // collect the subtrees (lower regions) and the placements (mid-branch
+    // regions)
+    const PlacementCostAccess placement_cost(tree);
+    std::vector<const SeqRegions*> subtrees;
+    std::vector<const SeqRegions*> placements;
+    placement_cost.getRegions(subtrees, placements);
+    if (subtrees.empty() || placements.empty()) {
+      throw std::logic_error("The tree has no regions to benchmark");
+    }
+
+    // convert the regions to the SoA layout
+    const double start_conversion = getRealTime();
+    std::vector<SeqRegionsSoA> subtrees_soa;
+    std::vector<SeqRegionsSoA> placements_soa;
+    subtrees_soa.reserve(subtrees.size());
+    placements_soa.reserve(placements.size());
+    for (const SeqRegions* regions : subtrees) {
+      subtrees_soa.emplace_back(*regions);
+    }
+    for (const SeqRegions* regions : placements) {
+      placements_soa.emplace_back(*regions);
+    }
+    const double conversion_time = getRealTime() - start_conversion;
+
+    // draw the placements of each subtree
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<size_t> placement_dist(
+        0, placements.size() - 1);
+    std::vector<std::pair<size_t, size_t>> pairs;
+    pairs.reserve(subtrees.size() * num_placements_per_subtree);
+    for (size_t i = 0; i < subtrees.size(); ++i) {
+      for (size_t j = 0; j < num_placements_per_subtree; ++j) {
+        pairs.emplace_back(i, placement_dist(rng));
+      }
+    }
+
+    // compute the placement costs in both layouts (alternately, keeping the
+    // best time of each layout)
+    const RealNumType blength = placement_cost.getDefaultBlength();
+    RealNumType total_cost_aos = 0;
+    RealNumType total_cost_soa = 0;
+    double aos_time = DBL_MAX;
+    double soa_time = DBL_MAX;
+    for (int round = 0; round < 3; ++round) {
+      total_cost_aos = 0;
+      const double start_aos = getRealTime();
+      for (const std::pair<size_t, size_t>& pair : pairs) {
+        total_cost_aos +=
+            placement_cost.calculateSubTreePlacementCost<num_states>(
+                *placements[pair.second], *subtrees[pair.first], blength);
+      }
+      aos_time = std::min(aos_time, getRealTime() - start_aos);
+
+      total_cost_soa = 0;
+      const double start_soa = getRealTime();
+      for (const std::pair<size_t, size_t>& pair : pairs) {
+        total_cost_soa +=
+            placement_cost.calculateSubTreePlacementCost<num_states>(
+                placements_soa[pair.second], subtrees_soa[pair.first],
+                blength);
+      }
+      soa_time = std::min(soa_time, getRealTime() - start_soa);
+    }
+
+    // count the regions and the memory of both layouts
+    size_t num_regions = 0;
+    size_t num_lh_vectors = 0;
+    for (const SeqRegions* regions : subtrees) {
+      num_regions += regions->size();
+      for (const SeqRegion& region : *regions) {
+        num_lh_vectors += region.likelihood != nullptr;
+      }
+    }
+    const size_t aos_bytes = sizeof(SeqRegion);
+    const size_t soa_bytes = sizeof(PositionType) + sizeof(StateType)
+        + 2 * sizeof(LhNumType) + sizeof(uint32_t);
+
+    std::cout << "Subtrees: " << subtrees.size() << ", placements: "
+              << placements.size() << ", cost evaluations: " << pairs.size()
+              << std::endl;
+    std::cout << "Regions per subtree: "
+              << static_cast<double>(num_regions) / subtrees.size()
+              << " (O regions: "
+              << static_cast<double>(num_lh_vectors) / subtrees.size() << ")"
+              << std::endl;
+    std::cout << "Bytes per region (excluding likelihood vectors): AoS "
+              << aos_bytes << ", SoA " << soa_bytes << std::endl;
+    std::cout << "Conversion to SoA: " << conversion_time << " s" << std::endl;
+    std::cout << "AoS (SeqRegions): " << aos_time << " s" << std::endl;
+    std::cout << "SoA (SeqRegionsSoA): " << soa_time << " s" << std::endl;
+    std::cout << "Speedup (AoS time / SoA time): " << aos_time / soa_time
+              << std::endl;
+    std::cout << "Total cost: AoS " << std::setprecision(12) << total_cost_aos
+              << ", SoA " << total_cost_soa << std::endl;
+    if (total_cost_aos != total_cost_soa) {
+      throw std::logic_error("The two layouts give different placement costs");
+    }
+  }
+};
+}  // namespace cmaple
+
+using namespace cmaple;
+
+int main(int argc, char* argv[]) {
+  const std::string aln_path =
+      argc > 1 ? argv[1] : "example/test_5K.maple";
+  const std::string tree_path = argc > 2 ? argv[2] : "";
+  const size_t num_placements_per_subtree =
+      argc > 3 ? static_cast<size_t>(std::stoul(argv[3])) : 100;
+
+  try {
+    cmaple::verbose_mode = VB_QUIET;
+    Alignment aln(aln_path);
+    Model model(static_cast<PositionType>(aln.ref_seq.size()), false, false,
+                1.0, "", 20, 0, ModelBase::DEFAULT, aln.getSeqType());
+    Tree tree(&aln, &model, tree_path);
+    std::ostringstream placement_log;
+    tree.doPlacement(placement_log);
+
+    switch (aln.num_states) {
+      case 4:
+        SeqRegionsLayoutBenchmark::run<4>(tree, num_placements_per_subtree);
+        break;
+      case 20:
+        SeqRegionsLayoutBenchmark::run<20>(tree, num_placements_per_subtree);
+        break;
+      default:
+        throw std::invalid_argument(
+            "Sorry! currently we only support DNA and Protein data!");
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
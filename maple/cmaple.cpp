@@ -63,6 +63,32 @@ auto cmaple::isEffective(const Alignment &aln,
   return true;
 }
 
+/**
+ Place the samples read from params.place_stream_path on a (frozen) tree and
+ write their placements to a file
+ */
+static void placeStreamedSamples(Tree& tree, const Params& params,
+                                 const std::string& output_placement_file,
+                                 const bool refresh_lhs)
+{
+    if (cmaple::verbose_mode > cmaple::VB_QUIET)
+        std::cout << "Placing samples read from " << (params.place_stream_path == "-" ? "the standard input" : params.place_stream_path) << std::endl;
+    ofstream out = ofstream(output_placement_file);
+    if (params.place_stream_path == "-")
+    {
+        tree.placeStreamedSamples(std::cin, out, params.num_alt_placements, refresh_lhs);
+    }
+    else
+    {
+        ifstream in(params.place_stream_path);
+        if (!in.is_open())
+            throw std::invalid_argument(ERR_READ_INPUT + params.place_stream_path);
+        tree.placeStreamedSamples(in, out, params.num_alt_placements, refresh_lhs);
+        in.close();
+    }
+    out.close();
+}
+
 void cmaple::runCMAPLE(cmaple::Params &params)
 {
     try
@@ -74,12 +100,21 @@ void cmaple::runCMAPLE(cmaple::Params &params)
         const std::string prefix = (params.output_prefix.length() ? params.output_prefix :  params.aln_path);
         assert(prefix.length() > 0);
         const std::string output_treefile = prefix + ".treefile";
+        const std::string output_placement_file = prefix + ".placements.tsv";
+        // only place streamed samples on an input tree or a tree restored
+        // from a checkpoint (without inferring the tree)
+        const bool only_place_streamed_samples = params.place_stream_path.length() && (params.input_treefile.length() || params.restore_path.length());
         // check whether output file is already exists
-        if (!params.overwrite_output && fileExists(output_treefile)) {
+        if (!only_place_streamed_samples && !params.overwrite_output && fileExists(output_treefile)) {
           outError("File " + output_treefile +
                    " already exists. Use `--overwrite` option if you really "
                    "want to overwrite it.\n");
         }
+        if (params.place_stream_path.length() && !params.overwrite_output && fileExists(output_placement_file)) {
+          outError("File " + output_placement_file +
+                   " already exists. Use `--overwrite` option if you really "
+                   "want to overwrite it.\n");
+        }
 
         // Dummy variables
         const cmaple::Tree::TreeType tree_format = cmaple::Tree::parseTreeType(params.tree_format_str);
@@ -143,9 +178,37 @@ void cmaple::runCMAPLE(cmaple::Params &params)
             return;
         }
         
+        // Setup the number of threads (used when placing samples in batches,
+        // computing branch supports, etc.)
+        cmaple::setNumThreads(static_cast<int>(params.num_threads));
+        
         // Initialize a Tree
         Tree tree(&aln, &model, params.input_treefile, params.fixed_blengths, cmaple::make_unique<cmaple::Params>(params));
         
+        // Restore the tree and the model from a checkpoint (if users want to do so)
+        if (params.restore_path.length())
+        {
+            if (params.input_treefile.length())
+                throw std::invalid_argument("Cannot restore a checkpoint and read an input tree at the same time!");
+            if (cmaple::verbose_mode > cmaple::VB_QUIET)
+                std::cout << "Restoring the tree from " << params.restore_path << std::endl;
+            tree.loadCheckpoint(params.restore_path);
+        }
+        
+        // Place new samples on the frozen input/restored tree right away
+        // (without re-computing the likelihoods of the tree, which were
+        // computed when loading the input tree or kept in the checkpoint)
+        if (only_place_streamed_samples)
+        {
+            placeStreamedSamples(tree, params, output_placement_file, false);
+            if (cmaple::verbose_mode > cmaple::VB_QUIET)
+            {
+                std::cout << "Placements of streamed samples: " << output_placement_file << std::endl;
+                cout << "Runtime: " << getRealTime() - start << "s" << endl;
+            }
+            return;
+        }
+        
         // Infer a phylogenetic tree
         const cmaple::Tree::TreeSearchType tree_search_type = cmaple::Tree::parseTreeSearchType(params.tree_search_type_str);
         std::ostream null_stream(nullptr);
@@ -245,6 +308,15 @@ void cmaple::runCMAPLE(cmaple::Params &params)
         if (cmaple::verbose_mode > cmaple::VB_QUIET) {
           cout << "Runtime: " << end - start << "s" << endl;
         }
+        
+        // Place new samples read one by one from a stream on the (frozen) tree (if users want to do so)
+        // (the output file is shown once the stream is exhausted)
+        if (params.place_stream_path.length())
+        {
+            placeStreamedSamples(tree, params, output_placement_file, true);
+            if (cmaple::verbose_mode > cmaple::VB_QUIET)
+                std::cout << "Placements of streamed samples: " << output_placement_file << std::endl;
+        }
     }
     catch (std::invalid_argument& e)
     {
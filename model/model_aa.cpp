@@ -1,24 +1,18 @@
 #include "model_aa.h"
 #include "../libraries/nclextra/modelsblock.h"
-using namespace std;
-using namespace cmaple;
-
 /*
-    following are definitions for various protein models encoded in a string.
-    This string contains the lower triangle of the rate matrix and the state
-   frequencies at the end. It should follow the amino acid order: A   R   N   D
-   C   Q   E   G   H   I   L   K   M   F   P   S   T   W   Y   V Ala Arg Asn Asp
-   Cys Gln Glu Gly His Ile Leu Lys Met Phe Pro Ser Thr Trp Tyr Val
-
-   The actual data is pulled in via #include to avoid a thousand lines of 'code'
-   here (which will also upset the linter)
+    the definitions of the built-in protein models (in model_aa.nexus) are
+    converted into constexpr tables at build time (see model_aa_tables.cmake),
+    thus, we don't parse them at runtime. Each table contains the lower
+    triangle of the rate matrix (or the whole matrix of non-reversible models)
+    and the state frequencies at the end. It should follow the amino acid
+    order: A   R   N   D   C   Q   E   G   H   I   L   K   M   F   P   S   T   W
+    Y   V Ala Arg Asn Asp Cys Gln Glu Gly His Ile Leu Lys Met Phe Pro Ser Thr
+    Trp Tyr Val
 */
-const char* cmaple::builtin_prot_models =
-#include "model_aa.nexus"
-;
-/*R"(
-#include <model_aa.nexus>
-)";*/
+#include "model_aa_tables.h"
+using namespace std;
+using namespace cmaple;
 
 cmaple::ModelAA::ModelAA(const cmaple::ModelBase::SubModel sub_model)
     : ModelBase(sub_model, 20) {
@@ -55,20 +49,18 @@ void cmaple::ModelAA::initMutationMat() {
   // init the normalized factor
   normalized_factor = 1.0;
 
-  // read model params from string/file
-  bool reversible;
+  // find the model params among the built-in models
   assert(num_states_ == 20);
-  model_block = readModelsDefinition(builtin_prot_models);
-  if (model_block == nullptr) {
-    throw std::logic_error("model_block uninitialized");
-  }
-  NxsModel* nxs_model = model_block->findModel(name_upper);
-  if (nxs_model != nullptr) {
-    if (nxs_model->flag != NM_ATOMIC) {
-      throw std::logic_error("Invalid protein model name " + name_upper);
+  const BuiltinAAModel* builtin_model = nullptr;
+  for (const BuiltinAAModel& model : builtin_aa_models) {
+    if (name_upper == model.name) {
+      builtin_model = &model;
+      break;
     }
-
-    reversible = readParametersString(nxs_model->description);
+  }
+  if (builtin_model != nullptr) {
+    const bool reversible = builtin_model->reversible;
+    setParameters(builtin_model->params, reversible);
 
     // compute root_log_freqs and inverse_root_freqs
     for (StateType i = 0; i < num_states_; ++i) {
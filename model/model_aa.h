@@ -6,7 +6,20 @@
 
 namespace cmaple
 {
-    extern const char* builtin_prot_models;
+    /** A built-in protein model (see model_aa.nexus), whose tables are
+     generated at build time (model_aa_tables.h) */
+    struct BuiltinAAModel
+    {
+        /** The name of the model */
+        const char* name;
+
+        /** TRUE if the model is reversible */
+        bool reversible;
+
+        /** The lower triangle of the rate matrix (or the whole matrix if the
+         model is non-reversible), then the state frequencies */
+        const cmaple::RealNumType* params;
+    };
 
     /** Class of AA evolutionary models */
     class ModelAA: public ModelBase
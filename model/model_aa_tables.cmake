@@ -0,0 +1,76 @@
+# Generate model_aa_tables.h (the constexpr tables of the built-in protein
+# models) from model_aa.nexus, so that ModelAA doesn't parse the NEXUS
+# definitions at runtime. Each model of the NEXUS file has either
+# 190 + 20 parameters (the lower triangle of the rate matrix of a reversible
+# model, then the state frequencies) or 400 + 20 parameters (the whole rate
+# matrix of a non-reversible model, then the state frequencies).
+
+set(MODEL_AA_NEXUS "${CMAKE_CURRENT_SOURCE_DIR}/model_aa.nexus")
+set(MODEL_AA_TABLES "${CMAKE_CURRENT_BINARY_DIR}/model_aa_tables.h")
+
+# re-generate the tables whenever the definitions change
+set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${MODEL_AA_NEXUS}")
+
+file(READ "${MODEL_AA_NEXUS}" nexus)
+# remove the comments, and replace the semicolons (list separators in CMake)
+string(REGEX REPLACE "\\[[^]]*\\]" "" nexus "${nexus}")
+string(REPLACE ";" "|" nexus "${nexus}")
+string(REGEX MATCHALL "model[ \t\r\n]+[A-Za-z0-9._]+[ \t\r\n]*=[^|]*" models "${nexus}")
+
+set(tables "")
+set(entries "")
+foreach(model IN LISTS models)
+  string(REGEX REPLACE "^model[ \t\r\n]+([A-Za-z0-9._]+).*" "\\1" name "${model}")
+  string(REGEX REPLACE "^[^=]*=" "" params "${model}")
+  string(REGEX MATCHALL "[-+0-9.eE]+" params "${params}")
+  list(LENGTH params num_params)
+  if(num_params EQUAL 210)
+    set(reversible "true")
+  elseif(num_params EQUAL 420)
+    set(reversible "false")
+  else()
+    message(FATAL_ERROR "Protein model ${name} in ${MODEL_AA_NEXUS} has ${num_params} parameters (expected 210 or 420)")
+  endif()
+
+  # one row of the rate matrix (or the state frequencies) per line
+  string(REPLACE "." "_" table "AA_MODEL_${name}")
+  string(APPEND tables "inline constexpr cmaple::RealNumType ${table}[] = {\n")
+  set(line "")
+  if(reversible)
+    set(line_length 1)
+  else()
+    set(line_length 20)
+  endif()
+  set(num_values 0)
+  foreach(param IN LISTS params)
+    string(APPEND line " ${param},")
+    math(EXPR num_values "${num_values} + 1")
+    if(num_values EQUAL line_length)
+      string(APPEND tables "   ${line}\n")
+      set(line "")
+      set(num_values 0)
+      if(line_length LESS 20)
+        math(EXPR line_length "${line_length} + 1")
+      endif()
+    endif()
+  endforeach()
+  string(APPEND tables "};\n\n")
+  string(APPEND entries "    {\"${name}\", ${reversible}, ${table}},\n")
+endforeach()
+
+set(content "// Generated from model_aa.nexus by model_aa_tables.cmake. DO NOT EDIT!\n")
+string(APPEND content "#pragma once\n\n#include \"model/model_aa.h\"\n\nnamespace cmaple {\n")
+string(APPEND content "${tables}")
+string(APPEND content "/** The built-in protein models */\n")
+string(APPEND content "inline constexpr BuiltinAAModel builtin_aa_models[] = {\n${entries}};\n")
+string(APPEND content "}  // namespace cmaple\n")
+
+# only touch the header if it changed (to avoid needless re-compilations)
+if(EXISTS "${MODEL_AA_TABLES}")
+  file(READ "${MODEL_AA_TABLES}" old_content)
+else()
+  set(old_content "")
+endif()
+if(NOT content STREQUAL old_content)
+  file(WRITE "${MODEL_AA_TABLES}" "${content}")
+endif()
@@ -1,6 +1,7 @@
 #include "model_dna_rate_variation.h"
 #include "../tree/tree.h"
 #include "../tree/phylonode.h"
+#include <map>
 
 using namespace cmaple;
 
@@ -22,11 +23,9 @@ ModelDNARateVariation::ModelDNARateVariation(
     max_num_EM_steps = _max_num_EM_steps;
     fixed_EM_steps = _fixed_num_SSM_EM_steps;
 
-    mutation_matrices = new RealNumType[mat_size * genome_size]();
-    transposed_mutation_matrices = new RealNumType[mat_size * genome_size]();
-    diagonal_mutation_matrices = new RealNumType[num_states_ * genome_size]();
-    freqi_freqj_Qijs = new RealNumType[mat_size * genome_size]();
-    freqj_transposedijs = new RealNumType[mat_size * genome_size]();
+    // all sites share a single matrix until their rates are set
+    matrix_indexes.resize(genome_size, 0);
+    resizeMatrices(1);
 
     if(scalar_rate_model) {
         rates = new cmaple::RealNumType[genome_size]();
@@ -37,11 +36,6 @@ ModelDNARateVariation::ModelDNARateVariation(
 }
 
 ModelDNARateVariation::~ModelDNARateVariation() { 
-    delete[] mutation_matrices;
-    delete[] transposed_mutation_matrices;
-    delete[] diagonal_mutation_matrices;
-    delete[] freqi_freqj_Qijs;
-    delete[] freqj_transposedijs;
     if(scalar_rate_model) {
         delete[] rates;
     }
@@ -80,23 +74,137 @@ bool ModelDNARateVariation::updateMutationMatEmpirical() {
         std::cout << "[ModelDNARateVariation] Warning: Overwriting estimated rate matrices with single empirical mutation matrix." << std::endl;
     }
     bool val = ModelDNA::updateMutationMatEmpirical();
+    setGlobalMatrices();
+    return val;
+}
+
+void ModelDNARateVariation::resizeMatrices(uint32_t num_matrices) {
+    const size_t num_entries = static_cast<size_t>(mat_size) * num_matrices;
+    mutation_matrices.assign(num_entries, 0);
+    transposed_mutation_matrices.assign(num_entries, 0);
+    diagonal_mutation_matrices.assign(static_cast<size_t>(num_states_) * num_matrices, 0);
+    freqi_freqj_Qijs.assign(num_entries, 0);
+    freqj_transposedijs.assign(num_entries, 0);
+}
+
+void ModelDNARateVariation::setGlobalMatrices() {
+    resizeMatrices(1);
+    std::fill(matrix_indexes.begin(), matrix_indexes.end(), 0);
+    std::copy_n(mutation_mat, mat_size, mutation_matrices.begin());
+    std::copy_n(transposed_mut_mat, mat_size, transposed_mutation_matrices.begin());
+    std::copy_n(freqi_freqj_qij, mat_size, freqi_freqj_Qijs.begin());
+    std::copy_n(freq_j_transposed_ij, mat_size, freqj_transposedijs.begin());
+    std::copy_n(diagonal_mut_mat, num_states_, diagonal_mutation_matrices.begin());
+}
+
+PositionType ModelDNARateVariation::setSiteMatrices(RealNumType* site_matrices) {
+    // set the diagonal entries, then find the distinct matrices
+    std::map<std::vector<RealNumType>, uint32_t> distinct_matrices;
+    std::vector<const RealNumType*> matrices;
+    PositionType first_changed = diagonal_mutation_matrices.empty() ? 0 : genome_size;
     for(int i = 0; i < genome_size; i++) {
-        for(int j = 0; j < mat_size; j++) {
-            mutation_matrices[i * mat_size + j] = mutation_mat[j];
-            transposed_mutation_matrices[i * mat_size + j] = transposed_mut_mat[j];
-            freqi_freqj_Qijs[i * mat_size + j] = freqi_freqj_qij[j];
-            freqj_transposedijs[i * mat_size + j] = freq_j_transposed_ij[j];
+        RealNumType* matrix = site_matrices + (i * mat_size);
+        for(int stateA = 0; stateA < num_states_; stateA++) {
+            RealNumType row_sum = 0;
+            for(int stateB = 0; stateB < num_states_; stateB++) {
+                if(stateA != stateB) {
+                    row_sum += matrix[stateB + row_index[stateA]];
+                }
+            }
+            matrix[stateA + row_index[stateA]] = -row_sum;
+            if(first_changed == genome_size && -row_sum !=
+               diagonal_mutation_matrices[matrix_indexes[i] * num_states_ + stateA]) {
+                first_changed = i;
+            }
         }
-        for(int j = 0; j < num_states_; j++) {
-            diagonal_mutation_matrices[i * num_states_ + j] = diagonal_mut_mat[j];
+
+        const auto inserted = distinct_matrices.emplace(
+            std::vector<RealNumType>(matrix, matrix + mat_size),
+            static_cast<uint32_t>(matrices.size()));
+        if(inserted.second) {
+            matrices.push_back(matrix);
         }
+        matrix_indexes[i] = inserted.first->second;
+    }
+
+    // store each distinct matrix once, with the matrices derived from it
+    resizeMatrices(static_cast<uint32_t>(matrices.size()));
+    for(size_t m = 0; m < matrices.size(); m++) {
+        const RealNumType* matrix = matrices[m];
+        RealNumType* mutation_matrix = mutation_matrices.data() + (m * mat_size);
+        RealNumType* transposed_mutation_matrix = transposed_mutation_matrices.data() + (m * mat_size);
+        RealNumType* freqi_freqj_Qij = freqi_freqj_Qijs.data() + (m * mat_size);
+        for(int stateA = 0; stateA < num_states_; stateA++) {
+            for(int stateB = 0; stateB < num_states_; stateB++) {
+                RealNumType val = matrix[stateB + row_index[stateA]];
+                mutation_matrix[stateB + row_index[stateA]] = val;
+                transposed_mutation_matrix[stateA + row_index[stateB]] = val;
+                freqi_freqj_Qij[stateB + row_index[stateA]] = stateA == stateB ? val :
+                    root_freqs[stateA] * inverse_root_freqs[stateB] * val;
+            }
+            diagonal_mutation_matrices[m * num_states_ + stateA] = matrix[stateA + row_index[stateA]];
+        }
+
+        // pre-compute matrix to speedup (once the transposed matrix is complete)
+        for(int stateA = 0; stateA < num_states_; stateA++) {
+            setVecByProduct<4>(freqj_transposedijs.data() + (m * mat_size) + row_index[stateA],
+                               root_freqs, transposed_mutation_matrix + row_index[stateA]);
+        }
+    }
+    return first_changed;
+}
+
+void ModelDNARateVariation::writeCheckpoint(BinaryWriter& writer) const {
+    ModelDNA::writeCheckpoint(writer);
+
+    writer.write<PositionType>(genome_size);
+    writer.write<uint8_t>(scalar_rate_model);
+    writer.write<uint8_t>(rates_estimated);
+    writer.writeArray(matrix_indexes.data(), matrix_indexes.size());
+    writer.writeVector(mutation_matrices);
+    writer.writeVector(transposed_mutation_matrices);
+    writer.writeVector(diagonal_mutation_matrices);
+    writer.writeVector(freqi_freqj_Qijs);
+    writer.writeVector(freqj_transposedijs);
+    if(scalar_rate_model) {
+        writer.writeArray(rates, genome_size);
+    }
+}
+
+void ModelDNARateVariation::readCheckpoint(BinaryReader& reader) {
+    ModelDNA::readCheckpoint(reader);
+
+    const PositionType checkpoint_genome_size = reader.read<PositionType>();
+    const bool checkpoint_scalar_rate_model = reader.read<uint8_t>();
+    if(checkpoint_genome_size != genome_size || checkpoint_scalar_rate_model != scalar_rate_model) {
+        throw std::invalid_argument("The checkpoint was created with a different rate variation model!");
+    }
+    rates_estimated = reader.read<uint8_t>();
+    reader.readArray(matrix_indexes.data(), matrix_indexes.size());
+    reader.readVector(mutation_matrices);
+    reader.readVector(transposed_mutation_matrices);
+    reader.readVector(diagonal_mutation_matrices);
+    reader.readVector(freqi_freqj_Qijs);
+    reader.readVector(freqj_transposedijs);
+    const size_t num_matrices = getNumMatrices();
+    for(const uint32_t matrix_index : matrix_indexes) {
+        if(matrix_index >= num_matrices) {
+            throw std::logic_error("The checkpoint contains an invalid rate matrix index!");
+        }
+    }
+    if(scalar_rate_model) {
+        reader.readArray(rates, genome_size);
     }
-    return val;
 }
 
 void ModelDNARateVariation::estimateRates(cmaple::Tree* tree) {
     rates_estimated = true;
     if(rates_filename.size() == 0) {
+        // Each E-step needs the lower/upper lhs under the current rates, thus,
+        // every round refreshes them with computeLh(), whose post-order merges
+        // also yield the log-LK (under the rates the next E-step uses) at no
+        // extra traversal. A round thus walks the branches three times: the
+        // E-step, the lower lhs, and the upper lhs.
         RealNumType old_LK = -std::numeric_limits<double>::infinity();
         RealNumType new_LK = tree->computeLh();
 
@@ -110,8 +218,7 @@ void ModelDNARateVariation::estimateRates(cmaple::Tree* tree) {
 
         if(scalar_rate_model)
         {
-            estimateRatePerSite(tree);
-            tree->computeCumulativeRate();
+            tree->updateCumulativeRate(estimateRatePerSite(tree));
             new_LK = tree->computeLh();
             if(cmaple::verbose_mode > VB_MIN) 
             {
@@ -124,8 +231,7 @@ void ModelDNARateVariation::estimateRates(cmaple::Tree* tree) {
             {
                 for(int i = 0; i < fixed_EM_steps; i++)
                 {
-                    estimateRatesPerSitePerEntry(tree);
-                    tree->computeCumulativeRate();
+                    tree->updateCumulativeRate(estimateRatesPerSitePerEntry(tree));
                     new_LK = tree->computeLh();
                     if(cmaple::verbose_mode > VB_MIN) 
                     {
@@ -139,9 +245,9 @@ void ModelDNARateVariation::estimateRates(cmaple::Tree* tree) {
                 int num_steps = 0;
                 while(abs(new_LK - old_LK) > 1 && num_steps < max_num_EM_steps) 
                 {
-                    estimateRatesPerSitePerEntry(tree);
+                    const PositionType first_changed = estimateRatesPerSitePerEntry(tree);
                     old_LK = new_LK;
-                    tree->computeCumulativeRate();
+                    tree->updateCumulativeRate(first_changed);
                     new_LK = tree->computeLh();
                     if(cmaple::verbose_mode > VB_MIN) 
                     {
@@ -157,6 +263,7 @@ void ModelDNARateVariation::estimateRates(cmaple::Tree* tree) {
     // Write out rate matrices to file
     if(cmaple::verbose_mode > VB_MIN) 
     {
+        std::cout << "Number of distinct rate matrices: " << getNumMatrices() << std::endl;
         const std::string prefix = tree->params->output_prefix.length() ? 
             tree->params->output_prefix : tree->params->aln_path;
         //std::cout << "Writing rate matrices to file " << prefix << ".rateMatrices.txt" << std::endl;
@@ -177,198 +284,239 @@ void ModelDNARateVariation::estimateRates(cmaple::Tree* tree) {
     } 
 }
 
-void ModelDNARateVariation::estimateRatePerSite(cmaple::Tree* tree){
-    //std::cout << "Estimating mutation rate per site..." << std::endl;
-    RealNumType* waiting_times = new RealNumType[num_states_ * genome_size];
-    RealNumType* num_substitutions = new RealNumType[genome_size];
-    for(int i = 0; i < genome_size; i++) {
-        for(int j = 0; j < num_states_; j++) {
-            waiting_times[i * num_states_ + j] = 0;
-        }
-        num_substitutions[i] = 0;
-    }
-
+std::vector<NumSeqsType> ModelDNARateVariation::getBranchNodes(const cmaple::Tree* tree) const {
+    std::vector<NumSeqsType> branch_nodes;
+    branch_nodes.reserve(tree->nodes.size());
     std::stack<Index> node_stack;
     const PhyloNode& root = tree->nodes[tree->root_vector_index];
     node_stack.push(root.getNeighborIndex(RIGHT));
     node_stack.push(root.getNeighborIndex(LEFT));
     while(!node_stack.empty()) {
-
         Index index = node_stack.top();
         node_stack.pop();
-        PhyloNode& node = tree->nodes[index.getVectorIndex()];
-        RealNumType blength = node.getUpperLength();
-        //std::cout << "blength: " << blength  << std::endl;
+        const PhyloNode& node = tree->nodes[index.getVectorIndex()];
+        branch_nodes.push_back(index.getVectorIndex());
 
         if (node.isInternal()) {
             node_stack.push(node.getNeighborIndex(RIGHT));
             node_stack.push(node.getNeighborIndex(LEFT));
         }
+    }
+    return branch_nodes;
+}
 
-        if(blength <= 0.) {
-            continue;
-        }
-
-        Index parent_index = node.getNeighborIndex(TOP);
-        PhyloNode& parent_node = tree->nodes[parent_index.getVectorIndex()];
-        const std::unique_ptr<SeqRegions>& parent_regions = parent_node.getPartialLh(parent_index.getMiniIndex());
-        const std::unique_ptr<SeqRegions>& child_regions = node.getPartialLh(TOP);
+PositionType ModelDNARateVariation::getSiteBlockSize() const {
+    // a single block if running sequentially
+    int num_blocks = 1;
+#ifdef _OPENMP
+    if(omp_get_max_threads() > 1) {
+        num_blocks = SITE_BLOCKS_PER_THREAD * omp_get_max_threads();
+    }
+#endif
+    return std::max(1, (genome_size + num_blocks - 1) / num_blocks);
+}
 
-        PositionType pos = 0;
-        const SeqRegions& seqP_regions = *parent_regions;
-        const SeqRegions& seqC_regions = *child_regions;
-        size_t iseq1 = 0;
-        size_t iseq2 = 0;
+size_t ModelDNARateVariation::getRegionIndex(const SeqRegions& regions, PositionType pos) {
+    // the regions are sorted by their (end) positions
+    const auto region = std::lower_bound(regions.begin(), regions.end(), pos,
+        [](const SeqRegion& region, const PositionType position) {
+            return region.position < position;
+        });
+    return static_cast<size_t>(region - regions.begin());
+}
 
-        while(pos < genome_size) {
-            PositionType end_pos;
-            SeqRegions::getNextSharedSegment(pos, seqP_regions, seqC_regions, iseq1, iseq2, end_pos);
-            const auto* seqP_region = &seqP_regions[iseq1];
-            const auto* seqC_region = &seqC_regions[iseq2];
+PositionType ModelDNARateVariation::estimateRatePerSite(cmaple::Tree* tree){
+    //std::cout << "Estimating mutation rate per site..." << std::endl;
+    RealNumType* waiting_times = new RealNumType[num_states_ * genome_size];
+    RealNumType* num_substitutions = new RealNumType[genome_size];
+    for(int i = 0; i < genome_size; i++) {
+        for(int j = 0; j < num_states_; j++) {
+            waiting_times[i * num_states_ + j] = 0;
+        }
+        num_substitutions[i] = 0;
+    }
 
-            // if the child of this branch does not observe its state directly then 
-            // skip this branch.
-            if(seqC_region->plength_observation2node > 0) {
-                pos = end_pos + 1;
+    // Accumulate the contributions of the branches concurrently on blocks of
+    // sites. Each site still sums up the branches in the same order, thus,
+    // the estimates don't depend on the number of threads
+    const std::vector<NumSeqsType> branch_nodes = getBranchNodes(tree);
+    const PositionType block_size = getSiteBlockSize();
+    const int num_blocks = static_cast<int>((genome_size + block_size - 1) / block_size);
+#pragma omp parallel for schedule(dynamic)
+    for(int block = 0; block < num_blocks; block++) {
+        const PositionType block_start = block * block_size;
+        const PositionType block_end = std::min(block_start + block_size, genome_size) - 1;
+        for(const NumSeqsType vec_index : branch_nodes) {
+            PhyloNode& node = tree->nodes[vec_index];
+            RealNumType blength = node.getUpperLength();
+            //std::cout << "blength: " << blength  << std::endl;
+
+            if(blength <= 0.) {
                 continue;
             }
 
-            // distance to last observation or root if last observation was across the root.
-            RealNumType branch_length_to_observation = blength;
-            if(seqP_region->plength_observation2node > 0 && seqP_region->plength_observation2root < 0) {
-                branch_length_to_observation += seqP_region->plength_observation2node;
-            }
-            else if(seqP_region->plength_observation2root >= 0) {
-                branch_length_to_observation += seqP_region->plength_observation2root;
-            }
-
-            if(seqP_region->type == TYPE_R && seqC_region->type == TYPE_R) {
-                // both states are type REF
-                for(int i = pos; i <= end_pos; i++) {
-                    StateType state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(i)];
-                    waiting_times[i * num_states_ + state] += branch_length_to_observation;
-                }
-            }  else if(seqP_region->type == seqC_region->type && seqP_region->type < TYPE_R) {
-                // both states are equal but not of type REF
-                waiting_times[end_pos * num_states_ + seqP_region->type] += branch_length_to_observation;
-           
-            } else if(seqP_region->type <= TYPE_R && seqC_region->type <= TYPE_R) {
-                // both states are not equal
-                StateType parent_state = seqP_region->type;
-                StateType child_state = seqC_region->type;
-                if(seqP_region->type == TYPE_R) {
-                    parent_state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
-                }
-                if (seqC_region->type == TYPE_R) {
-                    child_state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
-                }
-                 // Case 1: Last observation was this side of the root node
-                if(seqP_region->plength_observation2root < 0) {
-                    waiting_times[end_pos * num_states_ + parent_state] += branch_length_to_observation / 2;
-                    waiting_times[end_pos * num_states_ + child_state] += branch_length_to_observation / 2;
-                    num_substitutions[end_pos] += 1;
-                } else {
-                    // Case 2: Last observation was the other side of the root.
-                    // In this case there are two further cases - the mutation happened either side of the root.
-                    // We calculate the relative likelihood of each case and use this to weight waiting times etc.
-                    RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
-                    RealNumType dist_to_observed = seqP_region->plength_observation2node;
-                    updateCountsAndWaitingTimesAcrossRoot(end_pos, parent_state, child_state, dist_to_root, dist_to_observed, waiting_times, num_substitutions);
-                }
-            } else if(seqP_region->type <= TYPE_R && seqC_region->type == TYPE_O) {
-                StateType parent_state = seqP_region->type;
-                if(seqP_region->type == TYPE_R) {
-                    parent_state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+            Index parent_index = node.getNeighborIndex(TOP);
+            PhyloNode& parent_node = tree->nodes[parent_index.getVectorIndex()];
+            const std::unique_ptr<SeqRegions>& parent_regions = parent_node.getPartialLh(parent_index.getMiniIndex());
+            const std::unique_ptr<SeqRegions>& child_regions = node.getPartialLh(TOP);
+
+            PositionType pos = block_start;
+            const SeqRegions& seqP_regions = *parent_regions;
+            const SeqRegions& seqC_regions = *child_regions;
+            size_t iseq1 = getRegionIndex(seqP_regions, block_start);
+            size_t iseq2 = getRegionIndex(seqC_regions, block_start);
+
+            while(pos <= block_end) {
+                PositionType end_pos;
+                SeqRegions::getNextSharedSegment(pos, seqP_regions, seqC_regions, iseq1, iseq2, end_pos);
+                end_pos = std::min(end_pos, block_end);
+                const auto* seqP_region = &seqP_regions[iseq1];
+                const auto* seqC_region = &seqC_regions[iseq2];
+
+                // if the child of this branch does not observe its state directly then 
+                // skip this branch.
+                if(seqC_region->plength_observation2node > 0) {
+                    pos = end_pos + 1;
+                    continue;
                 }
 
-                // Get weight vector giving the relative probabilities of observing
-                // each state at the O node.
-                std::vector<RealNumType> weight_vector = getRelativeProbabilityOfChildOStatesForRegion(seqC_region, parent_state, branch_length_to_observation, end_pos);
-
-                // Case 1: Last observation was this side of the root node
-                if(seqP_region->plength_observation2root < 0) {
-                    for(StateType child_state = 0; child_state < num_states_; child_state++) {
-                        RealNumType prob = weight_vector[child_state];
-                        if(child_state != parent_state) {
-                            num_substitutions[end_pos] += prob;
-                            waiting_times[end_pos * num_states_ + parent_state] += prob * branch_length_to_observation/2;
-                            waiting_times[end_pos * num_states_ + child_state] += prob * branch_length_to_observation/2;
-                        } else {
-                            waiting_times[end_pos * num_states_ + child_state] += prob * branch_length_to_observation;
-                        }
-                    }
-                } else {
-                    // Case 2: Last observation was the other side of the root.
-                    RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
-                    RealNumType dist_to_observed = seqP_region->plength_observation2node;
-                     for(StateType child_state = 0; child_state < num_states_; child_state++) {
-                        RealNumType prob = weight_vector[child_state];
-                        updateCountsAndWaitingTimesAcrossRoot(end_pos, parent_state, child_state, dist_to_root, dist_to_observed, waiting_times, num_substitutions, prob);
-                     }
+                // distance to last observation or root if last observation was across the root.
+                RealNumType branch_length_to_observation = blength;
+                if(seqP_region->plength_observation2node > 0 && seqP_region->plength_observation2root < 0) {
+                    branch_length_to_observation += seqP_region->plength_observation2node;
                 }
-            } else if(seqP_region->type == TYPE_O && seqC_region->type <= TYPE_R) {
-                StateType child_state = seqC_region->type;
-                if(seqC_region->type == TYPE_R) {
-                    child_state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+                else if(seqP_region->plength_observation2root >= 0) {
+                    branch_length_to_observation += seqP_region->plength_observation2root;
                 }
 
-                // Calculate a weight vector giving the relative probabilities of observing
-                // each state at the O node.
-                std::vector<RealNumType> weight_vector = getRelativeProbabilityOfParentOStatesForRegion(seqP_region, child_state, branch_length_to_observation, end_pos);
-
-                // Case 1: Last observation was this side of the root node 
-                if(seqP_region->plength_observation2root < 0) {
-                    for(StateType parent_state = 0; parent_state < num_states_; parent_state++) {
-                        RealNumType prob = weight_vector[parent_state];
-                        if(child_state != parent_state) {
-                            num_substitutions[end_pos] += prob;
-                            waiting_times[end_pos * num_states_ + parent_state] += prob * branch_length_to_observation/2;
-                            waiting_times[end_pos * num_states_ + child_state] += prob * branch_length_to_observation/2;
-                        } else {
-                            waiting_times[end_pos * num_states_ + parent_state] += prob * branch_length_to_observation;
-                        }
+                if(seqP_region->type == TYPE_R && seqC_region->type == TYPE_R) {
+                    // both states are type REF
+                    for(int i = pos; i <= end_pos; i++) {
+                        StateType state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(i)];
+                        waiting_times[i * num_states_ + state] += branch_length_to_observation;
                     }
-                } else {
-                    // Case 2: Last observation was the other side of the root.
-                    RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
-                    RealNumType dist_to_observed = seqP_region->plength_observation2node;
-                    for(StateType parent_state = 0; parent_state < num_states_; parent_state++) {
-                        RealNumType prob = weight_vector[parent_state];
-                        updateCountsAndWaitingTimesAcrossRoot(end_pos, parent_state, child_state, dist_to_root, dist_to_observed, waiting_times, num_substitutions, prob);
-                    }                    
-                } 
-            } else if(seqP_region->type == TYPE_O && seqC_region->type == TYPE_O) {
-                // Get weight vector giving the relative probabilities of observing
-                // each state at each of the O nodes.
-                std::vector<RealNumType> weight_vector = getRelativeProbabilityOfParentOChildOStatesForRegion(seqP_region, seqC_region, branch_length_to_observation, end_pos);
-
-                // Case 1: Last observation was this side of the root node
-                if(seqP_region->plength_observation2root < 0) {
-                    for(StateType parent_state = 0; parent_state < num_states_; parent_state++) {
+                }  else if(seqP_region->type == seqC_region->type && seqP_region->type < TYPE_R) {
+                    // both states are equal but not of type REF
+                    waiting_times[end_pos * num_states_ + seqP_region->type] += branch_length_to_observation;
+           
+                } else if(seqP_region->type <= TYPE_R && seqC_region->type <= TYPE_R) {
+                    // both states are not equal
+                    StateType parent_state = seqP_region->type;
+                    StateType child_state = seqC_region->type;
+                    if(seqP_region->type == TYPE_R) {
+                        parent_state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+                    }
+                    if (seqC_region->type == TYPE_R) {
+                        child_state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+                    }
+                     // Case 1: Last observation was this side of the root node
+                    if(seqP_region->plength_observation2root < 0) {
+                        waiting_times[end_pos * num_states_ + parent_state] += branch_length_to_observation / 2;
+                        waiting_times[end_pos * num_states_ + child_state] += branch_length_to_observation / 2;
+                        num_substitutions[end_pos] += 1;
+                    } else {
+                        // Case 2: Last observation was the other side of the root.
+                        // In this case there are two further cases - the mutation happened either side of the root.
+                        // We calculate the relative likelihood of each case and use this to weight waiting times etc.
+                        RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
+                        RealNumType dist_to_observed = seqP_region->plength_observation2node;
+                        updateCountsAndWaitingTimesAcrossRoot(end_pos, parent_state, child_state, dist_to_root, dist_to_observed, waiting_times, num_substitutions);
+                    }
+                } else if(seqP_region->type <= TYPE_R && seqC_region->type == TYPE_O) {
+                    StateType parent_state = seqP_region->type;
+                    if(seqP_region->type == TYPE_R) {
+                        parent_state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+                    }
+
+                    // Get weight vector giving the relative probabilities of observing
+                    // each state at the O node.
+                    std::vector<RealNumType> weight_vector = getRelativeProbabilityOfChildOStatesForRegion(seqC_region, parent_state, branch_length_to_observation, end_pos);
+
+                    // Case 1: Last observation was this side of the root node
+                    if(seqP_region->plength_observation2root < 0) {
                         for(StateType child_state = 0; child_state < num_states_; child_state++) {
-                            RealNumType prob = weight_vector[row_index[parent_state] + child_state];
+                            RealNumType prob = weight_vector[child_state];
                             if(child_state != parent_state) {
                                 num_substitutions[end_pos] += prob;
-                                waiting_times[end_pos * num_states_ + parent_state] +=  prob * branch_length_to_observation/2;
-                                waiting_times[end_pos * num_states_ + child_state] +=  prob * branch_length_to_observation/2;
+                                waiting_times[end_pos * num_states_ + parent_state] += prob * branch_length_to_observation/2;
+                                waiting_times[end_pos * num_states_ + child_state] += prob * branch_length_to_observation/2;
                             } else {
-                                waiting_times[end_pos * num_states_ + parent_state] +=  prob * branch_length_to_observation;
+                                waiting_times[end_pos * num_states_ + child_state] += prob * branch_length_to_observation;
                             }
                         }
+                    } else {
+                        // Case 2: Last observation was the other side of the root.
+                        RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
+                        RealNumType dist_to_observed = seqP_region->plength_observation2node;
+                         for(StateType child_state = 0; child_state < num_states_; child_state++) {
+                            RealNumType prob = weight_vector[child_state];
+                            updateCountsAndWaitingTimesAcrossRoot(end_pos, parent_state, child_state, dist_to_root, dist_to_observed, waiting_times, num_substitutions, prob);
+                         }
                     }
-                } else {
-                     // Case 2: Last observation was the other side of the root.
-                    RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
-                    RealNumType dist_to_observed = seqP_region->plength_observation2node;
-                    for(StateType parent_state = 0; parent_state < num_states_; parent_state++) {
-                        for(StateType child_state = 0; child_state < num_states_; child_state++) {
-                            RealNumType prob = weight_vector[row_index[parent_state] + child_state];
+                } else if(seqP_region->type == TYPE_O && seqC_region->type <= TYPE_R) {
+                    StateType child_state = seqC_region->type;
+                    if(seqC_region->type == TYPE_R) {
+                        child_state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+                    }
+
+                    // Calculate a weight vector giving the relative probabilities of observing
+                    // each state at the O node.
+                    std::vector<RealNumType> weight_vector = getRelativeProbabilityOfParentOStatesForRegion(seqP_region, child_state, branch_length_to_observation, end_pos);
+
+                    // Case 1: Last observation was this side of the root node 
+                    if(seqP_region->plength_observation2root < 0) {
+                        for(StateType parent_state = 0; parent_state < num_states_; parent_state++) {
+                            RealNumType prob = weight_vector[parent_state];
+                            if(child_state != parent_state) {
+                                num_substitutions[end_pos] += prob;
+                                waiting_times[end_pos * num_states_ + parent_state] += prob * branch_length_to_observation/2;
+                                waiting_times[end_pos * num_states_ + child_state] += prob * branch_length_to_observation/2;
+                            } else {
+                                waiting_times[end_pos * num_states_ + parent_state] += prob * branch_length_to_observation;
+                            }
+                        }
+                    } else {
+                        // Case 2: Last observation was the other side of the root.
+                        RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
+                        RealNumType dist_to_observed = seqP_region->plength_observation2node;
+                        for(StateType parent_state = 0; parent_state < num_states_; parent_state++) {
+                            RealNumType prob = weight_vector[parent_state];
                             updateCountsAndWaitingTimesAcrossRoot(end_pos, parent_state, child_state, dist_to_root, dist_to_observed, waiting_times, num_substitutions, prob);
+                        }                    
+                    } 
+                } else if(seqP_region->type == TYPE_O && seqC_region->type == TYPE_O) {
+                    // Get weight vector giving the relative probabilities of observing
+                    // each state at each of the O nodes.
+                    std::vector<RealNumType> weight_vector = getRelativeProbabilityOfParentOChildOStatesForRegion(seqP_region, seqC_region, branch_length_to_observation, end_pos);
+
+                    // Case 1: Last observation was this side of the root node
+                    if(seqP_region->plength_observation2root < 0) {
+                        for(StateType parent_state = 0; parent_state < num_states_; parent_state++) {
+                            for(StateType child_state = 0; child_state < num_states_; child_state++) {
+                                RealNumType prob = weight_vector[row_index[parent_state] + child_state];
+                                if(child_state != parent_state) {
+                                    num_substitutions[end_pos] += prob;
+                                    waiting_times[end_pos * num_states_ + parent_state] +=  prob * branch_length_to_observation/2;
+                                    waiting_times[end_pos * num_states_ + child_state] +=  prob * branch_length_to_observation/2;
+                                } else {
+                                    waiting_times[end_pos * num_states_ + parent_state] +=  prob * branch_length_to_observation;
+                                }
+                            }
                         }
-                    }                
-                }
-            } 
-            pos = end_pos + 1;
+                    } else {
+                         // Case 2: Last observation was the other side of the root.
+                        RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
+                        RealNumType dist_to_observed = seqP_region->plength_observation2node;
+                        for(StateType parent_state = 0; parent_state < num_states_; parent_state++) {
+                            for(StateType child_state = 0; child_state < num_states_; child_state++) {
+                                RealNumType prob = weight_vector[row_index[parent_state] + child_state];
+                                updateCountsAndWaitingTimesAcrossRoot(end_pos, parent_state, child_state, dist_to_root, dist_to_observed, waiting_times, num_substitutions, prob);
+                            }
+                        }                
+                    }
+                } 
+                pos = end_pos + 1;
+            }
         }
     }
 
@@ -386,38 +534,26 @@ void ModelDNARateVariation::estimateRatePerSite(cmaple::Tree* tree){
 
     // normalise so average rate is 1.
     RealNumType average_rate = rate_count / genome_size;
+    std::vector<RealNumType> site_matrices(static_cast<size_t>(mat_size) * genome_size);
     for(int i = 0; i < genome_size; i++) {
         rates[i] /= average_rate; 
         rates[i] = std::min(250.0, std::max(0.0001, rates[i]));
         for(int stateA = 0; stateA < num_states_; stateA++) {
-            RealNumType row_sum = 0;
             for(int stateB = 0; stateB < num_states_; stateB++) {
                 if(stateA != stateB) {
-                    RealNumType val = mutation_mat[stateB + row_index[stateA]] * rates[i];
-                    mutation_matrices[i * mat_size + (stateB + row_index[stateA])] = val;
-                    transposed_mutation_matrices[i * mat_size + (stateA + row_index[stateB])] = val;
-                    freqi_freqj_Qijs[i * mat_size + (stateB + row_index[stateA])] = root_freqs[stateA] * inverse_root_freqs[stateB] * val;
-                    row_sum += val;
+                    site_matrices[i * mat_size + (stateB + row_index[stateA])] = mutation_mat[stateB + row_index[stateA]] * rates[i];
                 }
             }
-            mutation_matrices[i * mat_size + (stateA + row_index[stateA])] = -row_sum;
-            transposed_mutation_matrices[i * mat_size + (stateA + row_index[stateA])] = -row_sum;
-            diagonal_mutation_matrices[i * num_states_ + stateA] = -row_sum;
-            freqi_freqj_Qijs[i * mat_size + (stateA + row_index[stateA])] = -row_sum;
-
-            // pre-compute matrix to speedup
-            const RealNumType* transposed_mut_mat_row = getTransposedMutationMatrixRow(stateA, i);
-            RealNumType* freqj_transposedijs_row = freqj_transposedijs + (i * mat_size) + row_index[stateA];
-            setVecByProduct<4>(freqj_transposedijs_row, root_freqs, transposed_mut_mat_row);
-        
         }
     }
+    const PositionType first_changed = setSiteMatrices(site_matrices.data());
 
     delete[] waiting_times;
     delete[] num_substitutions;
+    return first_changed;
 }
 
-void ModelDNARateVariation::estimateRatesPerSitePerEntry(cmaple::Tree* tree) {
+PositionType ModelDNARateVariation::estimateRatesPerSitePerEntry(cmaple::Tree* tree) {
 
     RealNumType* C = new RealNumType[genome_size * mat_size];
     RealNumType* W = new RealNumType[genome_size * num_states_];
@@ -429,187 +565,187 @@ void ModelDNARateVariation::estimateRatesPerSitePerEntry(cmaple::Tree* tree) {
             }
         }
     }
-    std::stack<Index> node_stack;
-    const PhyloNode& root = tree->nodes[tree->root_vector_index];
-    node_stack.push(root.getNeighborIndex(RIGHT));
-    node_stack.push(root.getNeighborIndex(LEFT));
-    while(!node_stack.empty()) {
-
-        Index index = node_stack.top();
-        node_stack.pop();
-        PhyloNode& node = tree->nodes[index.getVectorIndex()];
-        RealNumType blength = node.getUpperLength();
-
-        if (node.isInternal()) {
-            node_stack.push(node.getNeighborIndex(RIGHT));
-            node_stack.push(node.getNeighborIndex(LEFT));
-        }
-
-        if(blength <= 0.) {
-            continue;
-        }
-
-        Index parent_index = node.getNeighborIndex(TOP);
-        PhyloNode& parent_node = tree->nodes[parent_index.getVectorIndex()];
-        const std::unique_ptr<SeqRegions>& parent_regions = parent_node.getPartialLh(parent_index.getMiniIndex());
-        const std::unique_ptr<SeqRegions>& child_regions = node.getPartialLh(TOP);
-
-        PositionType pos = 0;
-        const SeqRegions& seqP_regions = *parent_regions;
-        const SeqRegions& seqC_regions = *child_regions;
-        size_t iseq1 = 0;
-        size_t iseq2 = 0;
-
-        while(pos < genome_size) {
-            PositionType end_pos;
-            SeqRegions::getNextSharedSegment(pos, seqP_regions, seqC_regions, iseq1, iseq2, end_pos);
-            const auto* seqP_region = &seqP_regions[iseq1];
-            const auto* seqC_region = &seqC_regions[iseq2];
-
-            // if the child of this branch does not observe its state directly then 
-            // skip this branch.
-            if(seqC_region->plength_observation2node > 0) {
-                pos = end_pos + 1;
+    // Accumulate the contributions of the branches concurrently on blocks of
+    // sites. Each site still sums up the branches in the same order, thus,
+    // the estimates don't depend on the number of threads
+    const std::vector<NumSeqsType> branch_nodes = getBranchNodes(tree);
+    const PositionType block_size = getSiteBlockSize();
+    const int num_blocks = static_cast<int>((genome_size + block_size - 1) / block_size);
+#pragma omp parallel for schedule(dynamic)
+    for(int block = 0; block < num_blocks; block++) {
+        const PositionType block_start = block * block_size;
+        const PositionType block_end = std::min(block_start + block_size, genome_size) - 1;
+        for(const NumSeqsType vec_index : branch_nodes) {
+            PhyloNode& node = tree->nodes[vec_index];
+            RealNumType blength = node.getUpperLength();
+
+            if(blength <= 0.) {
                 continue;
             }
 
-            // distance to last observation or root if last observation was across the root.
-            RealNumType branch_length_to_observation = blength;
-            if(seqP_region->plength_observation2node > 0 && seqP_region->plength_observation2root < 0) {
-                branch_length_to_observation += seqP_region->plength_observation2node;
-            }
-            else if(seqP_region->plength_observation2root >= 0) {
-                branch_length_to_observation += seqP_region->plength_observation2root;
-            }
-
-            if(seqP_region->type == TYPE_R && seqC_region->type == TYPE_R) {
-                // both states are type REF
-                for(int i = pos; i <= end_pos; i++) {
-                    StateType state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(i)];
-                    W[i * num_states_ + state] += branch_length_to_observation;
+            Index parent_index = node.getNeighborIndex(TOP);
+            PhyloNode& parent_node = tree->nodes[parent_index.getVectorIndex()];
+            const std::unique_ptr<SeqRegions>& parent_regions = parent_node.getPartialLh(parent_index.getMiniIndex());
+            const std::unique_ptr<SeqRegions>& child_regions = node.getPartialLh(TOP);
+
+            PositionType pos = block_start;
+            const SeqRegions& seqP_regions = *parent_regions;
+            const SeqRegions& seqC_regions = *child_regions;
+            size_t iseq1 = getRegionIndex(seqP_regions, block_start);
+            size_t iseq2 = getRegionIndex(seqC_regions, block_start);
+
+            while(pos <= block_end) {
+                PositionType end_pos;
+                SeqRegions::getNextSharedSegment(pos, seqP_regions, seqC_regions, iseq1, iseq2, end_pos);
+                end_pos = std::min(end_pos, block_end);
+                const auto* seqP_region = &seqP_regions[iseq1];
+                const auto* seqC_region = &seqC_regions[iseq2];
+
+                // if the child of this branch does not observe its state directly then 
+                // skip this branch.
+                if(seqC_region->plength_observation2node > 0) {
+                    pos = end_pos + 1;
+                    continue;
                 }
-            }  else if(seqP_region->type == seqC_region->type && seqP_region->type < TYPE_R) {
-                // both states are equal but not of type REF or O
-                W[end_pos * num_states_ + seqP_region->type] += branch_length_to_observation;                
-            } else if(seqP_region->type <= TYPE_R && seqC_region->type <= TYPE_R) {
-                //states are not equal but neither is O
-                StateType stateA = seqP_region->type;
-                StateType stateB = seqC_region->type;
-                if(seqP_region->type == TYPE_R) {
-                    stateA = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
-                }
-                if(seqC_region->type == TYPE_R) {
-                    stateB = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+
+                // distance to last observation or root if last observation was across the root.
+                RealNumType branch_length_to_observation = blength;
+                if(seqP_region->plength_observation2node > 0 && seqP_region->plength_observation2root < 0) {
+                    branch_length_to_observation += seqP_region->plength_observation2node;
                 }
-                // Case 1: Last observation was this side of the root node
-                if(seqP_region->plength_observation2root < 0) {
-                    W[end_pos * num_states_ + stateA] += branch_length_to_observation/2;
-                    W[end_pos * num_states_ + stateB] += branch_length_to_observation/2;
-                    C[end_pos * mat_size + stateB + row_index[stateA]] += 1;
-                } else {
-                    // Case 2: Last observation was the other side of the root.
-                    // In this case there are two further cases - the mutation happened either side of the root.
-                    // We calculate the relative likelihood of each case and use this to weight waiting times etc.
-                    RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
-                    RealNumType dist_to_observed = seqP_region->plength_observation2node;
-                    updateCountsAndWaitingTimesAcrossRoot(end_pos, stateA, stateB, dist_to_root, dist_to_observed, W, C);
-                }              
-            } else if(seqP_region->type <= TYPE_R && seqC_region->type == TYPE_O) {
-                StateType stateA = seqP_region->type;
-                if(seqP_region->type == TYPE_R) {
-                    stateA = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+                else if(seqP_region->plength_observation2root >= 0) {
+                    branch_length_to_observation += seqP_region->plength_observation2root;
                 }
 
-                // Get weight vector giving the relative probabilities of observing
-                // each state at the O node.
-                std::vector<RealNumType> weight_vector = getRelativeProbabilityOfChildOStatesForRegion(seqC_region, stateA, branch_length_to_observation, end_pos);
-
-                // Case 1: Last observation was this side of the root node
-                if(seqP_region->plength_observation2root < 0) {
-                    for(StateType stateB = 0; stateB < num_states_; stateB++) {
-                        RealNumType prob = weight_vector[stateB];
-                        if(stateB != stateA) {
-                            C[end_pos * mat_size + stateB + row_index[stateA]] += prob;
-
-                            W[end_pos * num_states_ + stateA] += prob * branch_length_to_observation/2;
-                            W[end_pos * num_states_ + stateB] += prob * branch_length_to_observation/2;
-                        } else {
-                            W[end_pos * num_states_ + stateA] += prob * branch_length_to_observation;
-                        }
+                if(seqP_region->type == TYPE_R && seqC_region->type == TYPE_R) {
+                    // both states are type REF
+                    for(int i = pos; i <= end_pos; i++) {
+                        StateType state = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(i)];
+                        W[i * num_states_ + state] += branch_length_to_observation;
                     }
-                } else {
-                    // Case 2: Last observation was the other side of the root.
-                    RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
-                    RealNumType dist_to_observed = seqP_region->plength_observation2node;
-                     for(StateType stateB = 0; stateB < num_states_; stateB++) {
-                        RealNumType prob = weight_vector[stateB];
-                        updateCountsAndWaitingTimesAcrossRoot(end_pos, stateA, stateB, dist_to_root, dist_to_observed, W, C, prob);
-                     }
-                }
-            } else if(seqP_region->type == TYPE_O && seqC_region->type <= TYPE_R) {
-                StateType stateB = seqC_region->type;
-                if(seqC_region->type == TYPE_R) {
-                    stateB = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
-                }
-                // Calculate a weight vector giving the relative probabilities of observing
-                // each state at the O node.
-                std::vector<RealNumType> weight_vector = getRelativeProbabilityOfParentOStatesForRegion(seqP_region, stateB, branch_length_to_observation, end_pos);
-
-                // Case 1: Last observation was this side of the root node
-                if(seqP_region->plength_observation2root < 0) {
-                    for(StateType stateA = 0; stateA < num_states_; stateA++) {
-                        RealNumType prob = weight_vector[stateA];
-                        if(stateB != stateA) {
-                            C[end_pos * mat_size + stateB + row_index[stateA]] += prob;
-
-                            W[end_pos * num_states_ + stateA] += prob * branch_length_to_observation/2;
-                            W[end_pos * num_states_ + stateB] += prob * branch_length_to_observation/2;
-                        } else {
-                            W[end_pos * num_states_ + stateA] += prob * branch_length_to_observation;
-                        }
+                }  else if(seqP_region->type == seqC_region->type && seqP_region->type < TYPE_R) {
+                    // both states are equal but not of type REF or O
+                    W[end_pos * num_states_ + seqP_region->type] += branch_length_to_observation;                
+                } else if(seqP_region->type <= TYPE_R && seqC_region->type <= TYPE_R) {
+                    //states are not equal but neither is O
+                    StateType stateA = seqP_region->type;
+                    StateType stateB = seqC_region->type;
+                    if(seqP_region->type == TYPE_R) {
+                        stateA = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
                     }
-                } else {
-                    // Case 2: Last observation was the other side of the root.
-                    RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
-                    RealNumType dist_to_observed = seqP_region->plength_observation2node;
-                    for(StateType stateA = 0; stateA < num_states_; stateA++) {
-                        RealNumType prob = weight_vector[stateA];
-                        updateCountsAndWaitingTimesAcrossRoot(end_pos, stateA, stateB, dist_to_root, dist_to_observed, W, C, prob);
-                    }               
-                }
-            } else if(seqP_region->type == TYPE_O && seqC_region->type == TYPE_O) {
-                // Get weight vector giving the relative probabilities of observing
-                // each state at each of the O nodes.
-                std::vector<RealNumType> weight_vector = getRelativeProbabilityOfParentOChildOStatesForRegion(seqP_region, seqC_region, branch_length_to_observation, end_pos);
-
-                // Case 1: Last observation was this side of the root node
-                if(seqP_region->plength_observation2root < 0) {
-                    for(StateType stateA = 0; stateA < num_states_; stateA++) {
+                    if(seqC_region->type == TYPE_R) {
+                        stateB = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+                    }
+                    // Case 1: Last observation was this side of the root node
+                    if(seqP_region->plength_observation2root < 0) {
+                        W[end_pos * num_states_ + stateA] += branch_length_to_observation/2;
+                        W[end_pos * num_states_ + stateB] += branch_length_to_observation/2;
+                        C[end_pos * mat_size + stateB + row_index[stateA]] += 1;
+                    } else {
+                        // Case 2: Last observation was the other side of the root.
+                        // In this case there are two further cases - the mutation happened either side of the root.
+                        // We calculate the relative likelihood of each case and use this to weight waiting times etc.
+                        RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
+                        RealNumType dist_to_observed = seqP_region->plength_observation2node;
+                        updateCountsAndWaitingTimesAcrossRoot(end_pos, stateA, stateB, dist_to_root, dist_to_observed, W, C);
+                    }              
+                } else if(seqP_region->type <= TYPE_R && seqC_region->type == TYPE_O) {
+                    StateType stateA = seqP_region->type;
+                    if(seqP_region->type == TYPE_R) {
+                        stateA = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+                    }
+
+                    // Get weight vector giving the relative probabilities of observing
+                    // each state at the O node.
+                    std::vector<RealNumType> weight_vector = getRelativeProbabilityOfChildOStatesForRegion(seqC_region, stateA, branch_length_to_observation, end_pos);
+
+                    // Case 1: Last observation was this side of the root node
+                    if(seqP_region->plength_observation2root < 0) {
                         for(StateType stateB = 0; stateB < num_states_; stateB++) {
-                            RealNumType prob = weight_vector[row_index[stateA] + stateB];
+                            RealNumType prob = weight_vector[stateB];
                             if(stateB != stateA) {
                                 C[end_pos * mat_size + stateB + row_index[stateA]] += prob;
 
-                                W[end_pos * num_states_ + stateA] +=  prob * branch_length_to_observation/2;
-                                W[end_pos * num_states_ + stateB] +=  prob * branch_length_to_observation/2;
+                                W[end_pos * num_states_ + stateA] += prob * branch_length_to_observation/2;
+                                W[end_pos * num_states_ + stateB] += prob * branch_length_to_observation/2;
                             } else {
-                                W[end_pos * num_states_ + stateA] +=  prob * branch_length_to_observation;
+                                W[end_pos * num_states_ + stateA] += prob * branch_length_to_observation;
                             }
                         }
+                    } else {
+                        // Case 2: Last observation was the other side of the root.
+                        RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
+                        RealNumType dist_to_observed = seqP_region->plength_observation2node;
+                         for(StateType stateB = 0; stateB < num_states_; stateB++) {
+                            RealNumType prob = weight_vector[stateB];
+                            updateCountsAndWaitingTimesAcrossRoot(end_pos, stateA, stateB, dist_to_root, dist_to_observed, W, C, prob);
+                         }
                     }
-                } else {
-                    // Case 2: Last observation was the other side of the root.
-                    RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
-                    RealNumType dist_to_observed = seqP_region->plength_observation2node;
-                    for(StateType stateA = 0; stateA < num_states_; stateA++) {
-                        for(StateType stateB = 0; stateB < num_states_; stateB++) {
-                            RealNumType prob = weight_vector[row_index[stateA] + stateB];
+                } else if(seqP_region->type == TYPE_O && seqC_region->type <= TYPE_R) {
+                    StateType stateB = seqC_region->type;
+                    if(seqC_region->type == TYPE_R) {
+                        stateB = tree->aln->ref_seq[static_cast<std::vector<cmaple::StateType>::size_type>(end_pos)];
+                    }
+                    // Calculate a weight vector giving the relative probabilities of observing
+                    // each state at the O node.
+                    std::vector<RealNumType> weight_vector = getRelativeProbabilityOfParentOStatesForRegion(seqP_region, stateB, branch_length_to_observation, end_pos);
+
+                    // Case 1: Last observation was this side of the root node
+                    if(seqP_region->plength_observation2root < 0) {
+                        for(StateType stateA = 0; stateA < num_states_; stateA++) {
+                            RealNumType prob = weight_vector[stateA];
+                            if(stateB != stateA) {
+                                C[end_pos * mat_size + stateB + row_index[stateA]] += prob;
+
+                                W[end_pos * num_states_ + stateA] += prob * branch_length_to_observation/2;
+                                W[end_pos * num_states_ + stateB] += prob * branch_length_to_observation/2;
+                            } else {
+                                W[end_pos * num_states_ + stateA] += prob * branch_length_to_observation;
+                            }
+                        }
+                    } else {
+                        // Case 2: Last observation was the other side of the root.
+                        RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
+                        RealNumType dist_to_observed = seqP_region->plength_observation2node;
+                        for(StateType stateA = 0; stateA < num_states_; stateA++) {
+                            RealNumType prob = weight_vector[stateA];
                             updateCountsAndWaitingTimesAcrossRoot(end_pos, stateA, stateB, dist_to_root, dist_to_observed, W, C, prob);
+                        }               
+                    }
+                } else if(seqP_region->type == TYPE_O && seqC_region->type == TYPE_O) {
+                    // Get weight vector giving the relative probabilities of observing
+                    // each state at each of the O nodes.
+                    std::vector<RealNumType> weight_vector = getRelativeProbabilityOfParentOChildOStatesForRegion(seqP_region, seqC_region, branch_length_to_observation, end_pos);
+
+                    // Case 1: Last observation was this side of the root node
+                    if(seqP_region->plength_observation2root < 0) {
+                        for(StateType stateA = 0; stateA < num_states_; stateA++) {
+                            for(StateType stateB = 0; stateB < num_states_; stateB++) {
+                                RealNumType prob = weight_vector[row_index[stateA] + stateB];
+                                if(stateB != stateA) {
+                                    C[end_pos * mat_size + stateB + row_index[stateA]] += prob;
+
+                                    W[end_pos * num_states_ + stateA] +=  prob * branch_length_to_observation/2;
+                                    W[end_pos * num_states_ + stateB] +=  prob * branch_length_to_observation/2;
+                                } else {
+                                    W[end_pos * num_states_ + stateA] +=  prob * branch_length_to_observation;
+                                }
+                            }
                         }
-                    }                
+                    } else {
+                        // Case 2: Last observation was the other side of the root.
+                        RealNumType dist_to_root = seqP_region->plength_observation2root + blength;
+                        RealNumType dist_to_observed = seqP_region->plength_observation2node;
+                        for(StateType stateA = 0; stateA < num_states_; stateA++) {
+                            for(StateType stateB = 0; stateB < num_states_; stateB++) {
+                                RealNumType prob = weight_vector[row_index[stateA] + stateB];
+                                updateCountsAndWaitingTimesAcrossRoot(end_pos, stateA, stateB, dist_to_root, dist_to_observed, W, C, prob);
+                            }
+                        }                
+                    }
                 }
+                pos = end_pos + 1;
             }
-            pos = end_pos + 1;
         }
     }
 
@@ -695,7 +831,8 @@ void ModelDNARateVariation::estimateRatesPerSitePerEntry(cmaple::Tree* tree) {
     delete[] global_waiting_times;
 
     RealNumType total_rate = 0;
-    // Update mutation matrices with new rate estimation
+    // Update mutation matrices with new rate estimation (in place of the
+    // counts)
     for(int i = 0; i < genome_size; i++) {
         RealNumType* Ci = C + (i * mat_size);
         RealNumType* Wi = W + (i * num_states_);
@@ -705,7 +842,7 @@ void ModelDNARateVariation::estimateRatesPerSitePerEntry(cmaple::Tree* tree) {
             for(int stateB = 0; stateB < num_states_; stateB++) {
                 if(stateA != stateB) { 
                     RealNumType new_rate = Ci[stateB + row_index[stateA]] / Wi[stateA];                
-                    mutation_matrices[i * mat_size + (stateB + row_index[stateA])] = new_rate;
+                    Ci[stateB + row_index[stateA]] = new_rate;
 
                     // Approximate total rate by considering rates from reference nucleotide
                     if(ref_state == stateA) {
@@ -721,37 +858,24 @@ void ModelDNARateVariation::estimateRatesPerSitePerEntry(cmaple::Tree* tree) {
     //RealNumType average_rate = total_rate / genome_size;
     for(int i = 0; i < genome_size; i++) {
         for(int stateA = 0; stateA < num_states_; stateA++) {
-            RealNumType row_sum = 0;
             for(int stateB = 0; stateB < num_states_; stateB++) {
                 if(stateA != stateB) {
-                    RealNumType val = mutation_matrices[i * mat_size + (stateB + row_index[stateA])];
+                    RealNumType val = C[i * mat_size + (stateB + row_index[stateA])];
                     //val /= average_rate;
                     val /= total_rate;
                     val = std::min(250.0, std::max(0.001, val)); 
 
-                    mutation_matrices[i * mat_size + (stateB + row_index[stateA])] = val;
-                    transposed_mutation_matrices[i * mat_size + (stateA + row_index[stateB])] = val;
-                    freqi_freqj_Qijs[i * mat_size + (stateB + row_index[stateA])] = root_freqs[stateA] * inverse_root_freqs[stateB] * val;
-
-                    row_sum += val;
+                    C[i * mat_size + (stateB + row_index[stateA])] = val;
                 } 
             }
-            mutation_matrices[i * mat_size + (stateA + row_index[stateA])] = -row_sum;
-            transposed_mutation_matrices[i * mat_size + (stateA + row_index[stateA])] = -row_sum;
-            diagonal_mutation_matrices[i * num_states_ + stateA] = -row_sum;
-            freqi_freqj_Qijs[i * mat_size + (stateA + row_index[stateA])] = -row_sum;
-
-            // pre-compute matrix to speedup
-            const RealNumType* transposed_mut_mat_row = getTransposedMutationMatrixRow(stateA, i);
-            RealNumType* freqj_transposedijs_row = freqj_transposedijs + (i * mat_size) + row_index[stateA];
-            setVecByProduct<4>(freqj_transposedijs_row, root_freqs, transposed_mut_mat_row);
-        
         }
     } 
+    const PositionType first_changed = setSiteMatrices(C);
 
     // Clean-up
     delete[] C;
     delete[] W;
+    return first_changed;
 }
 
 void ModelDNARateVariation::updateCountsAndWaitingTimesAcrossRoot( 
@@ -787,32 +911,35 @@ void ModelDNARateVariation::updateCountsAndWaitingTimesAcrossRoot(
 }
 
 void ModelDNARateVariation::setAllMatricesToDefault() {
-    for(int i = 0; i < genome_size; i++) {
-        for(int stateA = 0; stateA < num_states_; stateA++) {
-            RealNumType row_sum = 0;
-            for(int stateB = 0; stateB < num_states_; stateB++) {
-                mutation_matrices[i * mat_size + (stateB + row_index[stateA])] = mutation_mat[stateB + row_index[stateA]];
-                transposed_mutation_matrices[i * mat_size + (stateB + row_index[stateA])] = transposed_mut_mat[stateB + row_index[stateA]];
-                freqi_freqj_Qijs[i * mat_size + (stateB + row_index[stateA])] = freqi_freqj_qij[stateB + row_index[stateA]];
-            }
-
-            diagonal_mutation_matrices[i * num_states_ + stateA] = diagonal_mut_mat[stateA];
-
-            // pre-compute matrix to speedup
-            const RealNumType* transposed_mut_mat_row = getTransposedMutationMatrixRow(stateA, i);
-            RealNumType* freqj_transposedijs_row = freqj_transposedijs + (i * mat_size) + row_index[stateA];
-            setVecByProduct<4>(freqj_transposedijs_row, root_freqs, transposed_mut_mat_row);
-        
-        }
-    }  
+    setGlobalMatrices();
+    for(int stateA = 0; stateA < num_states_; stateA++) {
+        // pre-compute matrix to speedup
+        const RealNumType* transposed_mut_mat_row = transposed_mutation_matrices.data() + row_index[stateA];
+        RealNumType* freqj_transposedijs_row = freqj_transposedijs.data() + row_index[stateA];
+        setVecByProduct<4>(freqj_transposedijs_row, root_freqs, transposed_mut_mat_row);
+    }
 }
 
 void ModelDNARateVariation::setMatrixAtPosition(RealNumType* matrix, PositionType i) {
+    // give site i its own copy of its (possibly shared) matrices
+    const uint32_t old_index = matrix_indexes[i];
+    const uint32_t new_index = getNumMatrices();
+    mutation_matrices.resize(mutation_matrices.size() + mat_size);
+    transposed_mutation_matrices.resize(transposed_mutation_matrices.size() + mat_size);
+    diagonal_mutation_matrices.resize(diagonal_mutation_matrices.size() + num_states_);
+    freqi_freqj_Qijs.resize(freqi_freqj_Qijs.size() + mat_size);
+    freqj_transposedijs.resize(freqj_transposedijs.size() + mat_size);
+    std::copy_n(freqi_freqj_Qijs.begin() + old_index * mat_size, mat_size,
+                freqi_freqj_Qijs.begin() + new_index * mat_size);
+    std::copy_n(freqj_transposedijs.begin() + old_index * mat_size, mat_size,
+                freqj_transposedijs.begin() + new_index * mat_size);
+    matrix_indexes[i] = new_index;
+
     for(int stateA = 0; stateA < num_states_; stateA++) {
-        diagonal_mutation_matrices[i * num_states_ + stateA] = matrix[stateA + row_index[stateA]];
+        diagonal_mutation_matrices[new_index * num_states_ + stateA] = matrix[stateA + row_index[stateA]];
         for(int stateB = 0; stateB < num_states_; stateB++) {
-            mutation_matrices[i * mat_size + (stateB + row_index[stateA])] = matrix[stateB + row_index[stateA]];
-            transposed_mutation_matrices[i * mat_size + (stateB + row_index[stateA])] = matrix[stateA + row_index[stateB]];
+            mutation_matrices[new_index * mat_size + (stateB + row_index[stateA])] = matrix[stateB + row_index[stateA]];
+            transposed_mutation_matrices[new_index * mat_size + (stateB + row_index[stateA])] = matrix[stateA + row_index[stateB]];
         }
     }
 }
@@ -821,6 +948,7 @@ void ModelDNARateVariation::readRatesFile() {
     std::ifstream infile(rates_filename);
     std::string line;
     if (infile.is_open()) {
+        std::vector<RealNumType> site_matrices(static_cast<size_t>(mat_size) * genome_size);
         PositionType genome_position = 0;
         while (std::getline(infile, line)) {
             std::stringstream ss(line);
@@ -836,7 +964,7 @@ void ModelDNARateVariation::readRatesFile() {
                 std::cerr << "Expected exactly 12 entries." << std::endl;
                 continue;
             }
-            RealNumType* rate_matrix = mutation_matrices + (genome_position * mat_size);
+            RealNumType* rate_matrix = site_matrices.data() + (genome_position * mat_size);
             
             // A row
             rate_matrix[1] = std::stof(fields[0]);
@@ -867,30 +995,7 @@ void ModelDNARateVariation::readRatesFile() {
             return;
         }
 
-        for(int i = 0; i < genome_size; i++) {
-            for(int stateA = 0; stateA < num_states_; stateA++) {
-                RealNumType row_sum = 0;
-                for(int stateB = 0; stateB < num_states_; stateB++) {
-                    if(stateA != stateB) {
-                        RealNumType val = mutation_matrices[i * mat_size + (stateB + row_index[stateA])];
-                        mutation_matrices[i * mat_size + (stateB + row_index[stateA])] = val;
-                        transposed_mutation_matrices[i * mat_size + (stateA + row_index[stateB])] = val;
-                        freqi_freqj_Qijs[i * mat_size + (stateB + row_index[stateA])] = root_freqs[stateA] * inverse_root_freqs[stateB] * val;
-
-                        row_sum += val;
-                    } 
-                }
-                mutation_matrices[i * mat_size + (stateA + row_index[stateA])] = -row_sum;
-                transposed_mutation_matrices[i * mat_size + (stateA + row_index[stateA])] = -row_sum;
-                diagonal_mutation_matrices[i * num_states_ + stateA] = -row_sum;
-                freqi_freqj_Qijs[i * mat_size + (stateA + row_index[stateA])] = -row_sum;
-
-                // pre-compute matrix to speedup
-                const RealNumType* transposed_mut_mat_row = getTransposedMutationMatrixRow(stateA, i);
-                RealNumType* freqj_transposedijs_row = freqj_transposedijs + (i * mat_size) + row_index[stateA];
-                setVecByProduct<4>(freqj_transposedijs_row, root_freqs, transposed_mut_mat_row);      
-            }
-        } 
+        setSiteMatrices(site_matrices.data());
     }
     else {
         std::cerr << "Unable to open rate matrix file " << rates_filename << std::endl;
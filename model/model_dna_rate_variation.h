@@ -25,44 +25,52 @@ public:
 
     void estimateRates(cmaple::Tree* tree);
 
-    void estimateRatePerSite(cmaple::Tree* tree);
+    /**
+     Estimate the rate of each site (scalar rate variation)
+     @return the first site whose rate changed
+     */
+    cmaple::PositionType estimateRatePerSite(cmaple::Tree* tree);
 
-    void estimateRatesPerSitePerEntry(cmaple::Tree* tree);
+    /**
+     Estimate the rate matrix of each site (one EM step)
+     @return the first site whose rates changed
+     */
+    cmaple::PositionType estimateRatesPerSitePerEntry(cmaple::Tree* tree);
 
     virtual inline const cmaple::RealNumType *const getMutationMatrix(PositionType i) const override {
-        return mutation_matrices + (i * mat_size);
+        return mutation_matrices.data() + getMatrixOffset(i);
     }; 
 
     virtual inline const cmaple::RealNumType *const getMutationMatrixRow(StateType row, PositionType i) const override {
-        return mutation_matrices + (i * mat_size) + row_index[row];
+        return mutation_matrices.data() + getMatrixOffset(i) + row_index[row];
     }; 
 
     virtual inline const cmaple::RealNumType *const getTransposedMutationMatrix(PositionType i) const override {
-        return transposed_mutation_matrices + (i * mat_size);
+        return transposed_mutation_matrices.data() + getMatrixOffset(i);
     };
 
     virtual inline const cmaple::RealNumType *const getTransposedMutationMatrixRow(StateType row, PositionType i) const override {
-        return transposed_mutation_matrices + (i * mat_size) + row_index[row];
+        return transposed_mutation_matrices.data() + getMatrixOffset(i) + row_index[row];
     }; 
 
     virtual inline cmaple::RealNumType getMutationMatrixEntry(StateType row, StateType column, PositionType i) const override {
-        return mutation_matrices[i * mat_size + row_index[row] + column];
+        return mutation_matrices[getMatrixOffset(i) + row_index[row] + column];
     }
 
     virtual inline cmaple::RealNumType getTransposedMutationMatrixEntry(StateType row, StateType column, PositionType i) const override {
-        return transposed_mutation_matrices[i * mat_size + row_index[row] + column];
+        return transposed_mutation_matrices[getMatrixOffset(i) + row_index[row] + column];
     }
 
     virtual inline cmaple::RealNumType getDiagonalMutationMatrixEntry(StateType j, PositionType i) const override {
-        return diagonal_mutation_matrices[i * num_states_ + j];
+        return diagonal_mutation_matrices[matrix_indexes[i] * num_states_ + j];
     }
 
     virtual inline cmaple::RealNumType getFreqiFreqjQij(StateType row, StateType column, PositionType i) const override {
-        return freqi_freqj_Qijs[i * mat_size + row_index[row] + column];
+        return freqi_freqj_Qijs[getMatrixOffset(i) + row_index[row] + column];
     }
 
     virtual inline const cmaple::RealNumType* const getFreqjTransposedijRow(StateType row, PositionType i) const override {
-        return freqj_transposedijs + (i * mat_size) + row_index[row];
+        return freqj_transposedijs.data() + getMatrixOffset(i) + row_index[row];
     }
 
     const cmaple::RealNumType* const getOriginalRateMatrix() {
@@ -78,14 +86,63 @@ public:
    */
   virtual bool updateMutationMatEmpirical() override;
 
+  /**
+   Write the model parameters, including the matrices of all sites, into a
+   checkpoint
+   */
+  virtual void writeCheckpoint(BinaryWriter& writer) const override;
+
+  /**
+   Restore the model parameters from a checkpoint written by writeCheckpoint()
+   @throw std::invalid\_argument if the checkpoint was written by a different
+   model or for a genome of a different length
+   @throw std::logic\_error if the checkpoint is truncated
+   */
+  virtual void readCheckpoint(BinaryReader& reader) override;
+
   void setAllMatricesToDefault();
   void setMatrixAtPosition(RealNumType* matrix, PositionType i);
 
   void printMatrix(const RealNumType* matrix, std::ostream* out_stream);
   void printCountsAndWaitingTimes(const RealNumType* counts, const RealNumType* waiting_times, std::ostream* out_stream);
 
+  /**
+   Get the number of distinct rate matrices (shared by the sites)
+   */
+  uint32_t getNumMatrices() const {
+    return static_cast<uint32_t>(diagonal_mutation_matrices.size() / num_states_);
+  }
+
 private:
 
+    /**
+     Get the offset of the matrices of site i (in mutation_matrices, etc.)
+     */
+    inline size_t getMatrixOffset(PositionType i) const {
+        return static_cast<size_t>(matrix_indexes[i]) * mat_size;
+    }
+
+    /**
+     Resize the storage to num_matrices distinct matrices
+     */
+    void resizeMatrices(uint32_t num_matrices);
+
+    /**
+     Let all sites share the (global) matrices of the model
+     */
+    void setGlobalMatrices();
+
+    /**
+     Set the rate matrices of all sites from their off-diagonal entries.
+     Sites with the same matrix share a single copy of the matrix and of the
+     pre-computed matrices derived from it
+     @param site_matrices: genome_size x mat_size rates, whose diagonal
+     entries are overwritten by the negative row sums
+     @return the first site whose diagonal entries (thus, cumulative rates)
+     changed, or genome_size if none did
+     */
+    cmaple::PositionType setSiteMatrices(cmaple::RealNumType* site_matrices);
+
     void updateCountsAndWaitingTimesAcrossRoot( PositionType genome_pos, 
                                                 StateType parent_state, StateType child_state,
                                                 RealNumType dist_to_root, RealNumType dist_to_observed,
@@ -94,6 +151,23 @@ private:
     
     void readRatesFile();
 
+    /**
+     Get the nodes below all branches of the tree, in the (pre-)order the
+     contributions of the branches are summed up during the rate estimation
+     */
+    std::vector<cmaple::NumSeqsType> getBranchNodes(const cmaple::Tree* tree) const;
+
+    /**
+     Get the number of sites per block, when the rate estimation is split
+     into blocks of sites among threads
+     */
+    cmaple::PositionType getSiteBlockSize() const;
+
+    /**
+     Get the index of the region containing a site
+     */
+    static size_t getRegionIndex(const cmaple::SeqRegions& regions, cmaple::PositionType pos);
+
     std::vector<RealNumType> getRelativeProbabilityOfParentOStatesForRegion( const cmaple::SeqRegion* seqP_region, 
                                                                             StateType child_state, 
                                                                             RealNumType branch_length_to_obs,
@@ -109,11 +183,18 @@ private:
 
     cmaple::PositionType genome_size;
 
-    cmaple::RealNumType* mutation_matrices = nullptr;
-    cmaple::RealNumType* diagonal_mutation_matrices = nullptr;
-    cmaple::RealNumType* transposed_mutation_matrices = nullptr;
-    cmaple::RealNumType* freqi_freqj_Qijs = nullptr;
-    cmaple::RealNumType* freqj_transposedijs = nullptr;
+    /**
+     Index of the matrices of each site. The distinct matrices are stored
+     once, e.g., all sites share a single matrix until their rates are
+     estimated
+     */
+    std::vector<uint32_t> matrix_indexes;
+
+    std::vector<cmaple::RealNumType> mutation_matrices;
+    std::vector<cmaple::RealNumType> diagonal_mutation_matrices;
+    std::vector<cmaple::RealNumType> transposed_mutation_matrices;
+    std::vector<cmaple::RealNumType> freqi_freqj_Qijs;
+    std::vector<cmaple::RealNumType> freqj_transposedijs;
     cmaple::RealNumType* rates = nullptr;
     uint16_t mat_size;
     bool scalar_rate_model = false;
@@ -124,5 +205,11 @@ private:
     std::string rates_filename;
     int max_num_EM_steps;
     int fixed_EM_steps;
+
+    /**
+     Number of blocks of sites per thread in the rate estimation (to balance
+     the load among threads)
+     */
+    static constexpr int SITE_BLOCKS_PER_THREAD = 8;
 };
 }
\ No newline at end of file
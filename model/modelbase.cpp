@@ -406,6 +406,32 @@ void cmaple::ModelBase::readStateFreq(istream& in) {
     }
   }
 
+  normalizeStateFreqs();
+}
+
+void cmaple::ModelBase::setParameters(const RealNumType* params,
+                                      const bool is_reversible) {
+  assert(params);
+  assert(mutation_mat && root_freqs);
+
+  if (is_reversible) {
+    // the lower triangle of the rate matrix (row by row)
+    for (StateType row = 1; row < num_states_; ++row) {
+      std::copy_n(params, row, mutation_mat + row_index[row]);
+      params += row;
+    }
+  } else {
+    // the whole rate matrix
+    std::copy_n(params, row_index[num_states_], mutation_mat);
+    params += row_index[num_states_];
+  }
+  std::copy_n(params, num_states_, root_freqs);
+
+  normalizeStateFreqs();
+}
+
+void cmaple::ModelBase::normalizeStateFreqs() {
+  StateType i;
   RealNumType sum = 0.0;
   for (i = 0; i < num_states_; i++) {
     sum += root_freqs[i];
@@ -657,3 +683,60 @@ std::string cmaple::ModelBase::getModelName() const {
   // if not found -> return ""
   return "";
 }
+
+void cmaple::ModelBase::writeCheckpoint(BinaryWriter& writer) const {
+  assert(row_index && root_freqs && mutation_mat);
+
+  writer.write<int32_t>(sub_model);
+  writer.write<StateType>(num_states_);
+  writer.write<uint8_t>(fixed_params);
+  writer.write<RealNumType>(normalized_factor);
+
+  const StateType mat_size = row_index[num_states_];
+  writer.writeArray(root_freqs, num_states_);
+  writer.writeArray(root_log_freqs, num_states_);
+  writer.writeArray(inverse_root_freqs, num_states_);
+  writer.writeArray(diagonal_mut_mat, num_states_);
+  writer.writeArray(mutation_mat, mat_size);
+  writer.writeArray(transposed_mut_mat, mat_size);
+  writer.writeArray(freqi_freqj_qij, mat_size);
+  writer.writeArray(freq_j_transposed_ij, mat_size);
+
+  // pseudo mutation counts are not used by some models (e.g., JC)
+  writer.write<uint8_t>(pseu_mutation_count != nullptr);
+  if (pseu_mutation_count) {
+    writer.writeArray(pseu_mutation_count, mat_size);
+  }
+}
+
+void cmaple::ModelBase::readCheckpoint(BinaryReader& reader) {
+  assert(row_index && root_freqs && mutation_mat);
+
+  const SubModel checkpoint_sub_model =
+      static_cast<SubModel>(reader.read<int32_t>());
+  const StateType checkpoint_num_states = reader.read<StateType>();
+  if (checkpoint_sub_model != sub_model ||
+      checkpoint_num_states != num_states_) {
+    throw std::invalid_argument(
+        "The checkpoint was created with a different substitution model!");
+  }
+  fixed_params = reader.read<uint8_t>();
+  normalized_factor = reader.read<RealNumType>();
+
+  const StateType mat_size = row_index[num_states_];
+  reader.readArray(root_freqs, num_states_);
+  reader.readArray(root_log_freqs, num_states_);
+  reader.readArray(inverse_root_freqs, num_states_);
+  reader.readArray(diagonal_mut_mat, num_states_);
+  reader.readArray(mutation_mat, mat_size);
+  reader.readArray(transposed_mut_mat, mat_size);
+  reader.readArray(freqi_freqj_qij, mat_size);
+  reader.readArray(freq_j_transposed_ij, mat_size);
+
+  if (reader.read<uint8_t>()) {
+    if (!pseu_mutation_count) {
+      pseu_mutation_count = new RealNumType[mat_size];
+    }
+    reader.readArray(pseu_mutation_count, mat_size);
+  }
+}
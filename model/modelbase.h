@@ -5,6 +5,7 @@
 #include <istream>
 #include <string>
 #include "../alignment/alignment.h"
+#include "../utils/binaryio.h"
 #include "../utils/matrix.h"
 #include "../utils/tools.h"
 
@@ -67,6 +68,21 @@ class ModelBase {
    */
   bool readParametersString(std::string& model_str);
 
+  /**
+   Set model parameters from an array (e.g., the tables of the built-in
+   protein models)
+   @param[in] params The lower triangle of the rate matrix (or the whole
+   matrix if the model is non-reversible), then the state frequencies
+   @param[in] is_reversible TRUE if the model is reversible
+   */
+  void setParameters(const cmaple::RealNumType* params,
+                     const bool is_reversible);
+
+  /**
+   Normalize the root state frequencies so that they sum to 1
+   */
+  void normalizeStateFreqs();
+
   /**
    Read model's rates from string/file
    @throw std::logic\_error if unexpected values/behaviors found during the
@@ -380,6 +396,20 @@ public:
                                  const SeqRegions& regions1,
                                  const SeqRegions& regions2);
 
+  /**
+   Write the model parameters (including the pre-computed matrices) into a
+   checkpoint
+   */
+  virtual void writeCheckpoint(BinaryWriter& writer) const;
+
+  /**
+   Restore the model parameters from a checkpoint written by writeCheckpoint()
+   @throw std::invalid\_argument if the checkpoint was written by a different
+   model
+   @throw std::logic\_error if the checkpoint is truncated
+   */
+  virtual void readCheckpoint(BinaryReader& reader);
+
   /**
    Detect SeqType from a SubModel enum
    @param[in] sub_model SubModel enum
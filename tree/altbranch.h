@@ -18,4 +18,143 @@ namespace cmaple {
         // Branch id
         cmaple::Index branch_id;
     };
+
+    /** The alternative branches of all nodes (when compute SPRTA), stored
+     in a CSR-style arena: one flat array of alternative branches, and the
+     offset (and the number) of the alternative branches of each node
+     */
+    class AltBranches {
+    public:
+
+        /** The (read-only) alternative branches of a node
+         */
+        class Range {
+        public:
+            Range(const AltBranch* first_val, const AltBranch* last_val)
+                : first(first_val), last(last_val) {}
+
+            const AltBranch* begin() const { return first; }
+            const AltBranch* end() const { return last; }
+            size_t size() const { return static_cast<size_t>(last - first); }
+            const AltBranch& operator[](size_t i) const { return first[i]; }
+
+        private:
+            const AltBranch* first;
+            const AltBranch* last;
+        };
+
+        /** The number of nodes
+         */
+        size_t size() const { return counts.size(); }
+
+        /** Remove all alternative branches (of all nodes)
+         */
+        void clear() {
+            offsets.clear();
+            counts.clear();
+            branches.clear();
+            num_live_branches = 0;
+        }
+
+        /** Resize to a number of nodes, new nodes have no alternative branches
+         */
+        void resize(const size_t num_nodes) {
+            for (size_t i = num_nodes; i < counts.size(); ++i)
+                num_live_branches -= counts[i];
+            offsets.resize(num_nodes, 0);
+            counts.resize(num_nodes, 0);
+        }
+
+        /** Get the alternative branches of a node
+         */
+        Range operator[](const size_t node) const {
+            const AltBranch* first = branches.data() + offsets[node];
+            return Range(first, first + counts[node]);
+        }
+
+        /** Replace the alternative branches of a node
+         */
+        void set(const size_t node, const std::vector<AltBranch>& alt_branches) {
+            num_live_branches += alt_branches.size();
+            num_live_branches -= counts[node];
+
+            // overwrite the old entries if they have enough room, otherwise,
+            // append the new ones to the arena (the old ones become garbage)
+            if (alt_branches.size() > counts[node]) {
+                offsets[node] = branches.size();
+                branches.insert(branches.end(), alt_branches.begin(),
+                                alt_branches.end());
+            } else {
+                std::copy(alt_branches.begin(), alt_branches.end(),
+                          branches.begin() + static_cast<std::ptrdiff_t>(offsets[node]));
+            }
+            counts[node] = static_cast<uint32_t>(alt_branches.size());
+
+            // drop the garbage if it dominates the arena
+            if (branches.size() > 2 * num_live_branches + 1024)
+                compact();
+        }
+
+        /** Build the inverse, i.e., for each node, the nodes that could be
+         placed on the branch above it (with their supports), in the order of
+         the nodes
+         */
+        AltBranches inverse() const {
+            AltBranches inverse_branches;
+            const size_t num_nodes = size();
+            inverse_branches.offsets.assign(num_nodes, 0);
+            inverse_branches.counts.assign(num_nodes, 0);
+            for (size_t i = 0; i < num_nodes; ++i)
+                for (const AltBranch& alt_branch : (*this)[i])
+                    ++inverse_branches.counts[alt_branch.branch_id.getVectorIndex()];
+
+            uint64_t offset = 0;
+            for (size_t i = 0; i < num_nodes; ++i) {
+                inverse_branches.offsets[i] = offset;
+                offset += inverse_branches.counts[i];
+            }
+
+            inverse_branches.branches.reserve(offset);
+            inverse_branches.branches.resize(offset, AltBranch(0, Index()));
+            std::vector<uint64_t> next = inverse_branches.offsets;
+            for (size_t i = 0; i < num_nodes; ++i)
+                for (const AltBranch& alt_branch : (*this)[i])
+                    inverse_branches.branches[next[alt_branch.branch_id.getVectorIndex()]++]
+                        = AltBranch(alt_branch.lh, Index(static_cast<NumSeqsType>(i), TOP));
+            inverse_branches.num_live_branches = offset;
+
+            return inverse_branches;
+        }
+
+        /** Store the alternative branches contiguously in the order of the
+         nodes (without garbage)
+         */
+        void compact() {
+            std::vector<AltBranch> compacted_branches;
+            compacted_branches.reserve(num_live_branches);
+            for (size_t i = 0; i < counts.size(); ++i) {
+                const uint64_t offset = offsets[i];
+                offsets[i] = compacted_branches.size();
+                compacted_branches.insert(
+                    compacted_branches.end(),
+                    branches.begin() + static_cast<std::ptrdiff_t>(offset),
+                    branches.begin() + static_cast<std::ptrdiff_t>(offset + counts[i]));
+            }
+            branches.swap(compacted_branches);
+        }
+
+    private:
+
+        // the offset of the first alternative branch of each node
+        std::vector<uint64_t> offsets;
+
+        // the number of alternative branches of each node
+        std::vector<uint32_t> counts;
+
+        // the alternative branches of all nodes
+        std::vector<AltBranch> branches;
+
+        // the number of alternative branches that are not garbage
+        size_t num_live_branches = 0;
+    };
 }
@@ -0,0 +1,113 @@
+#include "mutationindex.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+using namespace cmaple;
+
+void cmaple::MutationIndex::clear() {
+  active_ = false;
+  postings_.clear();
+  node_mutations_.clear();
+}
+
+void cmaple::MutationIndex::removePosting(const uint64_t key,
+                                          const NumSeqsType vec_index) {
+  const auto it = postings_.find(key);
+  assert(it != postings_.end());
+  std::vector<NumSeqsType>& posting = it->second;
+  const auto node_it = std::find(posting.begin(), posting.end(), vec_index);
+  assert(node_it != posting.end());
+  *node_it = posting.back();
+  posting.pop_back();
+  if (posting.empty()) {
+    postings_.erase(it);
+  }
+}
+
+void cmaple::MutationIndex::updateNode(const SeqRegions* lower_regions,
+                                       const NumSeqsType vec_index,
+                                       const StateType num_states) {
+  if (node_mutations_.size() <= vec_index) {
+    node_mutations_.resize(vec_index + 1);
+  }
+
+  // the keys of the mutations now carried by the node (sorted as the regions
+  // are sorted by their positions)
+  std::vector<uint64_t> keys;
+  if (lower_regions) {
+    for (const SeqRegion& region : *lower_regions) {
+      if (isMutation(region, num_states)) {
+        keys.push_back(getKey(region.position, region.type));
+      }
+    }
+  }
+
+  // only update the postings of the mutations gained or lost
+  std::vector<uint64_t>& old_keys = node_mutations_[vec_index];
+  if (keys == old_keys) {
+    return;
+  }
+  auto old_it = old_keys.begin();
+  auto new_it = keys.begin();
+  while (old_it != old_keys.end() || new_it != keys.end()) {
+    if (new_it == keys.end() ||
+        (old_it != old_keys.end() && *old_it < *new_it)) {
+      removePosting(*old_it, vec_index);
+      ++old_it;
+    } else if (old_it == old_keys.end() || *new_it < *old_it) {
+      postings_[*new_it].push_back(vec_index);
+      ++new_it;
+    } else {
+      ++old_it;
+      ++new_it;
+    }
+  }
+  old_keys = std::move(keys);
+}
+
+void cmaple::MutationIndex::findCandidates(
+    const SeqRegions& sample_regions,
+    const StateType num_states,
+    const size_t max_num_candidates,
+    std::vector<NumSeqsType>& candidates) const {
+  candidates.clear();
+
+  // count the number of mutations shared between the sample and each node
+  std::unordered_map<NumSeqsType, PositionType> shared_counts;
+  PositionType num_sample_mutations = 0;
+  for (const SeqRegion& region : sample_regions) {
+    if (!isMutation(region, num_states)) {
+      continue;
+    }
+    ++num_sample_mutations;
+
+    const auto it = postings_.find(getKey(region.position, region.type));
+    if (it == postings_.end() || it->second.size() > MAX_POSTING_SIZE) {
+      continue;
+    }
+    for (const NumSeqsType vec_index : it->second) {
+      ++shared_counts[vec_index];
+    }
+  }
+
+  // rank the nodes by the number of distinct mutations between the sample
+  // and the node (ties are broken by the vector index to keep the results
+  // deterministic)
+  std::vector<std::pair<PositionType, NumSeqsType>> ranked;
+  ranked.reserve(shared_counts.size());
+  for (const auto& shared_count : shared_counts) {
+    const PositionType num_node_mutations = static_cast<PositionType>(
+        node_mutations_[shared_count.first].size());
+    const PositionType num_diffs = num_sample_mutations + num_node_mutations -
+                                   shared_count.second - shared_count.second;
+    ranked.emplace_back(num_diffs, shared_count.first);
+  }
+  const size_t num_candidates = std::min(max_num_candidates, ranked.size());
+  std::partial_sort(ranked.begin(), ranked.begin() + num_candidates,
+                    ranked.end());
+  for (size_t i = 0; i < num_candidates; ++i) {
+    candidates.push_back(ranked[i].second);
+  }
+}
@@ -0,0 +1,101 @@
+#include "../alignment/seqregions.h"
+#include <unordered_map>
+
+#pragma once
+
+namespace cmaple {
+/** An inverted index from mutations (position, state) to the nodes whose lower
+ * regions carry them, i.e., the leaves with that mutation and the internal
+ * nodes whose whole subtree supports it. It is used to pick the nodes from
+ * which the placement of a sample is sought. The entries of a node must be
+ * updated (see updateNode()) whenever its lower regions change, e.g., when
+ * placing samples or applying SPR moves */
+class MutationIndex {
+ private:
+  /**
+   Mutations carried by more than this number of nodes are considered
+   uninformative and skipped when seeking candidates
+   */
+  static constexpr size_t MAX_POSTING_SIZE = 10000;
+
+  /**
+   TRUE if the index is in use, i.e., it was built and must be kept up to date
+   */
+  bool active_ = false;
+
+  /**
+   Map from a mutation (see getKey()) to the vector indexes of the nodes
+   carrying that mutation (unordered)
+   */
+  std::unordered_map<uint64_t, std::vector<cmaple::NumSeqsType>> postings_;
+
+  /**
+   The (sorted) keys of the mutations carried by each node (indexed by the
+   vector index of the node)
+   */
+  std::vector<std::vector<uint64_t>> node_mutations_;
+
+  /**
+   Encode a mutation into a key
+   */
+  static uint64_t getKey(const cmaple::PositionType position,
+                         const cmaple::StateType state) {
+    return (static_cast<uint64_t>(position) << 8) | state;
+  }
+
+  /**
+   Check if a region represents a mutation (i.e., a specific state that may
+   differ from the reference)
+   */
+  static bool isMutation(const SeqRegion& region,
+                         const cmaple::StateType num_states) {
+    return region.type < num_states;
+  }
+
+  /**
+   Remove a node from the posting of a mutation
+   */
+  void removePosting(const uint64_t key, const cmaple::NumSeqsType vec_index);
+
+ public:
+  /**
+   Remove all entries and stop using the index
+   */
+  void clear();
+
+  /**
+   Start using the index (entries are then added by updateNode())
+   */
+  void activate() { active_ = true; }
+
+  /**
+   Check if the index is in use
+   */
+  bool isActive() const { return active_; }
+
+  /**
+   (Re-)index the mutations of a node
+   @param lower_regions the lower regions of the node (null to remove the node
+   from the index)
+   @param vec_index the vector index of the node
+   @param num_states the number of states
+   */
+  void updateNode(const SeqRegions* lower_regions,
+                  const cmaple::NumSeqsType vec_index,
+                  const cmaple::StateType num_states);
+
+  /**
+   Find the nodes that best match a sample, i.e., those having the smallest
+   number of mutations that differ from the sample's ones
+   @param sample_regions the lower regions of the sample
+   @param num_states the number of states
+   @param max_num_candidates the maximum number of candidates to return
+   @param candidates the output nodes (the best one first); empty if the
+   sample doesn't share any (informative) mutation with the indexed nodes
+   */
+  void findCandidates(const SeqRegions& sample_regions,
+                      const cmaple::StateType num_states,
+                      const size_t max_num_candidates,
+                      std::vector<cmaple::NumSeqsType>& candidates) const;
+};
+}  // namespace cmaple
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "tree.h"
+#include "../alignment/seqregionssoa.h"
+
+namespace cmaple {
+/** Narrow access to the placement cost of subtrees of a tree, in either
+ * layout of the regions (SeqRegions or SeqRegionsSoA), e.g., to compare the
+ * layouts (see benchmark/seqregions_layout.cpp)
+ */
+class PlacementCostAccess {
+ public:
+  /**
+   Constructor
+   @param tree A tree with all the likelihoods computed
+   */
+  explicit PlacementCostAccess(Tree& tree) : tree_(tree) {}
+
+  /**
+   Get the lower regions and the mid-branch regions of all nodes (if any)
+   @param[out] lower_regions The lower regions
+   @param[out] mid_branch_regions The mid-branch regions
+   */
+  void getRegions(std::vector<const SeqRegions*>& lower_regions,
+                  std::vector<const SeqRegions*>& mid_branch_regions) const {
+    for (PhyloNode& node : tree_.nodes) {
+      if (node.getPartialLh(TOP)) {
+        lower_regions.push_back(node.getPartialLh(TOP).get());
+      }
+      if (node.getMidBranchLh()) {
+        mid_branch_regions.push_back(node.getMidBranchLh().get());
+      }
+    }
+  }
+
+  /**
+   Get the default branch length of the tree
+   */
+  cmaple::RealNumType getDefaultBlength() const {
+    return tree_.default_blength;
+  }
+
+  /**
+   Calculate the placement cost of a subtree (see
+   Tree::calculateSubTreePlacementCostRegions())
+   */
+  template <const cmaple::StateType num_states, typename RegionsType>
+  cmaple::RealNumType calculateSubTreePlacementCost(
+      const RegionsType& parent_regions,
+      const RegionsType& child_regions,
+      const cmaple::RealNumType blength) const {
+    return tree_.calculateSubTreePlacementCostRegions<num_states>(
+        parent_regions, child_regions, blength);
+  }
+
+ private:
+  /**
+   The tree
+   */
+  Tree& tree_;
+};
+}  // namespace cmaple
@@ -1,8 +1,12 @@
 #include "tree.h"
 #include "../model/model_dna_rate_variation.h"
+#include "../alignment/seqregionssoa.h"
 
 #include <utils/matrix.h>
+#include <algorithm>
 #include <cassert>
+#include <queue>
+#include <sstream>
 
 using namespace std;
 using namespace cmaple;
@@ -116,6 +120,269 @@ void cmaple::Tree::load(const std::string& tree_filename,
   }
 }
 
+void cmaple::Tree::saveCheckpoint(std::ostream& checkpoint_stream,
+                                  const RealNumType lh) {
+  assert(aln && model && cumulative_rate);
+
+  // Make sure the tree is not empty
+  if (!nodes.size()) {
+    throw std::logic_error(
+        "Tree is empty. Please build/infer a tree from the alignment first!");
+  }
+
+  BinaryWriter writer(checkpoint_stream);
+  const StateType num_states = aln->num_states;
+  const PositionType seq_length = static_cast<PositionType>(aln->ref_seq.size());
+
+  // header & the sequences that the tree was built from
+  writer.write<uint64_t>(CHECKPOINT_MAGIC);
+  writer.write<uint32_t>(CHECKPOINT_VERSION);
+  writer.write<StateType>(num_states);
+  writer.write<PositionType>(seq_length);
+  writer.write<uint64_t>(seq_names.size());
+  for (const std::string& seq_name : seq_names) {
+    writer.writeString(seq_name);
+  }
+  writer.writeVector(sequence_added);
+  writer.write<RealNumType>(lh);
+
+  // model (as a block, to detect model mismatches when restoring) &
+  // cumulative rates (the cumulative bases are rebuilt from the ref genome)
+  std::ostringstream model_stream;
+  BinaryWriter model_writer(model_stream);
+  model->writeCheckpoint(model_writer);
+  writer.writeString(model_stream.str());
+  writer.writeArray(cumulative_rate, seq_length + 1);
+
+  // tree
+  writer.write<uint8_t>(fixed_blengths);
+  writer.write<NumSeqsType>(root_vector_index);
+  writer.write<NumSeqsType>(num_exiting_nodes);
+  writer.write<uint64_t>(nodes.size());
+  for (PhyloNode& node : nodes) {
+    writer.write<uint8_t>(node.isInternal());
+    writer.write<uint8_t>(node.isOutdated());
+    writer.write<uint8_t>(node.getSPRCount());
+    writer.write<RealNumType>(node.getUpperLength());
+    if (node.isInternal()) {
+      writer.write<NumSeqsType>(node.getNodelhIndex());
+      for (const MiniIndex mini_index : {TOP, LEFT, RIGHT}) {
+        writer.write<Index>(node.getNeighborIndex(mini_index));
+        SeqRegions::writeCheckpoint(writer, node.getPartialLh(mini_index),
+                                    num_states);
+      }
+    } else {
+      writer.write<NumSeqsType>(node.getSeqNameIndex());
+      writer.writeVector(node.getLessInfoSeqs());
+      writer.write<Index>(node.getNeighborIndex(TOP));
+      SeqRegions::writeCheckpoint(writer, node.getPartialLh(TOP), num_states);
+    }
+    SeqRegions::writeCheckpoint(writer, node.getTotalLh(), num_states);
+    SeqRegions::writeCheckpoint(writer, node.getMidBranchLh(), num_states);
+  }
+
+  // branch supports & SPRTA
+  writer.write<uint8_t>(aLRT_SH_computed);
+  writer.write<uint64_t>(node_lhs.size());
+  for (const NodeLh& node_lh : node_lhs) {
+    writer.write<RealNumType>(node_lh.getLhContribution());
+    writer.write<RealNumType>(node_lh.getLhDiff2());
+    writer.write<RealNumType>(node_lh.getLhDiff3());
+    writer.write<RealNumType>(node_lh.get_aLRT_SH());
+  }
+  writer.write<uint64_t>(annotations.size());
+  for (const std::string& annotation : annotations) {
+    writer.writeString(annotation);
+  }
+  writer.writeVector(sprta_scores);
+  writer.writeVector(root_supports);
+  writer.write<uint64_t>(sprta_alt_branches.size());
+  for (size_t i = 0; i < sprta_alt_branches.size(); ++i) {
+    const AltBranches::Range alt_branches = sprta_alt_branches[i];
+    writer.write<uint64_t>(alt_branches.size());
+    for (const AltBranch& alt_branch : alt_branches) {
+      writer.write<RealNumType>(alt_branch.lh);
+      writer.write<Index>(alt_branch.branch_id);
+    }
+  }
+}
+
+void cmaple::Tree::saveCheckpoint(const std::string& checkpoint_filename,
+                                  const RealNumType lh) {
+  // Validate input
+  if (!checkpoint_filename.length()) {
+    throw std::invalid_argument("The checkpoint file name is empty");
+  }
+
+  // write to a temporary file, then replace the checkpoint file, thus, an
+  // interrupted run never leaves a truncated checkpoint
+  writeFileAtomically(
+      checkpoint_filename,
+      [this, lh](std::ostream& out) { saveCheckpoint(out, lh); }, true);
+}
+
+void cmaple::Tree::loadCheckpoint(std::istream& checkpoint_stream) {
+  assert(aln && model);
+
+  // read the whole checkpoint at once
+  BinaryReader reader(checkpoint_stream);
+
+  // validate the header & the sequences
+  if (reader.read<uint64_t>() != CHECKPOINT_MAGIC ||
+      reader.read<uint32_t>() != CHECKPOINT_VERSION) {
+    throw std::invalid_argument(
+        "Not a checkpoint, or a checkpoint created by a different version!");
+  }
+  const StateType num_states = reader.read<StateType>();
+  const PositionType seq_length = reader.read<PositionType>();
+  const uint64_t num_seqs = reader.read<uint64_t>();
+  bool same_aln = num_states == aln->num_states &&
+                  seq_length == static_cast<PositionType>(aln->ref_seq.size()) &&
+                  num_seqs == aln->data.size();
+  for (uint64_t i = 0; i < num_seqs && same_aln; ++i) {
+    same_aln = reader.readString() == aln->data[i].seq_name;
+  }
+  if (!same_aln) {
+    throw std::invalid_argument(
+        "The checkpoint was created from a different alignment!");
+  }
+  seq_names.resize(num_seqs);
+  for (uint64_t i = 0; i < num_seqs; ++i) {
+    seq_names[i] = aln->data[i].seq_name;
+  }
+  reader.readVector(sequence_added);
+  const RealNumType lh = reader.read<RealNumType>();
+  if (!std::isnan(lh) && cmaple::verbose_mode >= cmaple::VB_MED) {
+    std::cout << std::setprecision(10)
+              << "Tree log likelihood (when the checkpoint was saved): " << lh
+              << std::endl;
+  }
+
+  // model & cumulative rates
+  std::istringstream model_stream(reader.readString());
+  BinaryReader model_reader(model_stream);
+  bool same_model = true;
+  try {
+    model->readCheckpoint(model_reader);
+    same_model = model_reader.atEnd();
+  } catch (std::invalid_argument const&) {
+    throw;
+  } catch (std::logic_error const&) {
+    // the model data is shorter than expected
+    same_model = false;
+  }
+  if (!same_model) {
+    throw std::invalid_argument(
+        "The checkpoint was created with a different substitution model!");
+  }
+  if (cumulative_rate == nullptr) {
+    cumulative_rate = new RealNumType[seq_length + 1];
+  }
+  reader.readArray(cumulative_rate, seq_length + 1);
+  // the cumulative bases only depend on the ref genome
+  cumulative_base.build(aln->ref_seq, num_states);
+
+  // tree
+  fixed_blengths = reader.read<uint8_t>();
+  root_vector_index = reader.read<NumSeqsType>();
+  num_exiting_nodes = reader.read<NumSeqsType>();
+  const uint64_t num_nodes = reader.read<uint64_t>();
+  nodes.clear();
+  nodes.reserve(std::max(num_nodes, static_cast<uint64_t>(num_seqs + num_seqs)));
+  for (uint64_t i = 0; i < num_nodes; ++i) {
+    const bool is_internal = reader.read<uint8_t>();
+    const bool outdated = reader.read<uint8_t>();
+    const uint8_t spr_count = reader.read<uint8_t>();
+    const RealNumType length = reader.read<RealNumType>();
+    if (is_internal) {
+      nodes.emplace_back(InternalNode());
+      PhyloNode& node = nodes.back();
+      node.setNodeLhIndex(reader.read<NumSeqsType>());
+      for (const MiniIndex mini_index : {TOP, LEFT, RIGHT}) {
+        node.setNeighborIndex(mini_index, reader.read<Index>());
+        node.setPartialLh(mini_index,
+                          SeqRegions::readCheckpoint(reader, num_states));
+      }
+    } else {
+      nodes.emplace_back(LeafNode(reader.read<NumSeqsType>()));
+      PhyloNode& node = nodes.back();
+      reader.readVector(node.getLessInfoSeqs());
+      node.setNeighborIndex(TOP, reader.read<Index>());
+      node.setPartialLh(TOP, SeqRegions::readCheckpoint(reader, num_states));
+    }
+    PhyloNode& node = nodes.back();
+    node.setOutdated(outdated);
+    node.setSPRCount(spr_count);
+    node.setUpperLength(length);
+    node.setTotalLh(SeqRegions::readCheckpoint(reader, num_states));
+    node.setMidBranchLh(SeqRegions::readCheckpoint(reader, num_states));
+  }
+
+  // branch supports & SPRTA
+  aLRT_SH_computed = reader.read<uint8_t>();
+  const uint64_t num_node_lhs = reader.read<uint64_t>();
+  node_lhs.clear();
+  node_lhs.reserve(num_node_lhs);
+  for (uint64_t i = 0; i < num_node_lhs; ++i) {
+    node_lhs.emplace_back(reader.read<RealNumType>());
+    NodeLh& node_lh = node_lhs.back();
+    node_lh.setLhDiff2(reader.read<RealNumType>());
+    node_lh.setLhDiff3(reader.read<RealNumType>());
+    node_lh.set_aLRT_SH(reader.read<RealNumType>());
+  }
+  annotations.resize(reader.read<uint64_t>());
+  for (std::string& annotation : annotations) {
+    annotation = reader.readString();
+  }
+  reader.readVector(sprta_scores);
+  reader.readVector(root_supports);
+  sprta_alt_branches.clear();
+  sprta_alt_branches.resize(reader.read<uint64_t>());
+  std::vector<AltBranch> alt_branches;
+  for (size_t i = 0; i < sprta_alt_branches.size(); ++i) {
+    const uint64_t num_alt_branches = reader.read<uint64_t>();
+    alt_branches.clear();
+    alt_branches.reserve(num_alt_branches);
+    for (uint64_t j = 0; j < num_alt_branches; ++j) {
+      const RealNumType lh = reader.read<RealNumType>();
+      alt_branches.emplace_back(lh, reader.read<Index>());
+    }
+    sprta_alt_branches.set(i, alt_branches);
+  }
+
+  // reset the data derived from the previous tree
+  sprta_support_list.clear();
+  num_descendants.clear();
+  internal_names.clear();
+  mutation_index.clear();
+  spr_gains.clear();
+  spr_outdated_rounds.clear();
+
+  // record the current tree in the list of trees that the alignment is attached
+  // to
+  aln->attached_trees.insert(this);
+}
+
+void cmaple::Tree::loadCheckpoint(const std::string& checkpoint_filename) {
+  // Validate input
+  if (!checkpoint_filename.length()) {
+    throw std::invalid_argument("The checkpoint file name is empty");
+  }
+
+  std::ifstream checkpoint_stream;
+  try {
+    checkpoint_stream.exceptions(ios::failbit | ios::badbit);
+    checkpoint_stream.open(checkpoint_filename, ios::binary);
+    // reading till the end of the file sets the failbit
+    checkpoint_stream.exceptions(ios::badbit);
+    loadCheckpoint(checkpoint_stream);
+    checkpoint_stream.close();
+  } catch (ios::failure const& e) {
+    std::string error_msg(ERR_READ_INPUT);
+    throw ios::failure(error_msg + checkpoint_filename);
+  }
+}
+
 void cmaple::Tree::changeAln(Alignment* n_aln) {
   assert(n_aln);
   assert(changeAlnPtr);
@@ -135,6 +402,15 @@ void cmaple::Tree::doPlacement(std::ostream& out_stream) {
   (this->*doPlacementPtr)(out_stream);
 }
 
+void cmaple::Tree::placeStreamedSamples(std::istream& seq_stream,
+                                        std::ostream& placement_stream,
+                                        const int num_alt_placements,
+                                        const bool refresh_lhs) {
+  assert(placeStreamedSamplesPtr);
+  (this->*placeStreamedSamplesPtr)(seq_stream, placement_stream,
+                                   num_alt_placements, refresh_lhs);
+}
+
 void cmaple::Tree::doRateEstimation(std::ostream& out_stream) {
   assert(doRateEstimationPtr);
   (this->*doRateEstimationPtr)(out_stream);
@@ -252,6 +528,7 @@ void cmaple::Tree::setupFuncPtrs() {
       doInferencePtr = &Tree::doInferenceTemplate<4>;
       computeLhPtr = &Tree::computeLhTemplate<4>;
       computeBranchSupportPtr = &Tree::computeBranchSupportTemplate<4>;
+      placeStreamedSamplesPtr = &Tree::placeStreamedSamplesTemplate<4>;
       makeTreeInOutConsistentPtr = &Tree::makeTreeInOutConsistentTemplate<4>;
       break;
     case 20:
@@ -265,6 +542,7 @@ void cmaple::Tree::setupFuncPtrs() {
       doInferencePtr = &Tree::doInferenceTemplate<20>;
       computeLhPtr = &Tree::computeLhTemplate<20>;
       computeBranchSupportPtr = &Tree::computeBranchSupportTemplate<20>;
+      placeStreamedSamplesPtr = &Tree::placeStreamedSamplesTemplate<20>;
       makeTreeInOutConsistentPtr = &Tree::makeTreeInOutConsistentTemplate<20>;
       break;
 
@@ -398,6 +676,11 @@ void cmaple::Tree::loadTreeTemplate(std::istream& tree_stream,
   node_lhs.emplace_back(0);
   // reset sequence_added
   resetSeqAdded();
+  // reset the mutation index (built from the leaves of the previous tree)
+  mutation_index.clear();
+  // reset the SPR priorities
+  spr_gains.clear();
+  spr_outdated_rounds.clear();
 
   // read tree from the input treefile
   PositionType in_line = 1;
@@ -591,6 +874,12 @@ void cmaple::Tree::doInferenceTemplate(
   // 1. Do placement to build an initial tree
   doPlacement(out_stream);
 
+  // 1.1 Save the initial tree (if requested), from which the inference could
+  // be resumed
+  if (params->checkpoint_path.length()) {
+    saveCheckpoint(params->checkpoint_path);
+  }
+
   // 1.5 Calculate rates if rate variation
   doRateEstimation(out_stream);
 
@@ -673,6 +962,26 @@ void cmaple::Tree::doPlacementTemplate(std::ostream& out_stream) {
     ++i;
   }
 
+  // index the mutations of the existing nodes (if requested)
+  mutation_index.clear();
+  if (params->use_mutation_index) {
+    indexAllNodes();
+  }
+
+  // sequences identical to a previous sequence (their representative) are not
+  // placed but added as less-informative sequences of the leaf of their
+  // representative at the end
+  const bool group_identical_seqs = params->group_identical_seqs &&
+                                    aln->representative_seqs.size() == num_seqs;
+  std::vector<NumSeqsType> identical_seqs;
+
+  // place other samples in batches (if requested)
+  if (params->placement_batch_size > 1) {
+    placeSamplesInBatches<num_states>(i, num_new_sequences, from_input_tree,
+                                      group_identical_seqs, identical_seqs);
+    i = num_seqs;
+  }
+
   // iteratively place other samples (sequences)
   for (; i < num_seqs; ++i, ++sequence) {
       // show progress
@@ -694,10 +1003,6 @@ void cmaple::Tree::doPlacementTemplate(std::ostream& out_stream) {
       sequence_added[i] = true;
     }
 
-    // get the lower likelihood vector of the current sequence
-    std::unique_ptr<SeqRegions> lower_regions =
-        sequence->getLowerLhVector(seq_length, num_states, aln->getSeqType());
-
     // update the mutation matrix from empirical number of mutations observed
     // from the recent sequences (if allowed)
     if (!(i % (static_cast<std::vector<cmaple::Sequence>
@@ -707,36 +1012,41 @@ void cmaple::Tree::doPlacementTemplate(std::ostream& out_stream) {
       }
     }
 
+    // defer sequences identical to a previous sequence
+    if (group_identical_seqs && aln->representative_seqs[i] != i) {
+      identical_seqs.push_back(static_cast<NumSeqsType>(i));
+      continue;
+    }
+
+    // get the lower likelihood vector of the current sequence
+    std::unique_ptr<SeqRegions> lower_regions =
+        sequence->getLowerLhVector(seq_length, num_states, aln->getSeqType());
+
     // NHANLT: debug
     // if ((*sequence)->seq_name == "39")
     //    cout << "debug" <<endl;
 
     // seek a position for new sample placement
-    Index selected_node_index;
-    RealNumType best_lh_diff = MIN_NEGATIVE;
-    bool is_mid_branch = false;
-    RealNumType best_up_lh_diff = MIN_NEGATIVE;
-    RealNumType best_down_lh_diff = MIN_NEGATIVE;
-    Index best_child_index;
-    seekSamplePlacement<num_states>(
-        Index(root_vector_index, TOP), static_cast<NumSeqsType>(i),
-        lower_regions, selected_node_index, best_lh_diff, is_mid_branch,
-        best_up_lh_diff, best_down_lh_diff, best_child_index);
+    SamplePlacement placement;
+    seekSamplePlacementFromSeeds<num_states>(static_cast<NumSeqsType>(i),
+                                             lower_regions, placement);
 
     // if new sample is not less informative than existing nodes (~selected_node
     // != NULL) -> place the new sample in the existing tree
-    if (selected_node_index.getMiniIndex() != UNDEFINED) {
+    if (placement.selected_node_index.getMiniIndex() != UNDEFINED) {
       // place new sample as a descendant of a mid-branch point
-      if (is_mid_branch) {
-        placeNewSampleMidBranch<num_states>(selected_node_index, lower_regions,
-                                    static_cast<NumSeqsType>(i), best_lh_diff);
+      if (placement.is_mid_branch) {
+        placeNewSampleMidBranch<num_states>(
+            placement.selected_node_index, lower_regions,
+            static_cast<NumSeqsType>(i), placement.best_lh_diff);
         // otherwise, best lk so far is for appending directly to existing
         // node
       } else {
-        placeNewSampleAtNode<num_states>(selected_node_index, lower_regions,
-                                         static_cast<NumSeqsType>(i),
-                                         best_lh_diff, best_up_lh_diff,
-                                         best_down_lh_diff, best_child_index);
+        placeNewSampleAtNode<num_states>(
+            placement.selected_node_index, lower_regions,
+            static_cast<NumSeqsType>(i), placement.best_lh_diff,
+            placement.best_up_lh_diff, placement.best_down_lh_diff,
+            placement.best_child_index);
       }
     }
 
@@ -754,6 +1064,11 @@ void cmaple::Tree::doPlacementTemplate(std::ostream& out_stream) {
     //}
   }
 
+  // add the deferred identical sequences into the tree
+  if (!identical_seqs.empty()) {
+    attachIdenticalSeqs(identical_seqs);
+  }
+
   // flag denotes whether there is any new nodes added
   // show the number of new sequences added to the tree
   if (num_new_sequences > 0) {
@@ -874,11 +1189,461 @@ void cmaple::Tree::doPlacementTemplate(std::ostream& out_stream) {
   cout.rdbuf(src_cout);
 }
 
+template <const StateType num_states>
+void cmaple::Tree::placeSamplesInBatches(
+    std::vector<cmaple::Sequence>::size_type seq_index,
+    std::vector<cmaple::Sequence>::size_type& num_new_sequences,
+    const bool from_input_tree,
+    const bool group_identical_seqs,
+    std::vector<NumSeqsType>& identical_seqs) {
+  // dummy variables
+  const PositionType seq_length = static_cast<PositionType>(aln->ref_seq.size());
+  const std::vector<cmaple::Sequence>::size_type num_seqs = aln->data.size();
+  const std::vector<cmaple::Sequence>::size_type batch_size =
+      static_cast<std::vector<cmaple::Sequence>::size_type>(
+          params->placement_batch_size);
+  const std::vector<cmaple::Sequence>::size_type mutation_update_period =
+      static_cast<std::vector<cmaple::Sequence>::size_type>(
+          params->mutation_update_period);
+  std::vector<cmaple::Sequence>::size_type count_every_1K = 0;
+  std::vector<NumSeqsType> batch_seqs;
+  batch_seqs.reserve(batch_size);
+  std::vector<std::unique_ptr<SeqRegions>> batch_regions(batch_size);
+  std::vector<SamplePlacement> batch_placements(batch_size);
+  // flags denote which nodes were changed by samples added from the current
+  // batch
+  std::vector<bool> touched_nodes;
+
+  while (seq_index < num_seqs) {
+    // collect the next batch of samples
+    bool update_mutation_mat = false;
+    batch_seqs.clear();
+    for (; seq_index < num_seqs && batch_seqs.size() < batch_size;
+         ++seq_index) {
+      // don't add sequence that was already added in the input tree
+      if (from_input_tree && sequence_added[seq_index]) {
+        --num_new_sequences;
+        continue;
+      }
+      sequence_added[seq_index] = true;
+
+      // the mutation matrix is updated (at most) once per batch
+      if (!(seq_index % mutation_update_period)) {
+        update_mutation_mat = true;
+      }
+
+      // defer sequences identical to a previous sequence
+      if (group_identical_seqs &&
+          aln->representative_seqs[seq_index] != seq_index) {
+        identical_seqs.push_back(static_cast<NumSeqsType>(seq_index));
+        continue;
+      }
+      batch_seqs.push_back(static_cast<NumSeqsType>(seq_index));
+    }
+
+    // show progress
+    if (cmaple::verbose_mode >= cmaple::VB_MED) {
+      if (seq_index - count_every_1K >= 1000) {
+        std::cout << "Processed " << seq_index << " samples" << std::endl;
+        count_every_1K = seq_index;
+      }
+    }
+
+    // update the mutation matrix from empirical number of mutations observed
+    // from the recent sequences (if allowed)
+    if (update_mutation_mat && model->updateMutationMatEmpirical()) {
+      computeCumulativeRate();
+    }
+
+    // seek the placements of all samples in the batch concurrently, without
+    // changing the tree
+    const int num_batch_seqs = static_cast<int>(batch_seqs.size());
+#pragma omp parallel for schedule(dynamic)
+    for (int j = 0; j < num_batch_seqs; ++j) {
+      batch_regions[j] = aln->data[batch_seqs[j]].getLowerLhVector(
+          seq_length, num_states, aln->getSeqType());
+      batch_placements[j] = SamplePlacement();
+      seekSamplePlacementFromSeeds<num_states>(
+          batch_seqs[j], batch_regions[j], batch_placements[j], true);
+    }
+
+    // add the samples into the tree one by one (in the input order)
+    touched_nodes.assign(nodes.size(), false);
+    for (int j = 0; j < num_batch_seqs; ++j) {
+      SamplePlacement& placement = batch_placements[j];
+      const NumSeqsType seq_name_index = batch_seqs[j];
+      const NumSeqsType selected_node_vec =
+          placement.selected_node_index.getVectorIndex();
+
+      // the new sample is less informative than an existing leaf (which is
+      // never changed by adding other samples)
+      if (placement.selected_node_index.getMiniIndex() == UNDEFINED) {
+        nodes[selected_node_vec].addLessInfoSeqs(seq_name_index);
+        continue;
+      }
+
+      // re-seek the placement if the selected branch was changed by earlier
+      // samples in this batch
+      if (touched_nodes[selected_node_vec] ||
+          (placement.best_child_index.getMiniIndex() != UNDEFINED &&
+           touched_nodes[placement.best_child_index.getVectorIndex()])) {
+        placement = SamplePlacement();
+        seekSamplePlacementFromSeeds<num_states>(
+            seq_name_index, batch_regions[j], placement);
+
+        // the sample was added as a less-informative sequence
+        if (placement.selected_node_index.getMiniIndex() == UNDEFINED) {
+          continue;
+        }
+      }
+
+      // mark the nodes whose upper branches will be changed
+      const NumSeqsType placed_node_vec =
+          placement.selected_node_index.getVectorIndex();
+      if (placed_node_vec < touched_nodes.size()) {
+        touched_nodes[placed_node_vec] = true;
+      }
+      if (placement.best_child_index.getMiniIndex() != UNDEFINED &&
+          placement.best_child_index.getVectorIndex() < touched_nodes.size()) {
+        touched_nodes[placement.best_child_index.getVectorIndex()] = true;
+      }
+
+      // place new sample as a descendant of a mid-branch point
+      if (placement.is_mid_branch) {
+        placeNewSampleMidBranch<num_states>(
+            placement.selected_node_index, batch_regions[j], seq_name_index,
+            placement.best_lh_diff);
+        // otherwise, best lk so far is for appending directly to existing
+        // node
+      } else {
+        placeNewSampleAtNode<num_states>(
+            placement.selected_node_index, batch_regions[j], seq_name_index,
+            placement.best_lh_diff, placement.best_up_lh_diff,
+            placement.best_down_lh_diff, placement.best_child_index);
+      }
+    }
+  }
+}
+
+template <const StateType num_states>
+void cmaple::Tree::seekSamplePlacementFromSeeds(
+    const NumSeqsType seq_name_index,
+    const std::unique_ptr<SeqRegions>& sample_regions,
+    SamplePlacement& placement,
+    const bool read_only) {
+  // the number of best-matching nodes (seeds) whose subtrees are searched
+  const size_t max_num_seeds = 8;
+  // the number of levels searched below the tops of the subtrees hanging off
+  // the paths from the root to the seeds
+  const short int side_depth = 6;
+  // the margin of the placement costs below which those subtrees are
+  // searched further (see seekSamplePlacement())
+  const RealNumType side_margin = 15;
+  // the best placement cost below which the unrestricted search is rerun
+  // (roughly three mutations away from any node)
+  const RealNumType min_seeded_lh_diff = -30;
+
+  // find the best-matching nodes
+  std::vector<NumSeqsType> seeds;
+  if (mutation_index.isActive()) {
+    mutation_index.findCandidates(*sample_regions, num_states, max_num_seeds,
+                                  seeds);
+  }
+
+  // record the paths from the root to the seeds
+  std::unordered_map<NumSeqsType, bool> search_paths;
+  for (const NumSeqsType seed : seeds) {
+    search_paths[seed] = true;
+    NumSeqsType node_vec = seed;
+    while (node_vec != root_vector_index) {
+      node_vec = nodes[node_vec].getNeighborIndex(TOP).getVectorIndex();
+      // the upper part of the path was already recorded
+      if (!search_paths.emplace(node_vec, false).second) {
+        break;
+      }
+    }
+  }
+
+  // search from the root (in the whole tree if no seed was found)
+  seekSamplePlacement<num_states>(
+      Index(root_vector_index, TOP), seq_name_index, sample_regions,
+      placement.selected_node_index, placement.best_lh_diff,
+      placement.is_mid_branch, placement.best_up_lh_diff,
+      placement.best_down_lh_diff, placement.best_child_index, read_only,
+      MIN_NEGATIVE, seeds.empty() ? nullptr : &search_paths, side_depth,
+      side_margin);
+
+  // rerun the unrestricted search if the sample matches the tree poorly
+  // (unless it was found less informative than a leaf)
+  if (!seeds.empty() &&
+      placement.selected_node_index.getMiniIndex() != UNDEFINED &&
+      placement.best_lh_diff < min_seeded_lh_diff) {
+    placement = SamplePlacement();
+    seekSamplePlacement<num_states>(
+        Index(root_vector_index, TOP), seq_name_index, sample_regions,
+        placement.selected_node_index, placement.best_lh_diff,
+        placement.is_mid_branch, placement.best_up_lh_diff,
+        placement.best_down_lh_diff, placement.best_child_index, read_only);
+  }
+}
+
+template <const StateType num_states>
+void cmaple::Tree::finetuneSamplePlacementReadOnly(
+    SamplePlacement& placement,
+    const std::unique_ptr<SeqRegions>& sample_regions) {
+  // the sample is added on the branch above the selected node
+  if (placement.is_mid_branch) {
+    return;
+  }
+
+  // the following steps follow those of placeNewSampleAtNode()
+  const RealNumType threshold_prob = params->threshold_prob;
+  const NumSeqsType selected_node_vec_index =
+      placement.selected_node_index.getVectorIndex();
+  PhyloNode& selected_node = nodes[selected_node_vec_index];
+
+  // the cost of placing the sample on the branch above the best child
+  RealNumType best_child_lh = MIN_NEGATIVE;
+  if (placement.best_child_index.getMiniIndex() != UNDEFINED) {
+    PhyloNode& best_child = nodes[placement.best_child_index.getVectorIndex()];
+    best_child_lh = placement.best_down_lh_diff;
+    RealNumType best_child_blength_split = 0.5 * best_child.getUpperLength();
+    std::unique_ptr<SeqRegions> best_child_regions = nullptr;
+    tryShorterBranch<num_states,
+                     &cmaple::Tree::calculateSamplePlacementCost<num_states>>(
+        best_child.getUpperLength(), best_child_regions, sample_regions,
+        getPartialLhAtNode(best_child.getNeighborIndex(TOP)),
+        best_child.getPartialLh(TOP), best_child_lh, best_child_blength_split,
+        default_blength, true);
+  }
+
+  // the cost of placing the sample on the branch above the selected node (or
+  // as a sibling of the root)
+  RealNumType best_parent_lh;
+  std::unique_ptr<SeqRegions> best_parent_regions = nullptr;
+  if (root_vector_index == selected_node_vec_index) {
+    const std::unique_ptr<SeqRegions>& lower_regions =
+        selected_node.getPartialLh(TOP);
+    const RealNumType old_root_lh =
+        lower_regions->computeAbsoluteLhAtRoot<num_states>(model,
+                                                           cumulative_base);
+    best_parent_lh = lower_regions->mergeTwoLowers<num_states>(
+        best_parent_regions, default_blength, *sample_regions, default_blength,
+        aln, model, cumulative_rate, threshold_prob, true);
+    best_parent_lh += best_parent_regions->computeAbsoluteLhAtRoot<num_states>(
+        model, cumulative_base);
+    RealNumType best_root_blength = default_blength;
+    tryShorterBranchAtRoot<num_states>(sample_regions, lower_regions,
+                                       best_parent_regions, best_root_blength,
+                                       best_parent_lh, default_blength);
+    best_parent_lh -= old_root_lh;
+  } else {
+    best_parent_lh = placement.best_up_lh_diff;
+    RealNumType best_parent_blength_split = 0.5 * selected_node.getUpperLength();
+    tryShorterBranch<num_states,
+                     &cmaple::Tree::calculateSamplePlacementCost<num_states>>(
+        selected_node.getUpperLength(), best_parent_regions, sample_regions,
+        getPartialLhAtNode(selected_node.getNeighborIndex(TOP)),
+        selected_node.getPartialLh(TOP), best_parent_lh,
+        best_parent_blength_split, default_blength, false);
+  }
+
+  // on the branch above the best child
+  if (best_child_lh >= best_parent_lh &&
+      best_child_lh >= placement.best_lh_diff) {
+    placement.selected_node_index = placement.best_child_index;
+    placement.best_lh_diff = best_child_lh;
+    placement.is_mid_branch = true;
+  }
+  // on the branch above the selected node (unless exactly at that node)
+  else if (placement.best_lh_diff < best_parent_lh) {
+    placement.best_lh_diff = best_parent_lh;
+    placement.is_mid_branch = true;
+  }
+}
+
+void cmaple::Tree::attachIdenticalSeqs(
+    const std::vector<NumSeqsType>& identical_seqs) {
+  // find the leaf of each sequence in the tree
+  const NumSeqsType no_leaf = static_cast<NumSeqsType>(nodes.size());
+  std::vector<NumSeqsType> seq_leaves(aln->data.size(), no_leaf);
+  for (NumSeqsType vec_index = 0; vec_index < nodes.size(); ++vec_index) {
+    PhyloNode& node = nodes[vec_index];
+    if (!node.isInternal()) {
+      seq_leaves[node.getSeqNameIndex()] = vec_index;
+      for (const NumSeqsType seq_name_index : node.getLessInfoSeqs()) {
+        seq_leaves[seq_name_index] = vec_index;
+      }
+    }
+  }
+
+  // add each sequence into the list of less-informative sequences of the leaf
+  // of its representative
+  for (const NumSeqsType seq_name_index : identical_seqs) {
+    const NumSeqsType leaf_vec_index =
+        seq_leaves[aln->representative_seqs[seq_name_index]];
+    if (leaf_vec_index == no_leaf) {
+      throw std::logic_error(
+          "Sorry! Something went wrong. The representative of sequence " +
+          aln->data[seq_name_index].seq_name + " is not found in the tree.");
+    }
+    nodes[leaf_vec_index].addLessInfoSeqs(seq_name_index);
+  }
+}
+
+void cmaple::Tree::indexAllNodes() {
+  mutation_index.activate();
+  for (NumSeqsType vec_index = 0; vec_index < nodes.size(); ++vec_index) {
+    indexLowerLh(vec_index);
+  }
+}
+
+std::string cmaple::Tree::getNodeName(const NumSeqsType node_vec_index) {
+  PhyloNode& node = nodes[node_vec_index];
+  if (node.isInternal()) {
+    assert(internal_names.size() > node_vec_index);
+    return "in" + convertIntToString(internal_names[node_vec_index]);
+  }
+  return seq_names[node.getSeqNameIndex()];
+}
+
+template <const StateType num_states>
+void cmaple::Tree::placeStreamedSamplesTemplate(std::istream& seq_stream,
+                                                std::ostream& placement_stream,
+                                                const int num_alt_placements,
+                                                const bool refresh_lhs) {
+  assert(aln && model && cumulative_rate);
+
+  // Make sure the tree is not empty
+  if (!nodes.size()) {
+    throw std::logic_error(
+        "Tree is empty. Please build/infer a tree from the alignment first!");
+  }
+  if (num_alt_placements < 0) {
+    throw std::invalid_argument(
+        "The number of alternative placements must be non-negative!");
+  }
+
+  // Make sure we use the updated alignment (in case users re-read the alignment
+  // from a new file after attaching the alignment to the tree)
+  if (aln->attached_trees.find(this) == aln->attached_trees.end()) {
+    changeAln(aln);
+  }
+
+  // make sure all likelihoods along the tree are up to date (if needed). The
+  // tree is not changed afterwards.
+  if (refresh_lhs) {
+    refreshAllLhs<num_states>();
+  }
+  genIntNames();
+
+  // dummy variables
+  const PositionType seq_length = static_cast<PositionType>(aln->ref_seq.size());
+  PositionType line_num = 0;
+  Sequence sequence;
+  std::vector<SamplePlacement> examined_placements;
+
+  // the header
+  placement_stream << "sample\tplacement\ttype\tlhDiff";
+  if (num_alt_placements) {
+    placement_stream << "\talternatives";
+  }
+  placement_stream << std::endl;
+
+  // place the samples one by one
+  while (aln->readMapleSeq(seq_stream, sequence, line_num)) {
+    std::unique_ptr<SeqRegions> lower_regions =
+        sequence.getLowerLhVector(seq_length, num_states, aln->getSeqType());
+
+    // seek the placement from the root (as doPlacement() does without
+    // mutation_index) without adding the sample into the tree (the sequence
+    // index is only used to add less-informative sequences, which is not done
+    // in read-only mode)
+    SamplePlacement placement;
+    examined_placements.clear();
+    seekSamplePlacement<num_states>(
+        Index(root_vector_index, TOP), 0, lower_regions,
+        placement.selected_node_index, placement.best_lh_diff,
+        placement.is_mid_branch, placement.best_up_lh_diff,
+        placement.best_down_lh_diff, placement.best_child_index, true,
+        MIN_NEGATIVE, nullptr, 0, 0,
+        num_alt_placements ? &examined_placements : nullptr);
+
+    // the sample is identical to or less informative than a leaf
+    const bool is_identical =
+        placement.selected_node_index.getMiniIndex() == UNDEFINED;
+    if (!is_identical) {
+      finetuneSamplePlacementReadOnly<num_states>(placement, lower_regions);
+    }
+    const NumSeqsType selected_node_vec_index =
+        placement.selected_node_index.getVectorIndex();
+    placement_stream << sequence.seq_name << "\t"
+                     << getNodeName(selected_node_vec_index) << "\t";
+    if (is_identical) {
+      const bool check_ident_only = true;
+      placement_stream << (nodes[selected_node_vec_index]
+                                       .getPartialLh(TOP)
+                                       ->compareWithSample(*lower_regions,
+                                                           seq_length, aln,
+                                                           check_ident_only) == 1
+                               ? "identical\t0"
+                               : "less-informative\t0");
+    } else {
+      // the branch above the root, i.e., as a sibling of the root
+      const bool is_root_sibling =
+          placement.is_mid_branch &&
+          selected_node_vec_index == root_vector_index;
+      placement_stream << (is_root_sibling ? "root\t"
+                           : placement.is_mid_branch ? "branch\t"
+                                                     : "node\t")
+                       << convertDoubleToString(placement.best_lh_diff, 5);
+    }
+
+    // output the best other placements examined by the search
+    if (num_alt_placements) {
+      std::stable_sort(examined_placements.begin(), examined_placements.end(),
+                       [](const SamplePlacement& a, const SamplePlacement& b) {
+                         return a.best_lh_diff > b.best_lh_diff;
+                       });
+      std::string alt_placements;
+      int num_alts = 0;
+      std::vector<std::pair<NumSeqsType, bool>> output_placements;
+      if (!is_identical) {
+        output_placements.emplace_back(selected_node_vec_index,
+                                       placement.is_mid_branch);
+      }
+      for (const SamplePlacement& examined_placement : examined_placements) {
+        if (num_alts >= num_alt_placements) {
+          break;
+        }
+        const std::pair<NumSeqsType, bool> alt_placement(
+            examined_placement.selected_node_index.getVectorIndex(),
+            examined_placement.is_mid_branch);
+        if (std::find(output_placements.begin(), output_placements.end(),
+                      alt_placement) != output_placements.end()) {
+          continue;
+        }
+        output_placements.push_back(alt_placement);
+        alt_placements += (num_alts ? "," : "") +
+                          getNodeName(alt_placement.first) + ":" +
+                          (alt_placement.second ? "branch:" : "node:") +
+                          convertDoubleToString(
+                              examined_placement.best_lh_diff, 5);
+        ++num_alts;
+      }
+      placement_stream << "\t" << (num_alts ? alt_placements : "-");
+    }
+
+    // flush the output so that the placement is available immediately
+    placement_stream << std::endl;
+  }
+}
+
 template <const StateType num_states>
 void cmaple::Tree::applySPRTemplate(
     const TreeSearchType n_tree_search_type,
     const bool shallow_tree_search, std::ostream& out_stream) {
-  assert(cumulative_base.size() > 0);
+  assert(!cumulative_base.empty());
   assert(nodes.size() > 0);
     
   TreeSearchType tree_search_type = n_tree_search_type;
@@ -934,6 +1699,24 @@ void cmaple::Tree::applySPRTemplate(
   // string output_file(params->output_prefix);
   // exportOutput(output_file + "_init.treefile");
 
+  // allocate the cache of subtree placements (if needed)
+  resetSPRCache(params->spr_cache && !params->compute_SPRTA);
+
+  // track the likelihood changes to compute SPRTA scores concurrently if the
+  // topology is kept unchanged (see improveSubTreesInBatch())
+#ifdef _OPENMP
+  if (params->compute_SPRTA && tree_search_type == FAST_TREE_SEARCH &&
+      omp_get_max_threads() > 1) {
+    lh_stamps.assign(nodes.size(), 0);
+  }
+#endif
+
+  // start the budget of the tree search
+  search_start_time = getRealTime();
+  last_checkpoint_time = search_start_time;
+  num_spr_evaluations = 0;
+  search_stopped = false;
+
   // run a shallow (short range) search for tree topology improvement (if
   // neccessary) Don't apply shallow tree search if users chose no tree search
   if (shallow_tree_search && tree_search_type != FAST_TREE_SEARCH) {
@@ -973,8 +1756,8 @@ void cmaple::Tree::applySPRTemplate(
   }
 
   // run a normal search for tree topology improvement
-  if (tree_search_type != FAST_TREE_SEARCH
-      || params->compute_SPRTA) {
+  if (!search_stopped && (tree_search_type != FAST_TREE_SEARCH
+      || params->compute_SPRTA)) {
     if (cmaple::verbose_mode >= cmaple::VB_MED
         && tree_search_type != FAST_TREE_SEARCH) {
       std::string tree_search_str = getTreeSearchStr(tree_search_type);
@@ -998,10 +1781,30 @@ void cmaple::Tree::applySPRTemplate(
     // exportOutput(output_file + "_topo.treefile");
   }
 
+  // release the cache of subtree placements
+  resetSPRCache(false);
+
+  // drop the alternative SPRs replaced during the search
+  sprta_alt_branches.compact();
+
   // traverse the tree from root to re-calculate all likelihoods after
   // optimizing the tree topology
   refreshAllLhs<num_states>();
 
+  // save the current tree if the search was stopped by its budget, from which
+  // the search could be resumed
+  if (search_stopped) {
+    if (cmaple::verbose_mode > cmaple::VB_QUIET) {
+      outWarning("The tree search was stopped after seeking SPR moves for " +
+                 convertInt64ToString(num_spr_evaluations) + " nodes in " +
+                 convertDoubleToString(getRealTime() - search_start_time) +
+                 " seconds.");
+    }
+    if (params->checkpoint_path.length()) {
+      saveSearchCheckpoint();
+    }
+  }
+
   // output log-likelihood of the tree
   if (cmaple::verbose_mode >= cmaple::VB_DEBUG) {
     std::cout << std::setprecision(10)
@@ -1081,6 +1884,9 @@ void cmaple::Tree::makeTreeInOutConsistentTemplate() {
 
   // traverse the tree from root to re-calculate all lower likelihoods
   performDFS<&Tree::updateLowerLh<num_states>>();
+  if (mutation_index.isActive()) {
+    indexAllNodes();
+  }
 }
 
 template <const StateType num_states>
@@ -1094,7 +1900,7 @@ void cmaple::Tree::optimizeTreeTopology(const TreeSearchType tree_search_type,
   int num_tree_improvement =
       short_range_search ? 1 : params->num_tree_improvement;
 
-  for (int i = 0; i < num_tree_improvement; ++i) {
+  for (int i = 0; i < num_tree_improvement && !search_stopped; ++i) {
     // first, set all nodes outdated
     // no need to do so anymore as new nodes were already marked as outdated
     // resetSPRFlags(true, true);
@@ -1126,6 +1932,11 @@ void cmaple::Tree::optimizeTreeTopology(const TreeSearchType tree_search_type,
     // traverse the tree from root to try improvements on the entire tree
     RealNumType improvement = improveEntireTree<num_states>(tree_search_type, short_range_search);
 
+    // stop if the budget of the tree search is exhausted
+    if (search_stopped) {
+      break;
+    }
+
     if(params->estimate_rates_during_SPR && 
        (params->rate_variation || params->site_specific_rate_matrix))
     {
@@ -1152,6 +1963,9 @@ void cmaple::Tree::optimizeTreeTopology(const TreeSearchType tree_search_type,
       resetSPRFlags(false, true);
 
       improvement = improveEntireTree<num_states>(tree_search_type, short_range_search);
+      if (search_stopped) {
+        break;
+      }
       if (cmaple::verbose_mode >= cmaple::VB_DEBUG) {
         cout << "Tree was improved by " + convertDoubleToString(improvement) +
                     " at subround " + convertIntToString(j + 1)
@@ -1220,7 +2034,9 @@ void cmaple::Tree::optimizeBranchTemplate(std::ostream& out_stream) {
   resetSPRFlags(true, true);
 
   // traverse the tree from root to optimize branch lengths
-  PositionType num_improvement = optimizeBranchIter<num_states>();
+  PositionType num_improvement =
+      params->batch_blength_opt ? optimizeBranchIterInBatch<num_states>()
+                                : optimizeBranchIter<num_states>();
 
   // run improvements only on the nodes that have been affected by some changes
   // in the last round, and so on
@@ -1232,7 +2048,9 @@ void cmaple::Tree::optimizeBranchTemplate(std::ostream& out_stream) {
     }
 
     // traverse the tree from root to optimize branch lengths
-    num_improvement = optimizeBranchIter<num_states>();
+    num_improvement = params->batch_blength_opt
+                          ? optimizeBranchIterInBatch<num_states>()
+                          : optimizeBranchIter<num_states>();
   }
 
   // traverse the tree from root to re-calculate all likelihoods after
@@ -1287,8 +2105,21 @@ RealNumType cmaple::Tree::computeLhTemplate() {
   }
 
   // traverse the tree from root to re-calculate all likelihoods after
-  // optimizing the tree topology
-  refreshAllLhs<num_states>();
+  // optimizing the tree topology. The likelihood contributions of the
+  // internal nodes are computed while their lower lhs are updated
+  RealNumType total_contribution = performDFS<
+      &cmaple::Tree::updateLowerLhAndLhContribution<num_states>>();
+  if (mutation_index.isActive()) {
+    indexAllNodes();
+  }
+  refreshAllNonLowerLhs<num_states>();
+
+  // some zero-length branches were updated during the traversal -> perform
+  // another DFS to compute the likelihood contributions
+  if (std::isnan(total_contribution)) {
+    total_contribution =
+        performDFS<&cmaple::Tree::computeLhContribution<num_states>>();
+  }
 
   // initialize the total_lh by the likelihood from root
   RealNumType total_lh =
@@ -1296,8 +2127,8 @@ RealNumType cmaple::Tree::computeLhTemplate() {
           .getPartialLh(TOP)
           ->computeAbsoluteLhAtRoot<num_states>(model, cumulative_base);
 
-  // perform a DFS to add likelihood contributions from each internal nodes
-  total_lh += performDFS<&cmaple::Tree::computeLhContribution<num_states>>();
+  // add likelihood contributions from each internal nodes
+  total_lh += total_contribution;
 
   return total_lh;
 }
@@ -1487,7 +2318,7 @@ std::string cmaple::Tree::exportNodeString(const bool is_newick_format,
                     // annotation_str += ",alternativePlacements={";
                     std::string alter_placements = "";
                     
-                    std::vector<cmaple::AltBranch>& alt_branches = sprta_alt_branches[node_vec_index];
+                    const cmaple::AltBranches::Range alt_branches = sprta_alt_branches[node_vec_index];
                     
                     // add the first one
                     if (alt_branches.size() > 0)
@@ -2024,21 +2855,7 @@ std::string cmaple::Tree::exportTSV()
     
     // compute sprta_support_list - highlighting which nodes could be placed
     // (with probability above threshold) on the branch above the current node
-    sprta_support_list.clear();
-    sprta_support_list.resize(sprta_alt_branches.size());
-    vector<AltBranch>* alt_branch_vec_ptr = &sprta_alt_branches[0];
-    // loop over all nodes
-    for (auto i = 0; i < sprta_alt_branches.size(); ++i, ++alt_branch_vec_ptr)
-    {
-        AltBranch* alt_branch = alt_branch_vec_ptr->data();
-        
-        // loop over the vector of alternative branches of each node
-        for (auto j = 0; j < alt_branch_vec_ptr->size(); ++j, ++alt_branch)
-        {
-            sprta_support_list[alt_branch->branch_id.getVectorIndex()]
-                .push_back(AltBranch(alt_branch->lh, Index(i, TOP)));
-        }
-    }
+    sprta_support_list = sprta_alt_branches.inverse();
     
     // return the full content
     return header + exportTsvContent();
@@ -2271,6 +3088,7 @@ void cmaple::Tree::updatePartialLhFromChildren(
     merged_two_lower_regions = NULL;*/
     old_lower_regions = std::move(node.getPartialLh(TOP));
     node.setPartialLh(TOP, std::move(merged_two_lower_regions));
+    indexLowerLh(node_vec_index);
   }
 
   // update total likelihood
@@ -2389,6 +3207,7 @@ void cmaple::Tree::updatePartialLh(stack<Index>& node_stack) {
     //   cout << "dsdas";
 
     node.setOutdated(true);
+    const size_t stack_size = node_stack.size();
 
     std::unique_ptr<SeqRegions> null_seqregions_ptr = nullptr;
     bool is_non_root = root_vector_index != node_index.getVectorIndex();
@@ -2417,6 +3236,13 @@ void cmaple::Tree::updatePartialLh(stack<Index>& node_stack) {
                                               parent_upper_regions, is_non_root,
                                               seq_length);
     }
+
+    // stamp the node if its likelihoods changed, i.e., its upper likelihoods
+    // were updated or the changes were propagated further
+    if (!lh_stamps.empty() && (node_index.getMiniIndex() == TOP ||
+                               node_stack.size() > stack_size)) {
+      lh_stamps[node_index.getVectorIndex()] = ++lh_clock;
+    }
   }
 }
 
@@ -3507,12 +4333,13 @@ void cmaple::Tree::seekSubTreePlacement(
     RealNumType& removed_blength,
     RealNumType& opt_appending_blength,
     RealNumType& opt_mid_top_blength,
-    RealNumType& opt_mid_bottom_blength)
+    RealNumType& opt_mid_bottom_blength,
+    std::vector<NumSeqsType>* explored_nodes)
 {
   assert(aln);
   assert(model);
   assert(cumulative_rate);
-  assert(cumulative_base.size() > 0);
+  assert(!cumulative_base.empty());
   assert(aln->ref_seq.size() > 0);
   assert(nodes.size() > 0);
     
@@ -3520,6 +4347,10 @@ void cmaple::Tree::seekSubTreePlacement(
   PhyloNode& child_node = nodes[child_node_index.getVectorIndex()];
   const Index node_index = child_node.getNeighborIndex(TOP);
   const NumSeqsType vec_index = node_index.getVectorIndex();
+  if (explored_nodes) {
+    explored_nodes->push_back(child_node_index.getVectorIndex());
+    explored_nodes->push_back(vec_index);
+  }
   PhyloNode& node = nodes[vec_index];  // child_node->neighbor->getTopNode();
   const Index other_child_node_index = node.getNeighborIndex(
       node_index
@@ -3620,6 +4451,9 @@ void cmaple::Tree::seekSubTreePlacement(
     const Index current_node_index = updating_node->getIndex();
     const NumSeqsType current_node_vec = current_node_index.getVectorIndex();
     PhyloNode& current_node = nodes[current_node_vec];
+    if (explored_nodes) {
+      explored_nodes->push_back(current_node_vec);
+    }
       
       // debug
       /*if (current_node_index.getVectorIndex() == 625)
@@ -3820,7 +4654,10 @@ void cmaple::Tree::seekSubTreePlacement(
             
             // clear the vector of alternative SPRs
             if (params->output_alternative_spr)
-                sprta_alt_branches[child_node_index.getVectorIndex()].clear();
+            {
+#pragma omp critical
+                sprta_alt_branches.set(child_node_index.getVectorIndex(), {});
+            }
         }
         else
         {
@@ -3845,16 +4682,21 @@ void cmaple::Tree::seekSubTreePlacement(
                 // compute the spr scores for other alternative branches
                 const RealNumType total_spr_lhs_inverse = 1.0 / total_spr_lhs;
                 for (AltBranch& alt_branch : alt_branches)
-                {
                     alt_branch.lh *= total_spr_lhs_inverse;
-                    
-                    // store the vector of alternative branches
-                    // only consider alternative branches
-                    // with supports no less than the min branch support
-                    if (alt_branch.lh >= params->min_support_alt_branches)
-                        sprta_alt_branches[child_node_index.getVectorIndex()]
-                        .push_back(std::move(alt_branch));
-                }
+                
+                // store the vector of alternative branches
+                // only consider alternative branches
+                // with supports no less than the min branch support
+                alt_branches.erase(std::remove_if(
+                    alt_branches.begin(), alt_branches.end(),
+                    [this](const AltBranch& alt_branch)
+                    { return alt_branch.lh < params->min_support_alt_branches; }),
+                    alt_branches.end());
+                
+                // the nodes may be processed concurrently
+#pragma omp critical
+                sprta_alt_branches.set(child_node_index.getVectorIndex(),
+                                       alt_branches);
             }
         }
     }
@@ -4246,6 +5088,7 @@ void cmaple::Tree::connectSubTree2Branch(
   (this->*updateRegionsSubTree)(
       subtree, sibling_node, internal, std::move(best_child_regions),
       subtree_regions, upper_left_right_regions, lower_regions, best_blength);
+  indexLowerLh(internal_vec);
 
   // upper_left_right_regions->mergeUpperLower<num_states>(next_node_2->partial_lh,
   // new_internal_node->length, *subtree_regions, best_blength, aln, model,
@@ -4466,6 +5309,7 @@ void cmaple::Tree::connectSubTree2Root(
 
   new_root.setPartialLh(TOP, std::move(best_parent_regions));
   new_root.setMidBranchLh(nullptr);
+  indexLowerLh(new_root_vec);
 
   // new_root->computeTotalLhAtNode(aln, model, params->threshold_prob, true);
   new_root.getPartialLh(TOP)->computeTotalLhAtRoot<num_states>(
@@ -5089,6 +5933,8 @@ void cmaple::Tree::connectNewSample2Branch(
       internal.getPartialLh(TOP), sibling_node.getUpperLength(),
       leaf_lower_regions, best_blength, aln, model, cumulative_rate,
       threshold_prob);
+  indexLowerLh(leaf_vec_index);
+  indexLowerLh(internal_vec_index);
   RealNumType half_branch_length = internal.getUpperLength() * 0.5;
   upper_left_right_regions->mergeUpperLower<num_states>(
       internal.getMidBranchLh(), half_branch_length,
@@ -5417,6 +6263,8 @@ void cmaple::Tree::connectNewSample2Root(
 
   // new_sample_node->partial_lh = sample;
   leaf.setPartialLh(TOP, std::move(sample));
+  indexLowerLh(leaf_vec_index);
+  indexLowerLh(new_root_vec_index);
 
   if (!new_root.getTotalLh())  //(!new_root.getTotalLh() ||
                                // new_root->total_lh->size() == 0)
@@ -5841,8 +6689,74 @@ PositionType cmaple::Tree::optimizeBranchIter() {
 }
 
 template <const StateType num_states>
-void cmaple::Tree::estimateBlength_R_O(
-    const SeqRegion& seq1_region,
+PositionType cmaple::Tree::optimizeBranchIterInBatch() {
+  // start from the root's children
+  stack<Index> node_stack;
+  PhyloNode& root = nodes[root_vector_index];
+  if (!root.isInternal()) {
+    return 0;
+  }
+  node_stack.push(root.getNeighborIndex(RIGHT));
+  node_stack.push(root.getNeighborIndex(LEFT));
+
+  // collect the outdated branches (in the same order as optimizeBranchIter())
+  std::vector<Index> branch_nodes;
+  while (!node_stack.empty()) {
+    const Index node_index = node_stack.top();
+    node_stack.pop();
+    const PhyloNode& node = nodes[node_index.getVectorIndex()];
+
+    if (node.isInternal()) {
+      node_stack.push(node.getNeighborIndex(RIGHT));
+      node_stack.push(node.getNeighborIndex(LEFT));
+    }
+
+    if (node.isOutdated()) {
+      branch_nodes.push_back(node_index);
+    }
+  }
+
+  // estimate the lengths of all branches concurrently, without changing the
+  // tree
+  const int num_branches = static_cast<int>(branch_nodes.size());
+  std::vector<RealNumType> best_lengths(branch_nodes.size());
+#pragma omp parallel for schedule(dynamic, 64)
+  for (int i = 0; i < num_branches; ++i) {
+    PhyloNode& node = nodes[branch_nodes[i].getVectorIndex()];
+    best_lengths[i] = estimateBranchLength<num_states>(
+        getPartialLhAtNode(node.getNeighborIndex(TOP)), node.getPartialLh(TOP));
+  }
+
+  // apply the changed lengths, then update the partial likelihoods from all
+  // changed branches at once
+  PositionType num_improvement = 0;
+  for (int i = 0; i < num_branches; ++i) {
+    const Index node_index = branch_nodes[i];
+    PhyloNode& node = nodes[node_index.getVectorIndex()];
+    const RealNumType best_length = best_lengths[i];
+
+    if (best_length > 0 || node.getUpperLength() > 0) {
+      RealNumType diff_thresh = 0.01 * best_length;
+      if (best_length <= 0 || node.getUpperLength() <= 0 ||
+          (node.getUpperLength() > (best_length + diff_thresh)) ||
+          (node.getUpperLength() < (best_length - diff_thresh))) {
+        node.setUpperLength(best_length);
+        ++num_improvement;
+
+        node_stack.push(node_index);
+        node_stack.push(node.getNeighborIndex(TOP));
+      }
+    }
+  }
+  updatePartialLh<num_states>(node_stack);
+
+  return num_improvement;
+}
+
+template <const StateType num_states>
+CMAPLE_SIMD_KERNEL
+void cmaple::Tree::estimateBlength_R_O(
+    const SeqRegion& seq1_region,
     const SeqRegion& seq2_region,
     const RealNumType total_blength,
     const PositionType end_pos,
@@ -5925,6 +6839,7 @@ void cmaple::Tree::estimateBlength_R_ACGT(
 }
 
 template <const StateType num_states>
+CMAPLE_SIMD_KERNEL
 void cmaple::Tree::estimateBlength_O_X(
     const SeqRegion& seq1_region,
     const SeqRegion& seq2_region,
@@ -5989,6 +6904,7 @@ void cmaple::Tree::estimateBlength_O_X(
 }
 
 template <const StateType num_states>
+CMAPLE_SIMD_KERNEL
 void cmaple::Tree::estimateBlength_ACGT_O(
     const SeqRegion& seq1_region,
     const SeqRegion& seq2_region,
@@ -6467,25 +7383,41 @@ RealNumType cmaple::Tree::improveSubTree(const Index node_index,
                                          PhyloNode& node,
                                          const TreeSearchType tree_search_type,
                                          bool short_range_search) {
+  // seek an SPR move, then apply it
+  SubTreeSPR spr_move;
+  seekSubTreeSPR<num_states>(node_index, node, tree_search_type,
+                             short_range_search, spr_move);
+  return applySubTreeSPR<num_states>(node_index, node, tree_search_type,
+                                     short_range_search, spr_move);
+}
+
+template <const StateType num_states>
+void cmaple::Tree::seekSubTreeSPR(const Index node_index,
+                                  PhyloNode& node,
+                                  const TreeSearchType tree_search_type,
+                                  const bool short_range_search,
+                                  SubTreeSPR& spr_move,
+                                  std::vector<NumSeqsType>* explored_nodes) {
   // dummy variables
   assert(node_index.getMiniIndex() == TOP);
   const NumSeqsType vec_index = node_index.getVectorIndex();
   const RealNumType thresh_placement_cost =
       short_range_search ? params->thresh_placement_cost_short_search
                          : params->thresh_placement_cost;
-  RealNumType total_improvement = 0;
-  bool blength_changed = false;  // true if a branch length has been changed
 
   // we avoid the root node since it cannot be re-placed with SPR moves
   if (root_vector_index != vec_index) {
     // evaluate current placement
+    spr_move.parent_index = node.getNeighborIndex(TOP);
     const std::unique_ptr<SeqRegions>& parent_upper_lr_lh = getPartialLhAtNode(
         node.getNeighborIndex(TOP));  // node->neighbor->getPartialLhAtNode(aln,
                                       // model, threshold_prob);
     const std::unique_ptr<SeqRegions>& lower_lh = node.getPartialLh(
         TOP);  // node->getPartialLhAtNode(aln, model, threshold_prob);
-    RealNumType best_blength = node.getUpperLength();  // node->length;
-    RealNumType best_lh = calculateSubTreePlacementCost<num_states>(
+    RealNumType& best_blength = spr_move.best_blength;
+    RealNumType& best_lh = spr_move.best_lh;
+    best_blength = node.getUpperLength();  // node->length;
+    best_lh = calculateSubTreePlacementCost<num_states>(
         parent_upper_lr_lh, lower_lh, best_blength);
 
     // optimize branch length
@@ -6493,7 +7425,7 @@ RealNumType cmaple::Tree::improveSubTree(const Index node_index,
         && ((best_lh < thresh_placement_cost)
             || (params->compute_SPRTA && params->compute_SPRTA_zero_length_branches))) {
       optimizeBlengthBeforeSeekingSPR<num_states>(node, best_blength, best_lh,
-                                                  blength_changed,
+                                                  spr_move.blength_changed,
                                                   parent_upper_lr_lh, lower_lh);
     }
 
@@ -6505,61 +7437,581 @@ RealNumType cmaple::Tree::improveSubTree(const Index node_index,
       // rooted at "node" but to do that we need to consider new vector
       // probabilities after removing the node that we want to replace this is
       // done using findBestParentTopology().
-      bool topology_updated = false;
-      const Index parent_index = node.getNeighborIndex(TOP);
-      // PhyloNode parent_node = nodes[parent_index.getVectorIndex()]; //
-      // node->neighbor->getTopNode();
-      Index best_node_index;
-      RealNumType best_lh_diff = best_lh;
-      bool is_mid_node = false;
+      spr_move.placement_sought = true;
+      spr_move.best_lh_diff = best_lh;
       RealNumType best_up_lh_diff = MIN_NEGATIVE;
       RealNumType best_down_lh_diff = MIN_NEGATIVE;
-      Index best_child_index;
-      RealNumType opt_appending_blength = -1;
-      RealNumType opt_mid_top_blength = -1;
-      RealNumType opt_mid_bottom_blength = -1;
         
         // debug
         /*if (node_index.getVectorIndex() == 594)
             std::cout << "fsdfds" << std::endl;*/
 
+      // reuse the placement found in a previous round if the nodes explored
+      // to find it are unchanged
+      if (!spr_cache.empty() &&
+          getCachedSubTreeSPR(vec_index, short_range_search, spr_move)) {
+        return;
+      }
+
       // seek a new placement for the subtree
+      const bool use_cache = !spr_cache.empty();
+      std::vector<NumSeqsType> cached_explored_nodes;
+      if (use_cache && !explored_nodes) {
+        explored_nodes = &cached_explored_nodes;
+      }
       seekSubTreePlacement<num_states>(
-          best_node_index, best_lh_diff, is_mid_node, best_up_lh_diff,
-          best_down_lh_diff, best_child_index, short_range_search, node_index,
-          best_blength, opt_appending_blength, opt_mid_top_blength,
-                                       opt_mid_bottom_blength); 
+          spr_move.best_node_index, spr_move.best_lh_diff,
+          spr_move.is_mid_node, best_up_lh_diff, best_down_lh_diff,
+          spr_move.best_child_index, short_range_search, node_index,
+          best_blength, spr_move.opt_appending_blength,
+          spr_move.opt_mid_top_blength, spr_move.opt_mid_bottom_blength,
+          explored_nodes);
+      spr_move.best_node_parent_index =
+          nodes[spr_move.best_node_index.getVectorIndex()].getNeighborIndex(
+              TOP);
+
+      // cache the placement
+      if (use_cache) {
+        CachedSubTreeSPR& cached_move = spr_cache[vec_index];
+        cached_move.stamp = lh_clock;
+        cached_move.short_range_search = short_range_search;
+        cached_move.start_lh = best_lh;
+        cached_move.spr_move = spr_move;
+        if (explored_nodes->size() > MAX_CACHED_EXPLORED_NODES) {
+          std::vector<NumSeqsType>().swap(cached_move.explored_nodes);
+        } else {
+          cached_move.explored_nodes = *explored_nodes;
+        }
+      }
+    }
+  }
+}
 
-      // validate the new placement cost
-      if (best_lh_diff < -1e50) {
-        throw std::logic_error(
-            "Likelihood cost is very heavy, this might mean that the "
-            "reference used is not the same used to generate the input "
-            "MAPLE file");
+template <const StateType num_states>
+RealNumType cmaple::Tree::applySubTreeSPR(const Index node_index,
+                                          PhyloNode& node,
+                                          const TreeSearchType tree_search_type,
+                                          const bool short_range_search,
+                                          const SubTreeSPR& spr_move) {
+  // dummy variables
+  const RealNumType thresh_placement_cost =
+      short_range_search ? params->thresh_placement_cost_short_search
+                         : params->thresh_placement_cost;
+  RealNumType total_improvement = 0;
+  bool topology_updated = false;
+
+  if (spr_move.placement_sought) {
+    // validate the new placement cost
+    if (spr_move.best_lh_diff < -1e50) {
+      throw std::logic_error(
+          "Likelihood cost is very heavy, this might mean that the "
+          "reference used is not the same used to generate the input "
+          "MAPLE file");
+    }
+
+    if (spr_move.best_lh_diff + thresh_placement_cost > spr_move.best_lh &&
+        tree_search_type != FAST_TREE_SEARCH) {
+      // check and apply SPR move
+      checkAndApplySPR<num_states>(
+          spr_move.best_lh_diff, spr_move.best_blength,
+          spr_move.opt_appending_blength, spr_move.opt_mid_top_blength,
+          spr_move.opt_mid_bottom_blength, spr_move.best_lh, node_index, node,
+          spr_move.best_node_index, spr_move.parent_index,
+          spr_move.is_mid_node, total_improvement, topology_updated);
+    }
+  }
+
+  if (!topology_updated && spr_move.blength_changed) {
+    handleBlengthChanged<num_states>(node, node_index, spr_move.best_blength);
+  }
+
+  return total_improvement;
+}
+
+void cmaple::Tree::resetSPRCache(const bool allocate) {
+  spr_cache.clear();
+  lh_stamps.clear();
+  if (allocate) {
+    spr_cache.resize(nodes.size());
+    lh_stamps.resize(nodes.size(), 0);
+  } else {
+    spr_cache.shrink_to_fit();
+    lh_stamps.shrink_to_fit();
+  }
+
+  // stamps start from 1 so that 0 marks an empty entry
+  lh_clock = 1;
+}
+
+bool cmaple::Tree::getCachedSubTreeSPR(const NumSeqsType vec_index,
+                                       const bool short_range_search,
+                                       SubTreeSPR& spr_move) const {
+  const CachedSubTreeSPR& cached_move = spr_cache[vec_index];
+  if (!cached_move.stamp ||
+      cached_move.short_range_search != short_range_search ||
+      !(cached_move.spr_move.parent_index == spr_move.parent_index)) {
+    return false;
+  }
+
+  // the likelihoods of the explored nodes (or all nodes if they were not
+  // stored) must be unchanged
+  if (cached_move.explored_nodes.empty()) {
+    if (lh_clock > cached_move.stamp) {
+      return false;
+    }
+  } else {
+    for (const NumSeqsType explored_vec : cached_move.explored_nodes) {
+      if (lh_stamps[explored_vec] > cached_move.stamp) {
+        return false;
       }
+    }
+  }
+
+  // a better placement was found but the current position has become at
+  // least as good -> seek it again
+  const SubTreeSPR& cached_spr = cached_move.spr_move;
+  const bool moved = cached_spr.best_lh_diff > cached_move.start_lh;
+  if (moved && cached_spr.best_lh_diff <= spr_move.best_lh) {
+    return false;
+  }
+  if (!(nodes[cached_spr.best_node_index.getVectorIndex()].getNeighborIndex(
+            TOP) == cached_spr.best_node_parent_index)) {
+    return false;
+  }
 
-      if (best_lh_diff + thresh_placement_cost > best_lh && tree_search_type != FAST_TREE_SEARCH) {
-        // check and apply SPR move
-        checkAndApplySPR<num_states>(best_lh_diff, best_blength,
-            opt_appending_blength, opt_mid_top_blength,
-            opt_mid_bottom_blength, best_lh, node_index, node,
-            best_node_index, parent_index, is_mid_node,
-            total_improvement, topology_updated);
+  spr_move.best_node_index = cached_spr.best_node_index;
+  spr_move.best_node_parent_index = cached_spr.best_node_parent_index;
+  spr_move.best_lh_diff = moved ? cached_spr.best_lh_diff : spr_move.best_lh;
+  spr_move.is_mid_node = cached_spr.is_mid_node;
+  spr_move.best_child_index = cached_spr.best_child_index;
+  spr_move.opt_appending_blength = cached_spr.opt_appending_blength;
+  spr_move.opt_mid_top_blength = cached_spr.opt_mid_top_blength;
+  spr_move.opt_mid_bottom_blength = cached_spr.opt_mid_bottom_blength;
+  return true;
+}
+
+bool cmaple::Tree::isSubTreeSPRValid(const Index node_index,
+                                     const PhyloNode& node,
+                                     const TreeSearchType tree_search_type,
+                                     const bool short_range_search,
+                                     const SubTreeSPR& spr_move) {
+  const RealNumType thresh_placement_cost =
+      short_range_search ? params->thresh_placement_cost_short_search
+                         : params->thresh_placement_cost;
+
+  // nothing to apply at the root
+  if (root_vector_index == node_index.getVectorIndex()) {
+    return !spr_move.placement_sought && !spr_move.blength_changed;
+  }
+
+  // the subtree and its upper branch must be unchanged
+  if (node.isOutdated() || !(node.getNeighborIndex(TOP) == spr_move.parent_index) ||
+      nodes[spr_move.parent_index.getVectorIndex()].isOutdated()) {
+    return false;
+  }
+
+  // only a branch length change (if any)
+  if (!spr_move.placement_sought ||
+      spr_move.best_lh_diff + thresh_placement_cost <= spr_move.best_lh ||
+      tree_search_type == FAST_TREE_SEARCH) {
+    return true;
+  }
 
-        if (!topology_updated && blength_changed) {
-          handleBlengthChanged<num_states>(node, node_index, best_blength);
+  // the target branch must be unchanged
+  const NumSeqsType best_node_vec = spr_move.best_node_index.getVectorIndex();
+  const PhyloNode& best_node = nodes[best_node_vec];
+  if (best_node.isOutdated() ||
+      !(best_node.getNeighborIndex(TOP) == spr_move.best_node_parent_index) ||
+      (spr_move.best_child_index.getMiniIndex() != UNDEFINED &&
+       nodes[spr_move.best_child_index.getVectorIndex()].isOutdated())) {
+    return false;
+  }
+
+  // the target branch must still be outside the subtree
+  NumSeqsType ancestor_vec = best_node_vec;
+  while (ancestor_vec != root_vector_index) {
+    if (ancestor_vec == node_index.getVectorIndex()) {
+      return false;
+    }
+    ancestor_vec = nodes[ancestor_vec].getNeighborIndex(TOP).getVectorIndex();
+  }
+  return ancestor_vec != node_index.getVectorIndex();
+}
+
+template <const StateType num_states>
+RealNumType cmaple::Tree::improveEntireTreeInBatches(
+    const TreeSearchType tree_search_type,
+    bool short_range_search) {
+  // start from the root
+  std::stack<Index> node_stack;
+  node_stack.push(Index(root_vector_index, TOP));
+
+  // dummy variables
+  const size_t batch_size = static_cast<size_t>(
+      params->spr_batch_size > 1 ? params->spr_batch_size : SPRTA_BATCH_SIZE);
+  std::vector<Index> batch_nodes;
+  batch_nodes.reserve(batch_size);
+  std::vector<RealNumType> improvements;
+  RealNumType total_improvement = 0;
+  PositionType num_nodes = 0;
+  PositionType count_node_1K = 0;
+
+  // traverse downward the tree
+  while (!node_stack.empty()) {
+    // collect the next batch of outdated nodes (in the same order as
+    // improveEntireTree())
+    batch_nodes.clear();
+    while (!node_stack.empty() && batch_nodes.size() < batch_size) {
+      const Index index = node_stack.top();
+      node_stack.pop();
+      PhyloNode& node = nodes[index.getVectorIndex()];
+      assert(index.getMiniIndex() == TOP);
+      if (node.isInternal()) {
+        node_stack.push(node.getNeighborIndex(RIGHT));
+        node_stack.push(node.getNeighborIndex(LEFT));
+      }
+
+      if (node.isOutdated() && node.getSPRCount() <= 5) {
+        node.setOutdated(false);
+        batch_nodes.push_back(index);
+      }
+    }
+
+    // do SPR moves to improve the tree
+    total_improvement += improveSubTreesInBatch<num_states>(
+        batch_nodes, tree_search_type, short_range_search, improvements);
+
+    // Show log every 1000 nodes
+    num_nodes += static_cast<PositionType>(batch_nodes.size());
+    if (cmaple::verbose_mode >= cmaple::VB_MED &&
+        num_nodes - count_node_1K >= 1000 &&
+        tree_search_type != FAST_TREE_SEARCH) {
+      std::cout << "Processed topology for " << convertIntToString(num_nodes)
+                << " nodes." << std::endl;
+      count_node_1K = num_nodes;
+    }
+
+    // stop if the budget of the tree search is exhausted
+    num_spr_evaluations += static_cast<int64_t>(batch_nodes.size());
+    if (checkSearchBudget()) {
+      break;
+    }
+  }
+
+  return total_improvement;
+}
+
+template <const StateType num_states>
+RealNumType cmaple::Tree::improveSubTreesInBatch(
+    const std::vector<Index>& batch_nodes,
+    const TreeSearchType tree_search_type,
+    const bool short_range_search,
+    std::vector<RealNumType>& improvements) {
+  // dummy variables
+  const int num_batch_nodes = static_cast<int>(batch_nodes.size());
+  std::vector<SubTreeSPR> batch_moves(batch_nodes.size());
+  // the nodes that the moves depend on, and their outdated flags before the
+  // moves were applied
+  std::vector<std::pair<NumSeqsType, bool>> watched_nodes;
+  RealNumType total_improvement = 0;
+  improvements.assign(batch_nodes.size(), 0);
+  // the nodes explored to seek the moves (only tracked when computing SPRTA)
+  const bool track_explored_nodes =
+      params->compute_SPRTA && !lh_stamps.empty();
+  std::vector<std::vector<NumSeqsType>> batch_explored_nodes(
+      track_explored_nodes ? batch_nodes.size() : 0);
+  const uint64_t seek_stamp = lh_clock;
+
+  // seek the SPR moves of all nodes in the batch concurrently, without
+  // changing the tree
+#pragma omp parallel for schedule(dynamic)
+  for (int j = 0; j < num_batch_nodes; ++j) {
+    seekSubTreeSPR<num_states>(
+        batch_nodes[j], nodes[batch_nodes[j].getVectorIndex()],
+        tree_search_type, short_range_search, batch_moves[j],
+        track_explored_nodes ? &batch_explored_nodes[j] : nullptr);
+  }
+
+  // clear the outdated flags of the nodes that the moves depend on, thus,
+  // these flags record which of those nodes are changed by earlier moves in
+  // this batch
+  for (const SubTreeSPR& spr_move : batch_moves) {
+    for (const Index index : {spr_move.parent_index, spr_move.best_node_index,
+                              spr_move.best_child_index}) {
+      if (index.getMiniIndex() != UNDEFINED) {
+        PhyloNode& node = nodes[index.getVectorIndex()];
+        watched_nodes.emplace_back(index.getVectorIndex(), node.isOutdated());
+        node.setOutdated(false);
+      }
+    }
+  }
+
+  // apply the moves one by one (in the input order)
+  const NumSeqsType batch_root_vec = root_vector_index;
+  for (int j = 0; j < num_batch_nodes; ++j) {
+    const Index index = batch_nodes[j];
+    PhyloNode& node = nodes[index.getVectorIndex()];
+    SubTreeSPR& spr_move = batch_moves[j];
+
+    // re-seek the move if it was invalidated by earlier moves
+    bool explored_nodes_changed = false;
+    if (track_explored_nodes) {
+      for (const NumSeqsType explored_vec : batch_explored_nodes[j]) {
+        if (lh_stamps[explored_vec] > seek_stamp) {
+          explored_nodes_changed = true;
+          break;
         }
-      } else if (blength_changed) {
-        handleBlengthChanged<num_states>(node, node_index, best_blength);
       }
-    } else if (blength_changed) {
-      handleBlengthChanged<num_states>(node, node_index, best_blength);
+    }
+    if (root_vector_index != batch_root_vec || explored_nodes_changed ||
+        !isSubTreeSPRValid(index, node, tree_search_type, short_range_search,
+                           spr_move)) {
+      node.setOutdated(false);
+      spr_move = SubTreeSPR();
+      seekSubTreeSPR<num_states>(index, node, tree_search_type,
+                                 short_range_search, spr_move);
+    }
+
+    improvements[j] = applySubTreeSPR<num_states>(
+        index, node, tree_search_type, short_range_search, spr_move);
+    total_improvement += improvements[j];
+  }
+
+  // restore the outdated flags
+  for (const std::pair<NumSeqsType, bool>& watched_node : watched_nodes) {
+    if (watched_node.second) {
+      nodes[watched_node.first].setOutdated(true);
     }
   }
 
   return total_improvement;
 }
 
+template <const StateType num_states>
+RealNumType cmaple::Tree::improveEntireTreeByPriority(
+    const TreeSearchType tree_search_type,
+    bool short_range_search) {
+  // dummy variables
+  const NumSeqsType num_nodes_in_tree = static_cast<NumSeqsType>(nodes.size());
+  const size_t batch_size = static_cast<size_t>(params->spr_batch_size);
+  // the gains decay by half every round
+  const RealNumType gain_decay = 0.5;
+  typedef std::pair<RealNumType, NumSeqsType> QueueItem;
+  std::priority_queue<QueueItem> node_queue;
+  // a node moved forward in the queue leaves a stale entry behind, thus, the
+  // nodes with a live entry are flagged (and counted)
+  std::vector<bool> queued(num_nodes_in_tree, false);
+  size_t num_queued = 0;
+  std::vector<NumSeqsType> preorder_nodes;
+  std::vector<NumSeqsType> subtree_sizes(num_nodes_in_tree, 1);
+  RealNumType total_improvement = 0;
+  PositionType num_nodes = 0;
+  PositionType count_node_1K = 0;
+  ++spr_round;
+  spr_gains.resize(num_nodes_in_tree, 0);
+  spr_outdated_rounds.resize(num_nodes_in_tree, NOT_OUTDATED);
+
+  // list the nodes in DFS (pre-)order
+  preorder_nodes.reserve(num_nodes_in_tree);
+  std::stack<NumSeqsType> node_stack;
+  node_stack.push(root_vector_index);
+  while (!node_stack.empty()) {
+    const NumSeqsType vec_index = node_stack.top();
+    node_stack.pop();
+    preorder_nodes.push_back(vec_index);
+    const PhyloNode& node = nodes[vec_index];
+    if (node.isInternal()) {
+      node_stack.push(node.getNeighborIndex(RIGHT).getVectorIndex());
+      node_stack.push(node.getNeighborIndex(LEFT).getVectorIndex());
+    }
+  }
+
+  // compute the subtree sizes, decay the gains, then add the outdated nodes
+  // into the queue
+  const auto getPriority = [&](const NumSeqsType vec_index) -> RealNumType {
+    const uint32_t age = spr_round - spr_outdated_rounds[vec_index];
+    return (spr_gains[vec_index] + 1.0 / (1 + age)) /
+           log2(2 + subtree_sizes[vec_index]);
+  };
+  const auto enqueue = [&](const NumSeqsType vec_index) {
+    node_queue.emplace(getPriority(vec_index), vec_index);
+    if (!queued[vec_index]) {
+      queued[vec_index] = true;
+      ++num_queued;
+    }
+  };
+  for (auto it = preorder_nodes.rbegin(); it != preorder_nodes.rend(); ++it) {
+    const NumSeqsType vec_index = *it;
+    const PhyloNode& node = nodes[vec_index];
+    if (node.isInternal()) {
+      subtree_sizes[vec_index] +=
+          subtree_sizes[node.getNeighborIndex(LEFT).getVectorIndex()] +
+          subtree_sizes[node.getNeighborIndex(RIGHT).getVectorIndex()];
+    }
+    spr_gains[vec_index] *= gain_decay;
+
+    if (!node.isOutdated()) {
+      spr_outdated_rounds[vec_index] = NOT_OUTDATED;
+    } else if (node.getSPRCount() <= 5) {
+      if (spr_outdated_rounds[vec_index] == NOT_OUTDATED) {
+        spr_outdated_rounds[vec_index] = spr_round;
+      }
+      enqueue(vec_index);
+    }
+  }
+
+  // the improvements of the recently processed nodes, used to project the
+  // improvement of the remaining nodes
+  const size_t window_size = std::max(static_cast<size_t>(500),
+                                      static_cast<size_t>(num_nodes_in_tree / 20));
+  std::vector<RealNumType> recent_improvements(window_size, 0);
+  RealNumType recent_improvement = 0;
+  size_t num_processed = 0;
+
+  std::vector<Index> batch_nodes;
+  batch_nodes.reserve(batch_size);
+  std::vector<RealNumType> improvements;
+  while (!node_queue.empty()) {
+    // pick the next batch of the most promising nodes (skipping the stale
+    // entries, whose priorities no longer match the gains/outdated rounds of
+    // their nodes, and the nodes already processed)
+    batch_nodes.clear();
+    while (!node_queue.empty() && batch_nodes.size() < batch_size) {
+      const QueueItem item = node_queue.top();
+      const NumSeqsType vec_index = item.second;
+      node_queue.pop();
+      if (!queued[vec_index] || item.first != getPriority(vec_index)) {
+        continue;
+      }
+      queued[vec_index] = false;
+      --num_queued;
+      PhyloNode& node = nodes[vec_index];
+      if (node.isOutdated() && node.getSPRCount() <= 5) {
+        node.setOutdated(false);
+        spr_outdated_rounds[vec_index] = NOT_OUTDATED;
+        batch_nodes.push_back(Index(vec_index, TOP));
+      }
+    }
+
+    // do SPR moves to improve the tree
+    if (batch_size == 1 && batch_nodes.size() == 1) {
+      improvements.assign(
+          1, improveSubTree<num_states>(
+                 batch_nodes[0], nodes[batch_nodes[0].getVectorIndex()],
+                 tree_search_type, short_range_search));
+      total_improvement += improvements[0];
+    } else {
+      total_improvement += improveSubTreesInBatch<num_states>(
+          batch_nodes, tree_search_type, short_range_search, improvements);
+    }
+
+    // record the gains at the nodes and their parents, and move their
+    // (outdated) parents forward in the queue
+    for (size_t j = 0; j < batch_nodes.size(); ++j) {
+      const RealNumType improvement = improvements[j];
+      recent_improvement += improvement -
+                            recent_improvements[num_processed % window_size];
+      recent_improvements[num_processed % window_size] = improvement;
+      ++num_processed;
+      if (improvement <= 0) {
+        continue;
+      }
+
+      const NumSeqsType vec_index = batch_nodes[j].getVectorIndex();
+      spr_gains[vec_index] += improvement;
+      if (vec_index != root_vector_index) {
+        const NumSeqsType parent_vec =
+            nodes[vec_index].getNeighborIndex(TOP).getVectorIndex();
+        spr_gains[parent_vec] += gain_decay * improvement;
+        if (nodes[parent_vec].isOutdated() &&
+            spr_outdated_rounds[parent_vec] != NOT_OUTDATED) {
+          enqueue(parent_vec);
+        }
+      }
+    }
+
+    // Show log every 1000 nodes
+    num_nodes += static_cast<PositionType>(batch_nodes.size());
+    if (cmaple::verbose_mode >= cmaple::VB_MED &&
+        num_nodes - count_node_1K >= 1000 &&
+        tree_search_type != FAST_TREE_SEARCH) {
+      std::cout << "Processed topology for " << convertIntToString(num_nodes)
+                << " nodes." << std::endl;
+      count_node_1K = num_nodes;
+    }
+
+    // stop if the budget of the tree search is exhausted
+    num_spr_evaluations += static_cast<int64_t>(batch_nodes.size());
+    if (checkSearchBudget()) {
+      break;
+    }
+
+    // stop early if the projected improvement of the remaining nodes (whose
+    // expected improvements are lower than those of the recent ones) is small
+    if (params->spr_early_stop && num_processed >= window_size &&
+        recent_improvement / window_size * num_queued <
+            params->thresh_entire_tree_improvement) {
+      if (cmaple::verbose_mode >= cmaple::VB_DEBUG) {
+        std::cout << "Stop seeking SPR moves with " << num_queued
+                  << " nodes remaining in the queue." << std::endl;
+      }
+      break;
+    }
+  }
+
+  return total_improvement;
+}
+
+bool cmaple::Tree::checkSearchBudget() {
+  if (search_stopped) {
+    return true;
+  }
+
+  // stop if the maximum number of SPR evaluations is reached
+  if (params->max_spr_evaluations > 0 &&
+      num_spr_evaluations >= params->max_spr_evaluations) {
+    search_stopped = true;
+    return true;
+  }
+
+  // no need to check the time
+  if (params->search_time_limit <= 0 && params->checkpoint_interval <= 0) {
+    return false;
+  }
+
+  // stop if the time limit is reached
+  const double current_time = getRealTime();
+  if (params->search_time_limit > 0 &&
+      current_time - search_start_time >= params->search_time_limit) {
+    search_stopped = true;
+    return true;
+  }
+
+  // save the current tree periodically
+  if (params->checkpoint_interval > 0 &&
+      current_time - last_checkpoint_time >= params->checkpoint_interval) {
+    saveSearchCheckpoint();
+    last_checkpoint_time = getRealTime();
+  }
+
+  return false;
+}
+
+void cmaple::Tree::saveSearchCheckpoint() {
+  assert(params->checkpoint_path.length());
+
+  saveCheckpoint(params->checkpoint_path);
+  const std::string tree_str =
+      exportNewick(parseTreeType(params->tree_format_str));
+  writeFileAtomically(params->checkpoint_path + ".treefile",
+                      [&tree_str](std::ostream& out) { out << tree_str; });
+
+  if (cmaple::verbose_mode >= cmaple::VB_MED) {
+    std::cout << "Saved the current tree to " << params->checkpoint_path
+              << ".treefile" << std::endl;
+  }
+}
+
 void calculateSubtreeCost_R_R(const SeqRegion& seq1_region,
                               const RealNumType* const& cumulative_rate,
                               RealNumType& total_blength,
@@ -6579,9 +8031,10 @@ void calculateSubtreeCost_R_R(const SeqRegion& seq1_region,
   }
 }
 
-template <const StateType num_states>
-void calculateSubtreeCost_R_O(const SeqRegion& seq1_region,
-                              const SeqRegion& seq2_region,
+template <const StateType num_states, typename Region>
+CMAPLE_SIMD_KERNEL
+void calculateSubtreeCost_R_O(const Region& seq1_region,
+                              const Region& seq2_region,
                               const RealNumType total_blength,
                               const StateType seq1_state,
                               RealNumType& total_factor,
@@ -6589,6 +8042,12 @@ void calculateSubtreeCost_R_O(const SeqRegion& seq1_region,
   RealNumType tot = 0;
   PositionType pos = seq2_region.position;
   if (seq1_region.plength_observation2root >= 0) {
+    // the likelihoods of each state i evolving to seq2
+    RealNumType mut_lh[num_states];
+    if (total_blength > 0) {
+      matrixVectorProduct<num_states>(model->getMutationMatrix(pos),
+                                      &((*seq2_region.likelihood)[0]), mut_lh);
+    }
 
     for (StateType i = 0; i < num_states; ++i) {
       // NHANLT NOTE: UNSURE
@@ -6607,11 +8066,7 @@ void calculateSubtreeCost_R_O(const SeqRegion& seq1_region,
       // tot3: likelihood of i evolves to j
       // tot3 = (1 + mut[i,i] * total_blength) * lh(seq2,i) + mut[i,j] *
       // total_blength * lh(seq2,j)
-      const RealNumType* mutation_mat_row = model->getMutationMatrixRow(i, pos);
-      RealNumType tot3 =
-          total_blength > 0
-              ? (total_blength * dotProduct<num_states>(mutation_mat_row, &((*seq2_region.likelihood)[0])))
-              : 0;
+      RealNumType tot3 = total_blength > 0 ? (total_blength * mut_lh[i]) : 0;
 
       // NHANLT NOTE:
       // tot = tot2 * tot3
@@ -6636,8 +8091,9 @@ void calculateSubtreeCost_R_O(const SeqRegion& seq1_region,
   total_factor *= tot;
 }
 
-bool calculateSubtreeCost_R_ACGT(const SeqRegion& seq1_region,
-                                 const SeqRegion& seq2_region,
+template <typename Region>
+bool calculateSubtreeCost_R_ACGT(const Region& seq1_region,
+                                 const Region& seq2_region,
                                  const RealNumType total_blength,
                                  const StateType seq1_state,
                                  const StateType seq2_state,
@@ -6709,9 +8165,10 @@ bool calculateSubtreeCost_R_ACGT(const SeqRegion& seq1_region,
   return true;
 }
 
-template <const StateType num_states>
-void calculateSubtreeCost_O_O(const SeqRegion& seq1_region,
-                              const SeqRegion& seq2_region,
+template <const StateType num_states, typename Region>
+CMAPLE_SIMD_KERNEL
+void calculateSubtreeCost_O_O(const Region& seq1_region,
+                              const Region& seq2_region,
                               const RealNumType total_blength,
                               RealNumType& total_factor,
                               const ModelBase* model) {
@@ -6730,9 +8187,10 @@ void calculateSubtreeCost_O_O(const SeqRegion& seq1_region,
   }
 }
 
-template <const StateType num_states>
-void calculateSubtreeCost_O_RACGT(const SeqRegion& seq1_region,
-                                  const SeqRegion& seq2_region,
+template <const StateType num_states, typename Region>
+CMAPLE_SIMD_KERNEL
+void calculateSubtreeCost_O_RACGT(const Region& seq1_region,
+                                  const Region& seq2_region,
                                   const RealNumType total_blength,
                                   const PositionType end_pos,
                                   RealNumType& total_factor,
@@ -6761,8 +8219,9 @@ void calculateSubtreeCost_O_RACGT(const SeqRegion& seq1_region,
   }
 }
 
-void calculateSubtreeCost_identicalACGT(const SeqRegion& seq1_region,
-                                        const SeqRegion& seq2_region,
+template <typename Region>
+void calculateSubtreeCost_identicalACGT(const Region& seq1_region,
+                                        const Region& seq2_region,
                                         RealNumType& total_blength,
                                         RealNumType& lh_cost,
                                         const ModelBase* model) { 
@@ -6777,9 +8236,10 @@ void calculateSubtreeCost_identicalACGT(const SeqRegion& seq1_region,
   }
 }
 
-template <const StateType num_states>
-void calculateSubtreeCost_ACGT_O(const SeqRegion& seq1_region,
-                                 const SeqRegion& seq2_region,
+template <const StateType num_states, typename Region>
+CMAPLE_SIMD_KERNEL
+void calculateSubtreeCost_ACGT_O(const Region& seq1_region,
+                                 const Region& seq2_region,
                                  const RealNumType total_blength,
                                  RealNumType& total_factor,
                                  const ModelBase* model) {
@@ -6809,8 +8269,9 @@ void calculateSubtreeCost_ACGT_O(const SeqRegion& seq1_region,
   }
 }
 
-bool calculateSubtreeCost_ACGT_RACGT(const SeqRegion& seq1_region,
-                                     const SeqRegion& seq2_region,
+template <typename Region>
+bool calculateSubtreeCost_ACGT_RACGT(const Region& seq1_region,
+                                     const Region& seq2_region,
                                      const RealNumType total_blength,
                                      const PositionType end_pos,
                                      RealNumType& total_factor,
@@ -6905,13 +8366,20 @@ RealNumType cmaple::Tree::calculateSubTreePlacementCost(
     return MIN_NEGATIVE;
   }
 
+  return calculateSubTreePlacementCostRegions<num_states>(
+      *parent_regions, *child_regions, blength);
+}
+
+template <const StateType num_states, typename RegionsType>
+RealNumType cmaple::Tree::calculateSubTreePlacementCostRegions(
+    const RegionsType& seq1_regions,
+    const RegionsType& seq2_regions,
+    const RealNumType blength) {
   // 55% of runtime
   // init dummy variables
   RealNumType lh_cost = 0;
   PositionType pos = 0;
   RealNumType total_factor = 1;
-  const SeqRegions& seq1_regions = *parent_regions;
-  const SeqRegions& seq2_regions = *child_regions;
   size_t iseq1 = 0;
   size_t iseq2 = 0;
   const PositionType seq_length = static_cast<PositionType>(aln->ref_seq.size());
@@ -6925,36 +8393,36 @@ RealNumType cmaple::Tree::calculateSubTreePlacementCost(
     RealNumType total_blength;
 
     // get the next shared segment in the two sequences
-    SeqRegions::getNextSharedSegment(pos, seq1_regions, seq2_regions, iseq1,
-                                     iseq2, end_pos);
-    const auto* const seq1_region = &seq1_regions[iseq1];
-    const auto* const seq2_region = &seq2_regions[iseq2];
+    RegionsType::getNextSharedSegment(pos, seq1_regions, seq2_regions, iseq1,
+                                      iseq2, end_pos);
+    const auto& seq1_region = seq1_regions[iseq1];
+    const auto& seq2_region = seq2_regions[iseq2];
 
     // 1. e1.type = N || e2.type = N
-    if ((seq2_region->type == TYPE_N) + (seq1_region->type == TYPE_N)) {
+    if ((seq2_region.type == TYPE_N) + (seq1_region.type == TYPE_N)) {
       pos = end_pos + 1;
       continue;
     }
 
     // e1.type != N && e2.type != N
     const DoubleState s1s2 =
-        (DoubleState(seq1_region->type) << 8) | seq2_region->type;
+        (DoubleState(seq1_region.type) << 8) | seq2_region.type;
 
     // total_blength will be here the total length from the root or from the
     // upper node, down to the down node.
-    if (seq1_region->plength_observation2root >= 0) {
+    if (seq1_region.plength_observation2root >= 0) {
       total_blength =
-          seq1_region->plength_observation2root + (blength >= 0 ? blength : 0);
-    } else if (seq1_region->plength_observation2node >= 0) {
+          seq1_region.plength_observation2root + (blength >= 0 ? blength : 0);
+    } else if (seq1_region.plength_observation2node >= 0) {
       total_blength =
-          seq1_region->plength_observation2node + (blength >= 0 ? blength : 0);
+          seq1_region.plength_observation2node + (blength >= 0 ? blength : 0);
     } else {
       total_blength = blength;
     }
 
-    if (seq2_region->plength_observation2node >= 0) {
+    if (seq2_region.plength_observation2node >= 0) {
       total_blength = (total_blength > 0 ? total_blength : 0) +
-                      seq2_region->plength_observation2node;
+                      seq2_region.plength_observation2node;
     }
 
     // assert(total_blength >= 0); // can be -1 ..
@@ -6962,23 +8430,23 @@ RealNumType cmaple::Tree::calculateSubTreePlacementCost(
     // 2.1. e1.type = R and e2.type = R
     if (s1s2 == RR) [[likely]] {
         // update to match MAPLE v0.6.8 -> do nothing
-      // calculateSubtreeCost_R_R(*seq1_region, cumulative_rate, total_blength,
+      // calculateSubtreeCost_R_R(seq1_region, cumulative_rate, total_blength,
                                // pos, end_pos, lh_cost);
     }
     // 2.2. e1.type = R and e2.type = O
     else if (s1s2 == RO) {
-      calculateSubtreeCost_R_O<num_states>(*seq1_region, *seq2_region,
+      calculateSubtreeCost_R_O<num_states>(seq1_region, seq2_region,
                                            total_blength,
                                            aln->ref_seq[static_cast<
                 std::vector<cmaple::StateType>::size_type>(end_pos)],
                                            total_factor, model);
     }
     // 2.3. e1.type = R and e2.type = A/C/G/T
-    else if (seq1_region->type == TYPE_R) {
-      if (!calculateSubtreeCost_R_ACGT(*seq1_region, *seq2_region, total_blength,
+    else if (seq1_region.type == TYPE_R) {
+      if (!calculateSubtreeCost_R_ACGT(seq1_region, seq2_region, total_blength,
                                        aln->ref_seq[static_cast<
                 std::vector<cmaple::StateType>::size_type>(end_pos)],
-                                       seq2_region->type,
+                                       seq2_region.type,
                                        total_factor, model)) {
         return MIN_NEGATIVE;
       }
@@ -6986,29 +8454,29 @@ RealNumType cmaple::Tree::calculateSubTreePlacementCost(
     // 3. e1.type = O
     // 3.1. e1.type = O and e2.type = O
     else if (s1s2 == OO) {
-      calculateSubtreeCost_O_O<num_states>(*seq1_region, *seq2_region,
+      calculateSubtreeCost_O_O<num_states>(seq1_region, seq2_region,
                                            total_blength, total_factor, model);
     }
     // 3.2. e1.type = O and e2.type = R or A/C/G/T
-    else if (seq1_region->type == TYPE_O) {
-      calculateSubtreeCost_O_RACGT<num_states>(*seq1_region, *seq2_region,
+    else if (seq1_region.type == TYPE_O) {
+      calculateSubtreeCost_O_RACGT<num_states>(seq1_region, seq2_region,
                                                total_blength, end_pos,
                                                total_factor, aln, model);
     }
     // 4. e1.type = A/C/G/T
     // 4.1. e1.type =  e2.type
-    else if (seq1_region->type == seq2_region->type) {
-      calculateSubtreeCost_identicalACGT(*seq1_region, *seq2_region, total_blength, lh_cost, model);
+    else if (seq1_region.type == seq2_region.type) {
+      calculateSubtreeCost_identicalACGT(seq1_region, seq2_region, total_blength, lh_cost, model);
     }
     // e1.type = A/C/G/T and e2.type = O/A/C/G/T
     // 4.2. e1.type = A/C/G/T and e2.type = O
-    else if (seq2_region->type == TYPE_O) {
+    else if (seq2_region.type == TYPE_O) {
       calculateSubtreeCost_ACGT_O<num_states>(
-          *seq1_region, *seq2_region, total_blength, total_factor, model);
+          seq1_region, seq2_region, total_blength, total_factor, model);
     }
     // 4.3. e1.type = A/C/G/T and e2.type = R or A/C/G/T
     else {
-      if (!calculateSubtreeCost_ACGT_RACGT(*seq1_region, *seq2_region,
+      if (!calculateSubtreeCost_ACGT_RACGT(seq1_region, seq2_region,
                                            total_blength, end_pos, total_factor,
                                            aln, model)) {
         return MIN_NEGATIVE;
@@ -7059,6 +8527,7 @@ void calculateSampleCost_R_R(const SeqRegion& seq1_region,
 }
 
 template <const StateType num_states>
+CMAPLE_SIMD_KERNEL
 void calculateSampleCost_R_O(const SeqRegion& seq1_region,
                              const SeqRegion& seq2_region,
                              const RealNumType blength,
@@ -7162,6 +8631,7 @@ void calculateSampleCost_R_ACGT(const SeqRegion& seq1_region,
 }
 
 template <const StateType num_states>
+CMAPLE_SIMD_KERNEL
 void calculateSampleCost_O_O(const SeqRegion& seq1_region,
                              const SeqRegion& seq2_region,
                              const RealNumType blength,
@@ -7191,6 +8661,7 @@ void calculateSampleCost_O_O(const SeqRegion& seq1_region,
 }
 
 template <const StateType num_states>
+CMAPLE_SIMD_KERNEL
 void calculateSampleCost_O_RACGT(const SeqRegion& seq1_region,
                                  const SeqRegion& seq2_region,
                                  const RealNumType blength,
@@ -7233,6 +8704,7 @@ void calculateSampleCost_identicalACGT(const SeqRegion& seq1_region,
 }
 
 template <const StateType num_states>
+CMAPLE_SIMD_KERNEL
 void calculateSampleCost_ACGT_O(const SeqRegion& seq1_region,
                                 const SeqRegion& seq2_region,
                                 const RealNumType blength,
@@ -7635,16 +9107,7 @@ void cmaple::Tree::computeLhContribution(
       params->threshold_prob, true);
   total_lh += lh_contribution;
   // record the likelihood contribution at this node
-  // if likelihood contribution of this node has not yet existed -> add a new
-  // one
-  if (node.getNodelhIndex() == 0) {
-    node_lhs.emplace_back(lh_contribution);
-    node.setNodeLhIndex(static_cast<NumSeqsType>(node_lhs.size()) - 1);
-  }
-  // otherwise, update it
-  else {
-    node_lhs[node.getNodelhIndex()].setLhContribution(lh_contribution);
-  }
+  setNodeLhContribution(node, lh_contribution);
 
   // if new_lower_lh is NULL
   // assert(params.has_value());
@@ -7664,6 +9127,54 @@ void cmaple::Tree::computeLhContribution(
   }
 }
 
+template <const StateType num_states>
+void cmaple::Tree::updateLowerLhAndLhContribution(
+    RealNumType& total_lh,
+    std::unique_ptr<SeqRegions>& new_lower_lh,
+    PhyloNode& node,
+    const std::unique_ptr<SeqRegions>& lower_lh_1,
+    const std::unique_ptr<SeqRegions>& lower_lh_2,
+    const Index neighbor_1_index,
+    PhyloNode& neighbor_1,
+    const Index neighbor_2_index,
+    PhyloNode& neighbor_2,
+    const PositionType& seq_length) {
+  RealNumType lh_contribution = lower_lh_1->mergeTwoLowers<num_states>(
+      new_lower_lh, neighbor_1.getUpperLength(), *lower_lh_2,
+      neighbor_2.getUpperLength(), aln, model, cumulative_rate,
+      params->threshold_prob, true);
+
+  // if new_lower_lh is NULL -> update the branch lengths connecting the
+  // current node to its children, which may change the lower lhs of the nodes
+  // already visited -> the contributions must be recomputed
+  if (!new_lower_lh) {
+    total_lh = std::numeric_limits<RealNumType>::quiet_NaN();
+    updateLowerLh<num_states>(total_lh, new_lower_lh, node, lower_lh_1,
+                              lower_lh_2, neighbor_1_index, neighbor_1,
+                              neighbor_2_index, neighbor_2, seq_length);
+  }
+  // otherwise, everything is good -> update the lower lh of the current node
+  else {
+    total_lh += lh_contribution;
+    setNodeLhContribution(node, lh_contribution);
+    node.setPartialLh(TOP, std::move(new_lower_lh));
+  }
+}
+
+void cmaple::Tree::setNodeLhContribution(PhyloNode& node,
+                                         const RealNumType lh_contribution) {
+  // if likelihood contribution of this node has not yet existed -> add a new
+  // one
+  if (node.getNodelhIndex() == 0) {
+    node_lhs.emplace_back(lh_contribution);
+    node.setNodeLhIndex(static_cast<NumSeqsType>(node_lhs.size()) - 1);
+  }
+  // otherwise, update it
+  else {
+    node_lhs[node.getNodelhIndex()].setLhContribution(lh_contribution);
+  }
+}
+
 template <void (cmaple::Tree::*task)(RealNumType&,
                                      std::unique_ptr<SeqRegions>&,
                                      PhyloNode&,
@@ -7771,7 +9282,15 @@ void cmaple::Tree::calculate_aRLT(const bool allow_replacing_ML_tree) {
       lh_at_root +
       performDFS<&cmaple::Tree::computeLhContribution<num_states>>();
 
-  // traverse tree to calculate aLRT-SH for each internal branch
+  // first, compute the aLRT of all internal branches concurrently, without
+  // changing the tree; that's done if the ML tree needn't be replaced
+  if (calculate_aRLTConcurrently<num_states>(allow_replacing_ML_tree,
+                                             lh_at_root)) {
+    return;
+  }
+
+  // otherwise, traverse tree to calculate aLRT-SH for each internal branch,
+  // replacing the ML tree by the better NNI neighbors found on the way
   PhyloNode& root = nodes[root_vector_index];
   std::stack<Index> node_stack;
   if (root.isInternal()) {
@@ -7835,6 +9354,8 @@ void cmaple::Tree::calculate_aRLT(const bool allow_replacing_ML_tree) {
           tree_total_lh += neighbor_3_lh_diff;
           continue;
         }
+        warnBetterNNINeighbor(neighbor_2_lh_diff);
+        warnBetterNNINeighbor(neighbor_3_lh_diff);
 
         // record neighbor_2_lh_diff, neighbor_2_lh_diff
         NodeLh& node_lh = node_lhs[node.getNodelhIndex()];
@@ -7855,10 +9376,97 @@ void cmaple::Tree::calculate_aRLT(const bool allow_replacing_ML_tree) {
 }
 
 template <const StateType num_states>
-void cmaple::Tree::calSiteLhDiffRoot(
-    std::vector<RealNumType>& site_lh_diff,
-    std::vector<RealNumType>& site_lh_root_diff,
-    const std::vector<RealNumType>& site_lh_root,
+bool cmaple::Tree::calculate_aRLTConcurrently(
+    const bool allow_replacing_ML_tree,
+    RealNumType lh_at_root) {
+  // collect the internal branches
+  std::vector<NumSeqsType> branch_vecs;
+  PhyloNode& root = nodes[root_vector_index];
+  std::stack<Index> node_stack;
+  if (root.isInternal()) {
+    node_stack.push(root.getNeighborIndex(RIGHT));
+    node_stack.push(root.getNeighborIndex(LEFT));
+  }
+  while (!node_stack.empty()) {
+    const Index node_index = node_stack.top();
+    node_stack.pop();
+    PhyloNode& node = nodes[node_index.getVectorIndex()];
+
+    if (node.isInternal()) {
+      node_stack.push(node.getNeighborIndex(RIGHT));
+      node_stack.push(node.getNeighborIndex(LEFT));
+      branch_vecs.push_back(node_index.getVectorIndex());
+    }
+  }
+
+  // compute the likelihood differences between each nni neighbor and the
+  // current tree (only for non-zero branches)
+  const int num_branches = static_cast<int>(branch_vecs.size());
+  std::vector<RealNumType> lh_diffs_2(branch_vecs.size(), 0);
+  std::vector<RealNumType> lh_diffs_3(branch_vecs.size(), 0);
+  bool found_better_tree = false;
+#pragma omp parallel
+  {
+    // calculateNNILh() only uses node_stack_aLRT (and changes lh_at_root) when
+    // replacing the ML tree
+    std::stack<Index> node_stack_aLRT;
+    RealNumType thread_lh_at_root = lh_at_root;
+#pragma omp for schedule(dynamic) reduction(|| : found_better_tree)
+    for (int i = 0; i < num_branches; ++i) {
+      PhyloNode& node = nodes[branch_vecs[i]];
+      if (node.getUpperLength() <= 0) {
+        continue;
+      }
+
+      PhyloNode& child_1 = nodes[node.getNeighborIndex(RIGHT).getVectorIndex()];
+      PhyloNode& child_2 = nodes[node.getNeighborIndex(LEFT).getVectorIndex()];
+      const Index parent_index = node.getNeighborIndex(TOP);
+      PhyloNode& parent = nodes[parent_index.getVectorIndex()];
+      PhyloNode& sibling =
+          nodes[parent.getNeighborIndex(parent_index.getFlipMiniIndex())
+                    .getVectorIndex()];
+
+      calculateNNILh<num_states>(node_stack_aLRT, lh_diffs_2[i], node, child_1,
+                                 child_2, sibling, parent, parent_index,
+                                 thread_lh_at_root, false);
+      calculateNNILh<num_states>(node_stack_aLRT, lh_diffs_3[i], node, child_2,
+                                 child_1, sibling, parent, parent_index,
+                                 thread_lh_at_root, false);
+      found_better_tree = found_better_tree || lh_diffs_2[i] > 0 ||
+                          lh_diffs_3[i] > 0;
+    }
+  }
+
+  // the ML tree should be replaced by a better NNI neighbor -> redo it
+  // serially
+  if (allow_replacing_ML_tree && found_better_tree) {
+    return false;
+  }
+
+  // record the results
+  for (int i = 0; i < num_branches; ++i) {
+    PhyloNode& node = nodes[branch_vecs[i]];
+    node.setOutdated(false);
+    NodeLh& node_lh = node_lhs[node.getNodelhIndex()];
+    node_lh.setLhDiff2(lh_diffs_2[i]);
+    node_lh.setLhDiff3(lh_diffs_3[i]);
+    warnBetterNNINeighbor(lh_diffs_2[i]);
+    warnBetterNNINeighbor(lh_diffs_3[i]);
+  }
+
+  return true;
+}
+
+void cmaple::Tree::warnBetterNNINeighbor(const RealNumType lh_diff) {
+  if (lh_diff > 0 && cmaple::verbose_mode >= cmaple::VB_MED) {
+    outWarning("Found an NNI neighbor tree with a higher likelihood (by " +
+               convertDoubleToString(lh_diff) + ") than the current ML tree");
+  }
+}
+
+template <const StateType num_states>
+bool cmaple::Tree::calSiteLhDiffRoot(
+    SiteLhDiffBuffers& buffers,
     std::unique_ptr<SeqRegions>& parent_new_lower_lh,
     const RealNumType& child_2_new_blength,
     PhyloNode& current_node,
@@ -7878,8 +9486,9 @@ void cmaple::Tree::calSiteLhDiffRoot(
       child_2.getPartialLh(TOP);
   std::unique_ptr<SeqRegions> new_parent_new_lower_lh = nullptr;
   std::unique_ptr<SeqRegions> tmp_lower_lh = nullptr;
-  const std::vector<cmaple::StateType>::size_type seq_length = aln->ref_seq.size();
-  std::vector<RealNumType> site_lh_diff_old(seq_length, 0);
+  std::vector<RealNumType>& site_lh_diff = buffers.site_lh_diff;
+  std::vector<RealNumType>& site_lh_diff_old = buffers.site_lh_diff_old;
+  std::vector<RealNumType>& site_lh_root_diff = buffers.site_lh_root_diff;
 
   // 2. estimate x ~ the length of the new branch connecting the parent and the
   // new_parent nodes
@@ -7887,8 +9496,7 @@ void cmaple::Tree::calSiteLhDiffRoot(
   // merge 2 lower vector into one
   // NHANLT: avoid null
   if (!parent_new_lower_lh) {
-    std::fill(site_lh_diff.begin(), site_lh_diff.end(), MIN_NEGATIVE);
-    return;
+    return false;
   }
   RealNumType best_parent_lh = parent_new_lower_lh->mergeTwoLowers<num_states>(
       new_parent_new_lower_lh, parent_new_blength, *child_1_lower_regions,
@@ -7925,8 +9533,7 @@ void cmaple::Tree::calSiteLhDiffRoot(
   // 5.2. for the parent node
   // NHANLT: avoid null
   if (!new_parent_new_upper_lr_1) {
-    std::fill(site_lh_diff.begin(), site_lh_diff.end(), MIN_NEGATIVE);
-    return;
+    return false;
   }
   std::unique_ptr<SeqRegions> parent_new_upper_lr_1 = nullptr;
   new_parent_new_upper_lr_1->mergeUpperLower<num_states>(
@@ -7961,44 +9568,39 @@ void cmaple::Tree::calSiteLhDiffRoot(
   child_2_lower_lh->calculateSiteLhContributions<num_states>(
       site_lh_diff, parent_new_lower_lh, child_2_best_blength,
       *sibling_lower_lh, sibling_best_blength, aln, model, cumulative_rate,
-      threshold_prob);
+      threshold_prob, &buffers.rate_breakpoints,
+      &buffers.updated_positions);
   child_2_lower_lh->calculateSiteLhContributions<num_states>(
       site_lh_diff_old, tmp_lower_lh, child_2.getUpperLength(),
       *child_1_lower_regions, child_1.getUpperLength(), aln, model,
-      cumulative_rate, threshold_prob);
+      cumulative_rate, threshold_prob, &buffers.rate_breakpoints_old,
+      &buffers.updated_positions);
   // 7.2. the new_parent node
   // NHANLT: avoid null
   if (!parent_new_lower_lh) {
-    std::fill(site_lh_diff.begin(), site_lh_diff.end(), MIN_NEGATIVE);
-    return;
+    return false;
   }
   parent_new_lower_lh->calculateSiteLhContributions<num_states>(
       site_lh_diff, new_parent_new_lower_lh, parent_best_blength,
       *child_1_lower_regions, child_1_best_blength, aln, model, cumulative_rate,
-      threshold_prob);
+      threshold_prob, &buffers.rate_breakpoints,
+      &buffers.updated_positions);
   current_node.getPartialLh(TOP)->calculateSiteLhContributions<num_states>(
       site_lh_diff_old, tmp_lower_lh, current_node.getUpperLength(),
       *sibling_lower_lh, sibling.getUpperLength(), aln, model, cumulative_rate,
-      threshold_prob);
+      threshold_prob, &buffers.rate_breakpoints_old,
+      &buffers.updated_positions);
   // 7.3 the absolute likelihood at root
-  new_parent_new_lower_lh->computeSiteLhAtRoot<num_states>(
-      site_lh_root_diff, model, cumulative_base);
-  // update site_lh_root_diff
-  for (std::vector<cmaple::StateType>::size_type j = 0; j < seq_length; ++j) {
-    site_lh_root_diff[j] -= site_lh_root[j];
-  }
+  new_parent_new_lower_lh->computeSiteLhDiffAtRoot<num_states>(
+      *nodes[root_vector_index].getPartialLh(TOP), site_lh_root_diff,
+      buffers.updated_positions, model, cumulative_base);
 
-  // calculate the site-lh differences between the new and the old ones
-  for (std::vector<cmaple::StateType>::size_type j = 0; j < seq_length; ++j) {
-    site_lh_diff[j] -= site_lh_diff_old[j];
-  }
+  return true;
 }
 
 template <const StateType num_states>
-void cmaple::Tree::calSiteLhDiffNonRoot(
-    std::vector<RealNumType>& site_lh_diff,
-    std::vector<RealNumType>& site_lh_root_diff,
-    const std::vector<RealNumType>& site_lh_root,
+bool cmaple::Tree::calSiteLhDiffNonRoot(
+    SiteLhDiffBuffers& buffers,
     std::unique_ptr<SeqRegions>& parent_new_lower_lh,
     const RealNumType& child_2_new_blength,
     PhyloNode& current_node,
@@ -8020,7 +9622,9 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
   std::unique_ptr<SeqRegions> new_parent_new_lower_lh = nullptr;
   std::unique_ptr<SeqRegions> tmp_lower_lh = nullptr;
   const std::vector<cmaple::StateType>::size_type seq_length = aln->ref_seq.size();
-  std::vector<RealNumType> site_lh_diff_old(seq_length, 0);
+  std::vector<RealNumType>& site_lh_diff = buffers.site_lh_diff;
+  std::vector<RealNumType>& site_lh_diff_old = buffers.site_lh_diff_old;
+  std::vector<RealNumType>& site_lh_root_diff = buffers.site_lh_root_diff;
 
   const std::unique_ptr<SeqRegions>& grand_parent_upper_lr =
       getPartialLhAtNode(parent.getNeighborIndex(TOP));
@@ -8040,8 +9644,7 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
   std::unique_ptr<SeqRegions> parent_new_mid_branch_lh = nullptr;
   // NHANLT: avoid null
   if (!grand_parent_upper_lr) {
-    std::fill(site_lh_diff.begin(), site_lh_diff.end(), MIN_NEGATIVE);
-    return;
+    return false;
   }
   grand_parent_upper_lr->mergeUpperLower<num_states>(
       parent_new_mid_branch_lh, parent_mid_blength, *parent_new_lower_lh,
@@ -8097,8 +9700,7 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
   // 4. recompute the lower_lh of the new_parent
   // NHANLT: avoid null
   if (!parent_new_lower_lh) {
-    std::fill(site_lh_diff.begin(), site_lh_diff.end(), MIN_NEGATIVE);
-    return;
+    return false;
   }
   parent_new_lower_lh->mergeTwoLowers<num_states>(
       new_parent_new_lower_lh, parent_new_blength, *child_1_lower_regions,
@@ -8118,8 +9720,7 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
   // 5.2. for the parent node
   // NHANLT: avoid null
   if (!new_parent_new_upper_lr_1) {
-    std::fill(site_lh_diff.begin(), site_lh_diff.end(), MIN_NEGATIVE);
-    return;
+    return false;
   }
   std::unique_ptr<SeqRegions> parent_new_upper_lr_1 = nullptr;
   new_parent_new_upper_lr_1->mergeUpperLower<num_states>(
@@ -8159,22 +9760,24 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
   child_2_lower_lh->calculateSiteLhContributions<num_states>(
       site_lh_diff, parent_new_lower_lh, child_2_best_blength,
       *sibling_lower_lh, sibling_best_blength, aln, model, cumulative_rate,
-      threshold_prob);
+      threshold_prob, &buffers.rate_breakpoints,
+      &buffers.updated_positions);
   child_2_lower_lh->calculateSiteLhContributions<num_states>(
       site_lh_diff_old, tmp_lower_lh, child_2.getUpperLength(),
       *child_1_lower_regions, child_1.getUpperLength(), aln, model,
-      cumulative_rate, threshold_prob);
+      cumulative_rate, threshold_prob, &buffers.rate_breakpoints_old,
+      &buffers.updated_positions);
   // 7.2. the new_parent node
   // NHANLT: avoid null
   if (!parent_new_lower_lh) {
-    std::fill(site_lh_diff.begin(), site_lh_diff.end(), MIN_NEGATIVE);
-    return;
+    return false;
   }
   RealNumType prev_lh_diff =
       parent_new_lower_lh->calculateSiteLhContributions<num_states>(
           site_lh_diff, new_parent_new_lower_lh, parent_best_blength,
           *child_1_lower_regions, child_1_best_blength, aln, model,
-          cumulative_rate, threshold_prob) -
+          cumulative_rate, threshold_prob, &buffers.rate_breakpoints,
+      &buffers.updated_positions) -
       node_lhs[parent.getNodelhIndex()].getLhContribution();
   // 7.3. other ancestors on the path from the new_parent to root (stop when the
   // change is insignificant)
@@ -8192,8 +9795,7 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
   while (true) {
     // NHANLT: avoid null
     if (!new_lower_lh) {
-      std::fill(site_lh_diff.begin(), site_lh_diff.end(), MIN_NEGATIVE);
-      return;
+      return false;
     }
 
     NumSeqsType node_vec = node_index.getVectorIndex();
@@ -8212,7 +9814,9 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
       tmp_child_1.getPartialLh(TOP)->calculateSiteLhContributions<num_states>(
           site_lh_diff_old, tmp_lower_lh, tmp_child_1.getUpperLength(),
           *tmp_child_2.getPartialLh(TOP), tmp_child_2.getUpperLength(), aln,
-          model, cumulative_rate, threshold_prob);
+          model, cumulative_rate, threshold_prob,
+          &buffers.rate_breakpoints_old,
+      &buffers.updated_positions);
 
       // cases when node is non-root
       if (root_vector_index != node_vec) {
@@ -8230,7 +9834,9 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
             new_lower_lh->calculateSiteLhContributions<num_states>(
                 site_lh_diff, tmp_new_lower_lh, tmp_blength,
                 *(tmp_sibling.getPartialLh(TOP)), tmp_sibling.getUpperLength(),
-                aln, model, cumulative_rate, params->threshold_prob) -
+                aln, model, cumulative_rate, params->threshold_prob,
+                &buffers.rate_breakpoints,
+      &buffers.updated_positions) -
             node_lhs[tmp_parent.getNodelhIndex()].getLhContribution();
 
         // move a step upwards
@@ -8245,13 +9851,9 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
       // case when node is root
       else {
         // re-calculate likelihood at root
-        new_lower_lh->computeSiteLhAtRoot<num_states>(site_lh_root_diff, model,
-                                                      cumulative_base);
-
-        // update site_lh_root_diff
-        for (std::vector<cmaple::StateType>::size_type j = 0; j < seq_length; ++j) {
-          site_lh_root_diff[j] -= site_lh_root[j];
-        }
+        new_lower_lh->computeSiteLhDiffAtRoot<num_states>(
+            *nodes[root_vector_index].getPartialLh(TOP), site_lh_root_diff,
+            buffers.updated_positions, model, cumulative_base);
 
         // stop traversing further
         break;
@@ -8265,22 +9867,20 @@ void cmaple::Tree::calSiteLhDiffNonRoot(
       bk_new_lower_lh->calculateSiteLhContributions<num_states>(
           site_lh_diff_old, tmp_new_lower_lh, bk_tmp_blength,
           *(tmp_sibling.getPartialLh(TOP)), bk_tmp_sibling_blength, aln, model,
-          cumulative_rate, params->threshold_prob);
+          cumulative_rate, params->threshold_prob,
+          &buffers.rate_breakpoints_old,
+      &buffers.updated_positions);
       break;
     }
   }
 
-  // calculate the site-lh differences between the new and the old ones
-  for (std::vector<cmaple::StateType>::size_type j = 0; j < seq_length; ++j) {
-    site_lh_diff[j] -= site_lh_diff_old[j];
-  }
+  return true;
 }
 
 template <const StateType num_states>
-void cmaple::Tree::calSiteLhDiff(std::vector<RealNumType>& site_lh_diff,
-                                 std::vector<RealNumType>& site_lh_root_diff,
-                                 const std::vector<RealNumType>& site_lh_root,
-                                 PhyloNode& current_node,
+void cmaple::Tree::calSiteLhDiff(SiteLhDiffs& site_lh_diffs,
+                                 SiteLhDiffBuffers& buffers,
+                                                              PhyloNode& current_node,
                                  PhyloNode& child_1,
                                  PhyloNode& child_2,
                                  PhyloNode& sibling,
@@ -8305,19 +9905,59 @@ void cmaple::Tree::calSiteLhDiff(std::vector<RealNumType>& site_lh_diff,
 
   // if the (old) parent is root
   // for more information, pls see https://tinyurl.com/5n8m5c8y
+  bool possible;
   if (root_vector_index == parent_index.getVectorIndex()) {
-    calSiteLhDiffRoot<num_states>(site_lh_diff, site_lh_root_diff, site_lh_root,
-                                  parent_new_lower_lh, child_2_new_blength,
-                                  current_node, child_1, child_2, sibling,
-                                  parent, parent_index);
+    possible = calSiteLhDiffRoot<num_states>(
+        buffers, parent_new_lower_lh, child_2_new_blength,
+        current_node, child_1, child_2, sibling, parent, parent_index);
     // otherwise, the (old) parent node is non-root
     // for more information, pls see https://tinyurl.com/ymr49jy8
   } else {
-    calSiteLhDiffNonRoot<num_states>(site_lh_diff, site_lh_root_diff,
-                                     site_lh_root, parent_new_lower_lh,
-                                     child_2_new_blength, current_node, child_1,
-                                     child_2, sibling, parent, parent_index);
+    possible = calSiteLhDiffNonRoot<num_states>(
+        buffers, parent_new_lower_lh, child_2_new_blength,
+        current_node, child_1, child_2, sibling, parent, parent_index);
+  }
+
+  // extract the non-zero differences between the new and the old site-lh
+  // contributions at the positions written above (the breakpoints at
+  // seq_length don't affect any site), then reset those positions for the next
+  // NNI neighbor
+  site_lh_diffs.impossible = !possible;
+  site_lh_diffs.site_diffs.clear();
+  site_lh_diffs.rate_diffs.clear();
+  const PositionType seq_length =
+      static_cast<PositionType>(aln->ref_seq.size());
+  RealNumType* const site_lh_diff = buffers.site_lh_diff.data();
+  RealNumType* const site_lh_diff_old = buffers.site_lh_diff_old.data();
+  RealNumType* const site_lh_root_diff = buffers.site_lh_root_diff.data();
+  RealNumType* const rate_breakpoints = buffers.rate_breakpoints.data();
+  RealNumType* const rate_breakpoints_old =
+      buffers.rate_breakpoints_old.data();
+  std::vector<PositionType>& updated_positions = buffers.updated_positions;
+  std::sort(updated_positions.begin(), updated_positions.end());
+  updated_positions.erase(
+      std::unique(updated_positions.begin(), updated_positions.end()),
+      updated_positions.end());
+  for (const PositionType j : updated_positions) {
+    if (j < seq_length) {
+      const RealNumType site_diff =
+          site_lh_diff[j] - site_lh_diff_old[j] + site_lh_root_diff[j];
+      if (site_diff != 0) {
+        site_lh_diffs.site_diffs.emplace_back(j, site_diff);
+      }
+      const RealNumType rate_diff =
+          rate_breakpoints[j] - rate_breakpoints_old[j];
+      if (rate_diff != 0) {
+        site_lh_diffs.rate_diffs.emplace_back(j, rate_diff);
+      }
+      site_lh_diff[j] = 0;
+      site_lh_diff_old[j] = 0;
+      site_lh_root_diff[j] = 0;
+    }
+    rate_breakpoints[j] = 0;
+    rate_breakpoints_old[j] = 0;
   }
+  updated_positions.clear();
 }
 
 void findTwoLargest(const RealNumType a,
@@ -8344,12 +9984,11 @@ void findTwoLargest(const RealNumType a,
 }
 
 template <const StateType num_states>
-PositionType cmaple::Tree::count_aRLT_SH_branch(
-    std::vector<RealNumType>& site_lh_contributions,
-    std::vector<RealNumType>& site_lh_root,
+void cmaple::Tree::calSiteLhDiffsBranch(
+    SiteLhDiffBuffers& buffers,
     PhyloNode& node,
-    const RealNumType& LT1) {
-  // caculate aLRT
+    SiteLhDiffs& site_lh_diffs_2,
+    SiteLhDiffs& site_lh_diffs_3) {
   const Index child_1_index = node.getNeighborIndex(RIGHT);
   const Index child_2_index = node.getNeighborIndex(LEFT);
   PhyloNode& child_1 = nodes[child_1_index.getVectorIndex()];
@@ -8359,111 +9998,54 @@ PositionType cmaple::Tree::count_aRLT_SH_branch(
   const Index sibling_index =
       parent.getNeighborIndex(parent_index.getFlipMiniIndex());
   PhyloNode& sibling = nodes[sibling_index.getVectorIndex()];
-  PositionType sh_count{0};
-  const std::vector<cmaple::StateType>::size_type seq_length = aln->ref_seq.size();
-  const NodeLh& nodelh = node_lhs[node.getNodelhIndex()];
-  const RealNumType LT2 = LT1 + nodelh.getLhDiff2();
-  const RealNumType LT3 = LT1 + nodelh.getLhDiff3();
-
-  // debug
-  /*if (!child_1.isInternal() && (aln->data[child_1.getSeqNameIndex()].seq_name
-  == "52")) std::cout << "sfdfds " <<std::endl;
-
-  if (!child_2.isInternal() && (aln->data[child_2.getSeqNameIndex()].seq_name ==
-  "52")) std::cout << "sfdfds " <<std::endl;*/
 
   // calculate site_lh differences
   // neighbor 2
-  std::vector<RealNumType> site_lh_diff_2(seq_length, 0);
-  std::vector<RealNumType> site_lh_root_diff_2(seq_length, 0);
-  calSiteLhDiff<num_states>(site_lh_diff_2, site_lh_root_diff_2, site_lh_root,
-                            node, child_1, child_2, sibling, parent,
-                            parent_index);
+  calSiteLhDiff<num_states>(site_lh_diffs_2, buffers, node,
+                            child_1, child_2, sibling, parent, parent_index);
   // neighbor 3
-  std::vector<RealNumType> site_lh_diff_3(seq_length, 0);
-  std::vector<RealNumType> site_lh_root_diff_3(seq_length, 0);
-  calSiteLhDiff<num_states>(site_lh_diff_3, site_lh_root_diff_3, site_lh_root,
-                            node, child_2, child_1, sibling, parent,
-                            parent_index);
+  calSiteLhDiff<num_states>(site_lh_diffs_3, buffers, node,
+                            child_2, child_1, sibling, parent, parent_index);
 
   // validate the results
-  RealNumType lh_diff_2{0};
-  RealNumType lh_diff_3{0};
-  for (std::vector<cmaple::StateType>::size_type j = 0; j < seq_length; ++j) {
-    lh_diff_2 += site_lh_diff_2[j];
-    lh_diff_2 += site_lh_root_diff_2[j];
-
-    lh_diff_3 += site_lh_diff_3[j];
-    lh_diff_3 += site_lh_root_diff_3[j];
-  }
 #ifdef DEBUG
-  assert(isinf(lh_diff_2) || fabs(lh_diff_2 - nodelh.getLhDiff2()) < 1e-3);
-  assert(isinf(lh_diff_3) || fabs(lh_diff_3 - nodelh.getLhDiff3()) < 1e-3);
-#endif
-
-// iterate a number of replicates
-#pragma omp parallel reduction(+ : sh_count)
-  {
-    std::vector<PositionType> selected_sites(seq_length);
-    int thread_id = 0;
-#ifdef _OPENMP
-    thread_id = omp_get_thread_num();
+  const PositionType seq_length =
+      static_cast<PositionType>(aln->ref_seq.size());
+  auto sum_diffs = [&](const SiteLhDiffs& site_lh_diffs) {
+    RealNumType lh_diff{0};
+    for (const auto& site_diff : site_lh_diffs.site_diffs) {
+      lh_diff += site_diff.second;
+    }
+    for (const auto& rate_diff : site_lh_diffs.rate_diffs) {
+      lh_diff += rate_diff.second * (cumulative_rate[seq_length] -
+                                     cumulative_rate[rate_diff.first]);
+    }
+    return lh_diff;
+  };
+  const NodeLh& nodelh = node_lhs[node.getNodelhIndex()];
+  const RealNumType lh_diff_2 = sum_diffs(site_lh_diffs_2);
+  const RealNumType lh_diff_3 = sum_diffs(site_lh_diffs_3);
+  assert(site_lh_diffs_2.impossible || isinf(lh_diff_2) ||
+         fabs(lh_diff_2 - nodelh.getLhDiff2()) < 1e-3);
+  assert(site_lh_diffs_3.impossible || isinf(lh_diff_3) ||
+         fabs(lh_diff_3 - nodelh.getLhDiff3()) < 1e-3);
 #endif
+}
 
-    // init random generators
-    std::default_random_engine gen(static_cast<unsigned int>(params->ran_seed) + static_cast<unsigned int>(thread_id));
-    std::uniform_int_distribution<> rng_distrib(0, static_cast<int>(seq_length) - 1);
-#pragma omp for
-    for (PositionType i = 0; i < params->aLRT_SH_replicates; ++i) {
-      // reset all LTX*
-      RealNumType LT1_star{0}, LT2_star{0}, LT3_star{0};
-
-      // generate a vector of sampled sites
-      for (std::vector<cmaple::StateType>::size_type j = 0; j < seq_length; ++j)
-        selected_sites[j] = rng_distrib(gen);
-
-      // compute LT1*, LT2*, LT3*
-      // NOTES: LT2*, LT3* are now the lh differences between the actual LT2*,
-      // LT3* and LT1*
-      for (std::vector<cmaple::StateType>::size_type j = 0; j < seq_length; ++j) {
-        const std::vector<cmaple::StateType>::size_type site_index = static_cast<
-          std::vector<cmaple::StateType>::size_type>(selected_sites[j]);
-
-        LT1_star += site_lh_contributions[site_index];
-        LT1_star += site_lh_root[site_index];
-
-        LT2_star += site_lh_diff_2[site_index];
-        LT2_star += site_lh_root_diff_2[site_index];
-
-        LT3_star += site_lh_diff_3[site_index];
-        LT3_star += site_lh_root_diff_3[site_index];
-      }
-
-      // compute the actual LT2* and LT3*
-      LT2_star += LT1_star;
-      LT3_star += LT1_star;
-
-      // compute the centered sums CS1*, CS2*, CS3*
-      // where CSX* = LTX* - LTX
-      const RealNumType CS1 = LT1_star - LT1;
-      const RealNumType CS2 = LT2_star - LT2;
-      const RealNumType CS3 = LT3_star - LT3;
-
-      // find CS_first and CS_second which are the highest and the second
-      // highest among CSX* values
-      RealNumType CS_first, CS_second;
-      findTwoLargest(CS1, CS2, CS3, CS_first, CS_second);
-
-      // increase sh_count if the condition (aLRT > 2(CS_first - CS_second) +
-      // epsilon) is satisfied
-      // <=> half_aLRT > CS_first - CS_second + half_epsilon
-      if (nodelh.getHalf_aLRT() >
-          (CS_first - CS_second + params->aLRT_SH_half_epsilon))
-        ++sh_count;
-    }  // for aLRT_SH_replicates
-  }    // omp parallel
+void cmaple::Tree::drawRELLReplicate(const PositionType replicate,
+                                     std::vector<uint16_t>& site_weights) {
+  const size_t seq_length = aln->ref_seq.size();
+  std::seed_seq seeds{static_cast<unsigned int>(params->ran_seed),
+                      static_cast<unsigned int>(replicate)};
+  std::default_random_engine gen(seeds);
+  std::uniform_int_distribution<> rng_distrib(
+      0, static_cast<int>(seq_length) - 1);
 
-  return sh_count;
+  // resample the sites
+  site_weights.assign(seq_length, 0);
+  for (size_t j = 0; j < seq_length; ++j) {
+    ++site_weights[static_cast<size_t>(rng_distrib(gen))];
+  }
 }
 
 template <const StateType num_states>
@@ -8472,13 +10054,16 @@ void cmaple::Tree::calculate_aRLT_SH(
     std::vector<RealNumType>& site_lh_root,
     const RealNumType& LT1) {
   const RealNumType replicate_inverse = 100.0 / params->aLRT_SH_replicates;
+  const PositionType num_replicates = params->aLRT_SH_replicates;
+  const size_t seq_length = aln->ref_seq.size();
 
-  // traverse tree to calculate aLRT-SH for each internal branch
+  // traverse tree to collect the internal branches
   PhyloNode& root = nodes[root_vector_index];
 
   // aLRT-SH at root branch is zero
   node_lhs[root.getNodelhIndex()].set_aLRT_SH(0);
 
+  std::vector<NumSeqsType> branch_vecs;
   std::stack<Index> node_stack;
   if (root.isInternal()) {
     node_stack.push(root.getNeighborIndex(RIGHT));
@@ -8499,25 +10084,147 @@ void cmaple::Tree::calculate_aRLT_SH(
 
       // only compute the aLRT for internal non-zero branches
       if (node.getUpperLength() > 0) {
-        node_lhs[node.getNodelhIndex()].set_aLRT_SH(
-            replicate_inverse *
-            count_aRLT_SH_branch<num_states>(site_lh_contributions,
-                                             site_lh_root, node, LT1));
-
-        // print out the aLRT (for debugging only)
-        // std::cout << std::setprecision(3) << "aLRT-SH (node_vec: " <<
-        // node_vec << "): " << node_lhs[node.getNodelhIndex()].get_aLRT_SH() <<
-        // std::endl;
+        branch_vecs.push_back(node_vec);
       }
       // return zero for zero-length internal branches
       else {
         node_lhs[node.getNodelhIndex()].set_aLRT_SH(0);
-        // print out the aLRT (for debugging only)
-        // std::cout << std::setprecision(3) << "aLRT-SH (node_vec: " <<
-        // node_vec << "): 0 (*zero-length branch)" << std::endl;
       }
     }
   }
+
+  // the branches are processed in batches to bound the memory of their
+  // site-lh differences. The RELL replicates are redrawn (identically, each
+  // replicate has its own seeded generator) for each batch rather than kept:
+  // keeping them would take num_replicates * seq_length weights, while
+  // redrawing costs about as much as the O(seq_length) prefix sums of the
+  // weighted rates that each batch needs anyway. Most trees fit in one batch.
+  for (size_t batch_start = 0; batch_start < branch_vecs.size();
+       batch_start += ALRT_SH_BATCH_SIZE) {
+    const int batch_size = static_cast<int>(
+        std::min(ALRT_SH_BATCH_SIZE, branch_vecs.size() - batch_start));
+    const NumSeqsType* const batch_vecs = branch_vecs.data() + batch_start;
+
+    // 1. calculate the (sparse) site-lh differences between the NNI neighbors
+    // of each branch and the ML tree
+    std::vector<SiteLhDiffs> site_lh_diffs_2(static_cast<size_t>(batch_size));
+    std::vector<SiteLhDiffs> site_lh_diffs_3(static_cast<size_t>(batch_size));
+#pragma omp parallel
+    {
+      SiteLhDiffBuffers buffers;
+      buffers.site_lh_diff.resize(seq_length, 0);
+      buffers.site_lh_diff_old.resize(seq_length, 0);
+      buffers.site_lh_root_diff.resize(seq_length, 0);
+      buffers.rate_breakpoints.resize(seq_length + 1, 0);
+      buffers.rate_breakpoints_old.resize(seq_length + 1, 0);
+#pragma omp for schedule(dynamic)
+      for (int i = 0; i < batch_size; ++i) {
+        calSiteLhDiffsBranch<num_states>(buffers, nodes[batch_vecs[i]],
+                                         site_lh_diffs_2[i], site_lh_diffs_3[i]);
+      }
+    }
+
+    // 2. iterate the RELL replicates
+    std::vector<PositionType> sh_counts(static_cast<size_t>(batch_size), 0);
+#pragma omp parallel
+    {
+      std::vector<uint16_t> site_weights;
+      // the weighted rates of the sites before each position (the rate
+      // differences of a breakpoint at pos apply to the sites from pos
+      // onwards)
+      std::vector<RealNumType> weighted_rates(seq_length + 1, 0);
+      std::vector<PositionType> thread_sh_counts(
+          static_cast<size_t>(batch_size), 0);
+      const RealNumType* const total_weighted_rate =
+          weighted_rates.data() + seq_length;
+
+      // compute LTX* as the sum of LT1* and the lh differences between the
+      // NNI neighbor and the ML tree in the replicate
+      auto compute_LT_star = [&](const SiteLhDiffs& site_lh_diffs,
+                                 const RealNumType LT1_star) {
+        if (site_lh_diffs.impossible) {
+          return -std::numeric_limits<RealNumType>::infinity();
+        }
+
+        RealNumType LT_star = LT1_star;
+        for (const auto& site_diff : site_lh_diffs.site_diffs) {
+          // skip the sites not drawn (their differences may be infinite)
+          const uint16_t weight =
+              site_weights[static_cast<size_t>(site_diff.first)];
+          if (weight) {
+            LT_star += weight * site_diff.second;
+          }
+        }
+        for (const auto& rate_diff : site_lh_diffs.rate_diffs) {
+          LT_star += rate_diff.second *
+                     (*total_weighted_rate -
+                      weighted_rates[static_cast<size_t>(rate_diff.first)]);
+        }
+        return LT_star;
+      };
+
+#pragma omp for schedule(static)
+      for (PositionType r = 0; r < num_replicates; ++r) {
+        drawRELLReplicate(r, site_weights);
+
+        // compute LT1* and the weighted rates
+        RealNumType LT1_star{0};
+        for (size_t j = 0; j < seq_length; ++j) {
+          const uint16_t weight = site_weights[j];
+          if (weight) {
+            LT1_star +=
+                weight * (site_lh_contributions[j] + site_lh_root[j]);
+          }
+          weighted_rates[j + 1] =
+              weighted_rates[j] +
+              weight * (cumulative_rate[j + 1] - cumulative_rate[j]);
+        }
+
+        for (int i = 0; i < batch_size; ++i) {
+          const NodeLh& nodelh = node_lhs[nodes[batch_vecs[i]].getNodelhIndex()];
+          const RealNumType LT2 = LT1 + nodelh.getLhDiff2();
+          const RealNumType LT3 = LT1 + nodelh.getLhDiff3();
+
+          // compute the actual LT2* and LT3*
+          const RealNumType LT2_star =
+              compute_LT_star(site_lh_diffs_2[i], LT1_star);
+          const RealNumType LT3_star =
+              compute_LT_star(site_lh_diffs_3[i], LT1_star);
+
+          // compute the centered sums CS1*, CS2*, CS3*
+          // where CSX* = LTX* - LTX
+          const RealNumType CS1 = LT1_star - LT1;
+          const RealNumType CS2 = LT2_star - LT2;
+          const RealNumType CS3 = LT3_star - LT3;
+
+          // find CS_first and CS_second which are the highest and the second
+          // highest among CSX* values
+          RealNumType CS_first, CS_second;
+          findTwoLargest(CS1, CS2, CS3, CS_first, CS_second);
+
+          // increase sh_count if the condition (aLRT > 2(CS_first -
+          // CS_second) + epsilon) is satisfied
+          // <=> half_aLRT > CS_first - CS_second + half_epsilon
+          if (nodelh.getHalf_aLRT() >
+              (CS_first - CS_second + params->aLRT_SH_half_epsilon)) {
+            ++thread_sh_counts[static_cast<size_t>(i)];
+          }
+        }
+      }  // for aLRT_SH_replicates
+
+#pragma omp critical
+      for (int i = 0; i < batch_size; ++i) {
+        sh_counts[static_cast<size_t>(i)] +=
+            thread_sh_counts[static_cast<size_t>(i)];
+      }
+    }
+
+    // record the aLRT-SH of the branches
+    for (int i = 0; i < batch_size; ++i) {
+      node_lhs[nodes[batch_vecs[i]].getNodelhIndex()].set_aLRT_SH(
+          replicate_inverse * sh_counts[static_cast<size_t>(i)]);
+    }
+  }
 }
 
 template <const StateType num_states>
@@ -8717,9 +10424,6 @@ bool cmaple::Tree::calculateNNILhRoot(
 
       // return false to let us know that we found a new ML tree
       return false;
-    } else if (cmaple::verbose_mode >= cmaple::VB_MED) {
-      outWarning("Found an NNI neighbor tree with a higher likelihood (by " +
-                 convertDoubleToString(lh_diff) + ") than the current ML tree");
     }
   }
 
@@ -9078,9 +10782,6 @@ bool cmaple::Tree::calculateNNILhNonRoot(
 
       // return false to let us know that we found a new ML tree
       return false;
-    } else if (cmaple::verbose_mode >= cmaple::VB_MED) {
-      outWarning("Found an NNI neighbor tree with a higher likelihood (by " +
-                 convertDoubleToString(lh_diff) + ") than the current ML tree");
     }
   }
 
@@ -9157,6 +10858,7 @@ void cmaple::Tree::replaceMLTreebyNNIRoot(
           current_node_lower_lh, child_2_best_blength, *sibling_lower_lh,
           sibling_best_blength, aln, model, cumulative_rate, threshold_prob,
           true));
+  indexLowerLh(current_node_index.getVectorIndex());
   // because the lower_lh of the current node was updated
   // => we need to re-compute aLRT of that node
   current_node.setOutdated(true);
@@ -9216,6 +10918,7 @@ void cmaple::Tree::replaceMLTreebyNNIRoot(
           parent_new_lower, current_node.getUpperLength(), *child_1_lower_lh,
           child_1_best_blength, aln, model, cumulative_rate, threshold_prob,
           true));
+  indexLowerLh(parent_index.getVectorIndex());
   // update the absolute likelihood at root
   lh_at_root = parent_new_lower->computeAbsoluteLhAtRoot<num_states>(
       model, cumulative_base);
@@ -9302,6 +11005,7 @@ void cmaple::Tree::replaceMLTreebyNNINonRoot(
           true));
   // std::cout << "lh_contribution (after): " <<
   // node_lhs[current_node.getNodelhIndex()].getLhContribution() << std::endl;
+  indexLowerLh(current_node_index.getVectorIndex());
   // because the lower_lh of the current node was updated
   // => we need to re-compute aLRT of that node
   current_node.setOutdated(true);
@@ -9380,6 +11084,7 @@ void cmaple::Tree::replaceMLTreebyNNINonRoot(
             threshold_prob) {
       // update new_lower_lh
       node.setPartialLh(TOP, std::move(new_lower_lh));
+      indexLowerLh(node_vec);
       // std::cout << "lh_contribution (before): " <<
       // node_lhs[node.getNodelhIndex()].getLhContribution() << std::endl;
       node_lhs[node.getNodelhIndex()].setLhContribution(new_lh_contribution);
@@ -9655,6 +11360,7 @@ RealNumType cmaple::Tree::calculateSiteLhs(
           // likelihood may be due to a replacement of ML tree by an NNI
           // neighbor
           node.setPartialLh(TOP, std::move(new_lower_lh));
+          indexLowerLh(node_index.getVectorIndex());
         }
 
         last_node_index = Index(node_index.getVectorIndex(), TOP);
@@ -10683,21 +12389,38 @@ void cmaple::Tree::computeCumulativeRate() {
     cumulative_rate = new RealNumType[sequence_length + 1];
   }
 
-  // init cumulative_base and cumulative_rate
-  cumulative_base.resize(sequence_length + 1);
+  // compute cumulative_rate
   cumulative_rate[0] = 0;
-  cumulative_base[0].resize(model->num_states_, 0);
-
-  // compute cumulative_base and cumulative_rate
   const std::vector<cmaple::StateType>& ref_seq = aln->ref_seq;
   for (std::vector<cmaple::StateType>::size_type i = 0; i < sequence_length; ++i) {
-    StateType state = ref_seq[i];
-    cumulative_rate[i + 1] = cumulative_rate[i] + model->getDiagonalMutationMatrixEntry(state, i);
-    //std::cout << cumulative_rate[i + 1] << " ";
-    cumulative_base[i + 1] = cumulative_base[i];
-    cumulative_base[i + 1][state] = cumulative_base[i][state] + 1;
+    cumulative_rate[i + 1] = cumulative_rate[i] + model->getDiagonalMutationMatrixEntry(ref_seq[i], i);
+  }
+
+  // compute cumulative_base
+  cumulative_base.build(ref_seq, model->num_states_);
+
+  // the likelihoods of all nodes change with the model
+  if (!spr_cache.empty()) {
+    resetSPRCache(true);
+  }
+}
+
+void cmaple::Tree::updateCumulativeRate(const PositionType pos) {
+  assert(aln && model);
+  assert(cumulative_rate);
+  const PositionType sequence_length = static_cast<PositionType>(aln->ref_seq.size());
+
+  // only the cumulative rates from pos change (the cumulative bases are kept)
+  const std::vector<cmaple::StateType>& ref_seq = aln->ref_seq;
+  for (PositionType i = std::max(pos, 0); i < sequence_length; ++i) {
+    cumulative_rate[i + 1] = cumulative_rate[i] + model->getDiagonalMutationMatrixEntry(ref_seq[i], i);
+  }
+
+  // the likelihoods of all nodes change with the model (even if no diagonal
+  // entry changed)
+  if (!spr_cache.empty()) {
+    resetSPRCache(true);
   }
-  //std::cout << std::endl;
 }
 
 void cmaple::Tree::genIntNames()
@@ -10777,7 +12500,7 @@ string cmaple::Tree::exportTsvContent()
         // generate the list of nodes could be placed
         // (with probability above threshold) on the branch above the current node
         string support_to = "";
-        for (AltBranch& alt_branch : sprta_support_list[node_index])
+        for (const AltBranch& alt_branch : sprta_support_list[node_index])
         {
             // extract the node name
             const NumSeqsType support_node_id = alt_branch.branch_id.getVectorIndex();
@@ -10994,12 +12717,17 @@ NumSeqsType cmaple::Tree::seekBestRoot()
         root_vector_index = old_root_node.getNeighborIndex(TOP).getVectorIndex();
     }
     
+    // compute the scores of the root candidates concurrently
+    std::vector<RealNumType> candidate_scores;
+    std::vector<uint8_t> candidate_flags;
+    scoreRootCandidates<num_states>(candidate_scores, candidate_flags);
+    
     // init variables
     cmaple::NumSeqsType best_node_vec_index = root_vector_index;
     RealNumType best_lh_diff = 0;
     const RealNumType threshold_prob = params->threshold_prob;
     // stack of nodes to examine the root position
-    stack<std::unique_ptr<RootCandidate>> node_stack;
+    stack<TraversingNode> node_stack;
     PositionType candidate_count = 0;
     PositionType candidate_count_1K = 0;
     
@@ -11016,53 +12744,56 @@ NumSeqsType cmaple::Tree::seekBestRoot()
     int failure_limit_subtree = params->failure_limit_subtree;
     RealNumType thresh_log_lh_subtree = params->thresh_log_lh_subtree;
     
+    // add the children of a node as root candidates (in the same order as
+    // addChildrenAsRootCandidate())
+    auto addChildrenCandidates = [&](const PhyloNode& parent_node,
+                                     const RealNumType last_lh,
+                                     const short int failure_count)
+    {
+        for (const MiniIndex mini_index : {LEFT, RIGHT})
+        {
+            const Index child_index = parent_node.getNeighborIndex(mini_index);
+            if (candidate_flags[child_index.getVectorIndex()] & ROOT_CANDIDATE_SCORED)
+                node_stack.push(TraversingNode(child_index, failure_count, last_lh));
+        }
+    };
+    
     // add starting nodes to start the root assessment
-    addStartingRootCandidate<num_states>(root_vector_index, node_stack);
+    // (see addStartingRootCandidate())
+    for (const MiniIndex mini_index : {LEFT, RIGHT})
+    {
+        const PhyloNode& child = nodes[nodes[root_vector_index]
+                                       .getNeighborIndex(mini_index).getVectorIndex()];
+        if (child.isInternal())
+            addChildrenCandidates(child, 0, 0);
+    }
     
     // examine each node in the node stack to seek the "best" root
     while (!node_stack.empty())
     {
         // extract root candidate from stack
-        std::unique_ptr<RootCandidate> root_candidate = std::move(node_stack.top());
+        TraversingNode root_candidate = node_stack.top();
         node_stack.pop();
         
-        const Index candidate_index = root_candidate->getIndex();
+        const Index candidate_index = root_candidate.getIndex();
         const NumSeqsType candidate_vec_id = candidate_index.getVectorIndex();
-        PhyloNode& candidate_node = nodes[candidate_vec_id];
-        const RealNumType half_blength = candidate_node.getUpperLength() >= 0 ?
-            (candidate_node.getUpperLength() * 0.5) : -1;
-        
-        // compute the likelihood contribution when merging this node and the passing subtree
-        std::unique_ptr<SeqRegions> lower_regions_merged = nullptr;
-        const RealNumType lh_contribution_by_merging = candidate_node.getPartialLh(TOP)
-            ->mergeTwoLowers<num_states>(lower_regions_merged, half_blength,
-                *(root_candidate->getIncomingRegions()), half_blength, aln,
-                model, cumulative_rate, threshold_prob, true);
-        
-        // compute the likelihood contribution by merging the total lh with the state freqs
-        RealNumType lh_contribution_at_root = MIN_NEGATIVE;
-        if (lower_regions_merged)
-        {
-            lh_contribution_at_root = lower_regions_merged
-            ->computeAbsoluteLhAtRoot<num_states>(model, cumulative_base);
-        }
+        const PhyloNode& candidate_node = nodes[candidate_vec_id];
         
-        // compute the total score, taking into account the likelihood deduction and contribution
-        const RealNumType score = lh_contribution_by_merging + lh_contribution_at_root
-                                    - root_candidate->getLhDeducted();
+        // the total score, taking into account the likelihood deduction and contribution
+        const RealNumType score = candidate_scores[candidate_vec_id];
        
         // check wheter we find a better root by at least a certain amount (to avoid precision problem)
         if (score > best_lh_diff + threshold_prob)
         {
             best_lh_diff = score;
             best_node_vec_index = candidate_vec_id;
-            root_candidate->setFailureCount(0);
+            root_candidate.setFailureCount(0);
         }
         // otherwise, if the new score is worser than the last found by a certain amount
         // -> count it as a failure
-        else if (score < root_candidate->getLhDiff() - params->thresh_log_lh_failure)
+        else if (score < root_candidate.getLhDiff() - params->thresh_log_lh_failure)
         {
-            root_candidate->increaseFailureCount();
+            root_candidate.increaseFailureCount();
         }
         
         // if the new candidate is not too worse than the best found (by a certain threshold)
@@ -11075,14 +12806,16 @@ NumSeqsType cmaple::Tree::seekBestRoot()
         // keep crawling down into children nodes unless the stop criteria for the
         // traversal are satisfied. check the stop criteria keep traversing
         // further down to the children
-        if (keepTraversing(
+        if (candidate_node.isInternal() && keepTraversing(
                            best_lh_diff, score,
-                           strict_stop_seeking_placement_subtree, root_candidate->getFailureCount(),
+                           strict_stop_seeking_placement_subtree, root_candidate.getFailureCount(),
                            failure_limit_subtree, thresh_log_lh_subtree, true))
         {
-            addChildrenAsRootCandidate<num_states>(root_candidate->getIncomingRegions(),
-                            candidate_node.getUpperLength(), root_candidate->getLhDeducted(),
-                            score, root_candidate->getFailureCount(), candidate_node, node_stack);
+            // scoreRootCandidates() must have explored (at least) the same nodes
+            if (!(candidate_flags[candidate_vec_id] & ROOT_CANDIDATE_EXPANDED))
+                throw std::logic_error("The children of a root candidate have not been scored");
+            
+            addChildrenCandidates(candidate_node, score, root_candidate.getFailureCount());
         }
         
         // Show log every 1000 nodes
@@ -11110,6 +12843,132 @@ NumSeqsType cmaple::Tree::seekBestRoot()
     // return the best root found
     return best_node_vec_index;
 }
+
+template <const StateType num_states>
+void cmaple::Tree::scoreRootCandidates(std::vector<RealNumType>& candidate_scores,
+                                       std::vector<uint8_t>& candidate_flags)
+{
+    candidate_scores.assign(nodes.size(), 0);
+    candidate_flags.assign(nodes.size(), 0);
+    
+    // add starting nodes to start the root assessment
+    std::stack<std::unique_ptr<RootCandidate>> node_stack;
+    addStartingRootCandidate<num_states>(root_vector_index, node_stack);
+    std::vector<RootCandidateTask> tasks;
+    for (; !node_stack.empty(); node_stack.pop())
+        tasks.emplace_back(std::move(node_stack.top()), 0);
+    
+    // expand the candidates (breadth-first) until there are enough subtrees
+    // to explore concurrently
+    size_t min_num_tasks = 1;
+#ifdef _OPENMP
+    min_num_tasks = ROOT_CANDIDATES_PER_THREAD
+        * static_cast<size_t>(omp_get_max_threads());
+#endif
+    size_t num_expanded_tasks = 0;
+    while (num_expanded_tasks < tasks.size()
+           && tasks.size() - num_expanded_tasks < min_num_tasks)
+    {
+        std::vector<RootCandidateTask> new_tasks;
+        scoreRootCandidate<num_states>(tasks[num_expanded_tasks++],
+            candidate_scores.data(), candidate_flags.data(), new_tasks);
+        for (RootCandidateTask& new_task : new_tasks)
+            tasks.push_back(std::move(new_task));
+    }
+    
+    // explore the remaining subtrees (depth-first) concurrently
+    const int num_tasks = static_cast<int>(tasks.size());
+#pragma omp parallel
+    {
+        std::vector<RootCandidateTask> task_stack;
+        std::vector<RootCandidateTask> new_tasks;
+#pragma omp for schedule(dynamic)
+        for (int i = static_cast<int>(num_expanded_tasks); i < num_tasks; ++i)
+        {
+            task_stack.push_back(std::move(tasks[static_cast<size_t>(i)]));
+            while (!task_stack.empty())
+            {
+                RootCandidateTask task = std::move(task_stack.back());
+                task_stack.pop_back();
+                
+                new_tasks.clear();
+                scoreRootCandidate<num_states>(task, candidate_scores.data(),
+                    candidate_flags.data(), new_tasks);
+                for (RootCandidateTask& new_task : new_tasks)
+                    task_stack.push_back(std::move(new_task));
+            }
+        }
+    }
+}
+
+template <const StateType num_states>
+void cmaple::Tree::scoreRootCandidate(RootCandidateTask& candidate_task,
+                                      RealNumType* const candidate_scores,
+                                      uint8_t* const candidate_flags,
+                                      std::vector<RootCandidateTask>& new_tasks)
+{
+    RootCandidate& root_candidate = *candidate_task.first;
+    const Index candidate_index = root_candidate.getIndex();
+    const NumSeqsType candidate_vec_id = candidate_index.getVectorIndex();
+    PhyloNode& candidate_node = nodes[candidate_vec_id];
+    const RealNumType half_blength = candidate_node.getUpperLength() >= 0 ?
+        (candidate_node.getUpperLength() * 0.5) : -1;
+    const RealNumType threshold_prob = params->threshold_prob;
+    
+    // compute the likelihood contribution when merging this node and the passing subtree
+    std::unique_ptr<SeqRegions> lower_regions_merged = nullptr;
+    const RealNumType lh_contribution_by_merging = candidate_node.getPartialLh(TOP)
+        ->mergeTwoLowers<num_states>(lower_regions_merged, half_blength,
+            *(root_candidate.getIncomingRegions()), half_blength, aln,
+            model, cumulative_rate, threshold_prob, true);
+    
+    // compute the likelihood contribution by merging the total lh with the state freqs
+    RealNumType lh_contribution_at_root = MIN_NEGATIVE;
+    if (lower_regions_merged)
+    {
+        lh_contribution_at_root = lower_regions_merged
+        ->computeAbsoluteLhAtRoot<num_states>(model, cumulative_base);
+    }
+    
+    // compute the total score, taking into account the likelihood deduction and contribution
+    const RealNumType score = lh_contribution_by_merging + lh_contribution_at_root
+                                - root_candidate.getLhDeducted();
+    candidate_scores[candidate_vec_id] = score;
+    candidate_flags[candidate_vec_id] |= ROOT_CANDIDATE_SCORED;
+    
+    // update the lower bound of the best score (seekBestRoot() only accepts a
+    // better score if it's higher by threshold_prob; twice the threshold
+    // leaves room for rounding errors). The failure count is thus never higher
+    // than that in seekBestRoot()
+    RealNumType& best_lh_diff_bound = candidate_task.second;
+    if (score > best_lh_diff_bound + threshold_prob)
+    {
+        root_candidate.setFailureCount(0);
+    }
+    else if (score < root_candidate.getLhDiff() - params->thresh_log_lh_failure)
+    {
+        root_candidate.increaseFailureCount();
+    }
+    best_lh_diff_bound = std::max(best_lh_diff_bound, score - 2 * threshold_prob);
+    
+    // keep crawling down into children nodes unless the stop criteria for the
+    // traversal are satisfied
+    if (candidate_node.isInternal() && keepTraversing(
+            best_lh_diff_bound, score,
+            params->strict_stop_seeking_placement_subtree,
+            root_candidate.getFailureCount(), params->failure_limit_subtree,
+            params->thresh_log_lh_subtree, true))
+    {
+        std::stack<std::unique_ptr<RootCandidate>> node_stack;
+        addChildrenAsRootCandidate<num_states>(root_candidate.getIncomingRegions(),
+            candidate_node.getUpperLength(), root_candidate.getLhDeducted(),
+            score, root_candidate.getFailureCount(), candidate_node, node_stack);
+        candidate_flags[candidate_vec_id] |= ROOT_CANDIDATE_EXPANDED;
+        
+        for (; !node_stack.empty(); node_stack.pop())
+            new_tasks.emplace_back(std::move(node_stack.top()), best_lh_diff_bound);
+    }
+}
  
 template <const StateType num_states>
 void cmaple::Tree::addStartingRootCandidate(
@@ -11370,3 +13229,14 @@ void Tree::expandVectorsAfterTreeExpansion()
     sprta_alt_branches.resize(num_nodes);
     sprta_support_list.resize(num_nodes);
 }
+
+// the placement cost on both layouts of the regions (for
+// benchmark/seqregions_layout.cpp)
+template RealNumType cmaple::Tree::calculateSubTreePlacementCostRegions<4>(
+    const SeqRegions&, const SeqRegions&, const RealNumType);
+template RealNumType cmaple::Tree::calculateSubTreePlacementCostRegions<20>(
+    const SeqRegions&, const SeqRegions&, const RealNumType);
+template RealNumType cmaple::Tree::calculateSubTreePlacementCostRegions<4>(
+    const SeqRegionsSoA&, const SeqRegionsSoA&, const RealNumType);
+template RealNumType cmaple::Tree::calculateSubTreePlacementCostRegions<20>(
+    const SeqRegionsSoA&, const SeqRegionsSoA&, const RealNumType);
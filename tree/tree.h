@@ -3,6 +3,7 @@
 #include "updatingnode.h"
 #include "rootcandidate.h"
 #include "altbranch.h"
+#include "mutationindex.h"
 #ifdef _OPENMP
 #include <omp.h>
 #endif
@@ -139,6 +140,60 @@ class Tree {
   void load(const std::string& tree_filename,
             const bool fixed_blengths = false);
 
+  /*! \brief Write a checkpoint of the current tree, i.e., a binary snapshot of
+   * the tree (including all likelihood vectors along the tree and the results
+   * of SPRTA/branch supports, if computed) and the substitution model.
+   * The snapshot is written in the native byte order, and thus can only be
+   * restored on machines of the same architecture.
+   * @param[out] checkpoint_stream A (binary) output stream
+   * @param[in] lh The log likelihood of the tree, if already known, which is
+   * recorded for information only (it is not computed otherwise, as that
+   * would traverse the whole tree at each save)
+   * @throw std::logic\_error if the tree is empty
+   */
+  void saveCheckpoint(std::ostream& checkpoint_stream,
+                      const cmaple::RealNumType lh =
+                          std::numeric_limits<cmaple::RealNumType>::quiet_NaN());
+
+  /*! \brief Write a checkpoint of the current tree (see
+   * saveCheckpoint(std::ostream&)) to a file. The checkpoint is first written
+   * to a temporary file, which then replaces the file, so that an existing
+   * checkpoint remains intact if the program is interrupted.
+   * @param[in] checkpoint_filename Name of the checkpoint file
+   * @param[in] lh see saveCheckpoint(std::ostream&, RealNumType)
+   * @throw std::invalid\_argument if checkpoint\_filename is empty
+   * @throw std::logic\_error if the tree is empty
+   * @throw ios::failure if the checkpoint file cannot be written
+   */
+  void saveCheckpoint(const std::string& checkpoint_filename,
+                      const cmaple::RealNumType lh =
+                          std::numeric_limits<cmaple::RealNumType>::quiet_NaN());
+
+  /*! \brief Restore the tree and the substitution model from a checkpoint
+   * written by saveCheckpoint(). The checkpoint is read at once; no
+   * likelihood is recomputed.
+   * @param[in] checkpoint_stream A (binary) input stream
+   * @throw std::invalid\_argument if any of the following situations occur.
+   * - the stream is not a checkpoint (of this version)
+   * - the checkpoint was created from a different alignment or model
+   *
+   * @throw std::logic\_error if the checkpoint is truncated
+   */
+  void loadCheckpoint(std::istream& checkpoint_stream);
+
+  /*! \brief Restore the tree and the substitution model from a checkpoint
+   * file (see loadCheckpoint(std::istream&))
+   * @param[in] checkpoint_filename Name of the checkpoint file
+   * @throw std::invalid\_argument if any of the following situations occur.
+   * - checkpoint\_filename is empty
+   * - the file is not a checkpoint (of this version)
+   * - the checkpoint was created from a different alignment or model
+   *
+   * @throw ios::failure if the checkpoint file is not found
+   * @throw std::logic\_error if the checkpoint is truncated
+   */
+  void loadCheckpoint(const std::string& checkpoint_filename);
+
   /*! \brief Change the alignment
    * @param[in] aln An alignment
    * @throw std::invalid\_argument If the alignment is empty
@@ -274,6 +329,39 @@ class Tree {
                                    const bool allow_replacing_ML_tree = true,
                                    std::ostream& out_stream = std::cout);
 
+  /*! \brief Place new samples, read one by one from a stream, on the current
+   * tree without changing the tree (i.e., the tree is kept frozen and the new
+   * samples are not added to the tree). Samples are read in MAPLE format
+   * (without the reference sequence); each sample is placed (and its
+   * placement is written to placement_stream) as soon as an empty line or the
+   * next sample is read, thus the stream could be a pipe that remains open.
+   * Each output line contains the sample name, the node where the sample is
+   * placed (a leaf name or an internal id, as in the tree exported with
+   * print\_internal\_id = TRUE), the placement type ("branch": on the branch
+   * above that node; "root": as a sibling of the root, i.e., that node;
+   * "node": at that node; "identical"/"less-informative": the sample is
+   * identical to/less informative than that leaf, with a log-likelihood
+   * difference of 0), the log-likelihood difference of the placement, and the alternative placements (if
+   * requested), i.e., the other best positions examined by the search, each
+   * as node:type:lhDiff. The placement is the one that would be made if the
+   * sample were added into the tree.
+   * @param[in] seq_stream A stream of new samples in MAPLE format
+   * @param[out] placement_stream The output stream of placements
+   * @param[in] num_alt_placements The maximum number of alternative
+   * placements to output for each sample (optional)
+   * @param[in] refresh_lhs TRUE to re-compute all likelihoods of the tree
+   * first (optional). It could be skipped if they are up to date, e.g., right
+   * after restoring the tree from a checkpoint
+   * @throw std::logic\_error if any of the following situations occur.
+   * - the tree is empty
+   * - the samples are in an incorrect format
+   * - unexpected values/behaviors found during the operations
+   */
+  void placeStreamedSamples(std::istream& seq_stream,
+                            std::ostream& placement_stream,
+                            const int num_alt_placements = 0,
+                            const bool refresh_lhs = true);
+
   /*! \brief Export the phylogenetic tree  to a string in NEWICK format.
    * @param[in] tree_type The type of the output tree (optional): BIN_TREE
    * (bifurcating tree), MUL_TREE (multifurcating tree)
@@ -299,6 +387,13 @@ class Tree {
   */
   void computeCumulativeRate();
 
+  /**
+  Update the cumulative rate of the ref genome from a position, e.g., after
+  the model changed the rates of some sites from that position
+  @param[in] pos The first site whose rate changed
+  */
+  void updateCumulativeRate(const cmaple::PositionType pos);
+
   // ----------------- END OF PUBLIC APIs ------------------------------------
   // //
 
@@ -337,9 +432,10 @@ class Tree {
   cmaple::RealNumType* cumulative_rate = nullptr;
 
   /**
-   cumulative bases
+   cumulative bases (the counts of the bases of the ref genome before each
+   position)
    */
-  std::vector<std::vector<cmaple::PositionType>> cumulative_base;
+  CumulativeBase cumulative_base;
 
   /**
    Vector of phylonodes
@@ -374,13 +470,13 @@ class Tree {
     /**
      Vector of alternative branches (when computing SPRTA)
      */
-    std::vector<std::vector<cmaple::AltBranch>> sprta_alt_branches;
+    cmaple::AltBranches sprta_alt_branches;
     
     /**
      The inverse of sprta_alt_branches
      highlight which nodes could be placed (with probability above threshold) on the branch above the current node
      */
-    std::vector<std::vector<cmaple::AltBranch>> sprta_support_list;
+    cmaple::AltBranches sprta_support_list;
     
     /**
      Vector of number of descendants of nodes
@@ -409,6 +505,48 @@ class Tree {
    not
    */
   std::vector<bool> sequence_added;
+
+  /**
+   Inverted index from mutations to the nodes whose lower regions carry them
+   (only used if params->use_mutation_index)
+   */
+  MutationIndex mutation_index;
+
+  /**
+   The (decayed) improvements recently obtained by SPR moves at/below each
+   node (indexed by the vector index of the node), used to prioritize nodes
+   in improveEntireTreeByPriority()
+   */
+  std::vector<cmaple::RealNumType> spr_gains;
+
+  /**
+   The round (of improveEntireTreeByPriority()) since which each node has been
+   outdated (or NOT_OUTDATED)
+   */
+  std::vector<uint32_t> spr_outdated_rounds;
+
+  /**
+   The number of rounds of improveEntireTreeByPriority() performed so far
+   */
+  uint32_t spr_round = 0;
+
+  /**
+   The (wall-clock) time when the current tree search started, and when the
+   current tree was last saved (see checkSearchBudget())
+   */
+  double search_start_time = 0;
+  double last_checkpoint_time = 0;
+
+  /**
+   The number of nodes whose SPR moves have been evaluated in the current tree
+   search
+   */
+  int64_t num_spr_evaluations = 0;
+
+  /**
+   TRUE if the current tree search was stopped by its budget
+   */
+  bool search_stopped = false;
     
   /**
    TRUE if branch support (i.e. aLRT-SH) computed
@@ -469,6 +607,28 @@ class Tree {
   /*! \endcond */
 
  private:
+  /**
+   Narrow access to the placement cost of subtrees (see
+   placementcostaccess.h)
+   */
+  friend class PlacementCostAccess;
+
+  /**
+   Magic number (i.e., "CMAPLECK") identifying a checkpoint file
+   */
+  static constexpr uint64_t CHECKPOINT_MAGIC = 0x4B43454C50414D43ULL;
+
+  /**
+   Version of the checkpoint format, to be increased whenever the format
+   changes
+   */
+  static constexpr uint32_t CHECKPOINT_VERSION = 4;
+
+  /**
+   Value of spr_outdated_rounds for nodes that are not outdated
+   */
+  static constexpr uint32_t NOT_OUTDATED = UINT32_MAX;
+
     /**
      * Get mutation string for MATs
      */
@@ -554,6 +714,15 @@ class Tree {
                                                            const bool, std::ostream&);
   computeBranchSupportPtrType computeBranchSupportPtr;
 
+  /**
+      Pointer  to placeStreamedSamples method
+   */
+  typedef void (Tree::*PlaceStreamedSamplesPtrType)(std::istream&,
+                                                    std::ostream&,
+                                                    const int,
+                                                    const bool);
+  PlaceStreamedSamplesPtrType placeStreamedSamplesPtr;
+
   typedef void (Tree::*MakeTreeInOutConsistentPtrType)();
   MakeTreeInOutConsistentPtrType makeTreeInOutConsistentPtr;
 
@@ -586,6 +755,133 @@ class Tree {
   template <const cmaple::StateType num_states>
   void doPlacementTemplate(std::ostream& out_stream);
 
+  /**
+   The placement found for a sample
+   */
+  struct SamplePlacement {
+    cmaple::Index selected_node_index;
+    cmaple::RealNumType best_lh_diff = MIN_NEGATIVE;
+    bool is_mid_branch = false;
+    cmaple::RealNumType best_up_lh_diff = MIN_NEGATIVE;
+    cmaple::RealNumType best_down_lh_diff = MIN_NEGATIVE;
+    cmaple::Index best_child_index;
+  };
+
+  /**
+   Seek a position for a sample placement from the root. If mutation_index is
+   in use (see params->use_mutation_index), the
+   search (with the same order and stopping rules) is restricted to the
+   regions around the paths from the root to the nodes that best match the
+   sample (see search_paths of seekSamplePlacement()), which skips most of the
+   tree. It then finds the same placement as the unrestricted search unless
+   the latter lies (or ties with a placement visited earlier) out of those
+   regions. Samples that match the tree poorly (whose best placement cost is
+   below min_seeded_lh_diff) are placed by the unrestricted search, as their
+   best placements are often far from the seeds. This is a heuristic: the
+   placements are the same as those of the unrestricted search on the
+   benchmark datasets but this is not guaranteed in general.
+   @param read_only see seekSamplePlacement()
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  void seekSamplePlacementFromSeeds(
+      const cmaple::NumSeqsType seq_name_index,
+      const std::unique_ptr<SeqRegions>& sample_regions,
+      SamplePlacement& placement,
+      const bool read_only = false);
+
+  /**
+   Add a placement examined by seekSamplePlacement() into a vector (if its
+   cost was computed)
+   */
+  void recordExaminedPlacement(
+      std::vector<SamplePlacement>* examined_placements,
+      const cmaple::NumSeqsType node_vec_index,
+      const bool is_mid_branch,
+      const cmaple::RealNumType lh_diff) {
+    if (lh_diff > MIN_NEGATIVE) {
+      examined_placements->emplace_back();
+      SamplePlacement& placement = examined_placements->back();
+      placement.selected_node_index = cmaple::Index(node_vec_index, TOP);
+      placement.best_lh_diff = lh_diff;
+      placement.is_mid_branch = is_mid_branch;
+    }
+  }
+
+  /**
+   Find (without changing the tree) where placeNewSampleAtNode() would add a
+   sample placed at a node, i.e., on the branch above the best child of that
+   node, on the branch above that node, or at that node (forming a polytomy).
+   Mid-branch placements are kept unchanged
+   @param placement the placement found by seekSamplePlacement(), updated to
+   the final placement (with is_mid_branch = TRUE if the sample is added on a
+   branch)
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  void finetuneSamplePlacementReadOnly(
+      SamplePlacement& placement,
+      const std::unique_ptr<SeqRegions>& sample_regions);
+
+  /**
+   Index the mutations of all nodes of the current tree into mutation_index
+   and keep it up to date afterwards (see indexLowerLh())
+   */
+  void indexAllNodes();
+
+  /**
+   Re-index the mutations of the lower regions of a node (if mutation_index is
+   in use). It must be called whenever the lower regions of a node change
+   */
+  void indexLowerLh(const cmaple::NumSeqsType vec_index) {
+    if (mutation_index.isActive()) {
+      mutation_index.updateNode(nodes[vec_index].getPartialLh(TOP).get(),
+                                vec_index, aln->num_states);
+    }
+  }
+
+  /**
+   Get the name of a node, i.e., the sequence name of a leaf or the internal
+   id (see genIntNames()) of an internal node
+   */
+  std::string getNodeName(const cmaple::NumSeqsType node_vec_index);
+
+  /**
+   Place the remaining samples (starting from the seq_index-th sequence) in
+   batches of params->placement_batch_size samples: placements of all samples
+   in a batch are sought concurrently against the same tree, then added to the
+   tree one by one (in the input order). A sample is re-sought against the
+   updated tree if its selected branch was changed by an earlier sample in the
+   same batch.
+   @param seq_index the index of the first sequence to be placed
+   @param num_new_sequences the number of new sequences, which is decreased
+   for each sequence that was already presented in the input tree
+   @param from_input_tree TRUE if we started from an input tree
+   @param group_identical_seqs TRUE to defer sequences identical to a previous
+   sequence (by adding them into identical_seqs) instead of placing them
+   @param identical_seqs the deferred identical sequences
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  void placeSamplesInBatches(
+      std::vector<cmaple::Sequence>::size_type seq_index,
+      std::vector<cmaple::Sequence>::size_type& num_new_sequences,
+      const bool from_input_tree,
+      const bool group_identical_seqs,
+      std::vector<cmaple::NumSeqsType>& identical_seqs);
+
+  /**
+   Add sequences (that were not placed) into the lists of less-informative
+   sequences of the leaves of their representatives (i.e., the first identical
+   sequences in the alignment)
+   @throw std::logic\_error if the representative of any sequence is not found
+   in the tree
+   */
+  void attachIdenticalSeqs(const std::vector<cmaple::NumSeqsType>& identical_seqs);
+
   /*! Template of doRateEstimation()
    */
   template <const cmaple::StateType num_states>
@@ -617,6 +913,14 @@ class Tree {
                                            const bool allow_replacing_ML_tree,
                                            std::ostream& out_stream);
 
+  /*! Template of placeStreamedSamples()
+   */
+  template <const cmaple::StateType num_states>
+  void placeStreamedSamplesTemplate(std::istream& seq_stream,
+                                    std::ostream& placement_stream,
+                                    const int num_alt_placements,
+                                    const bool refresh_lhs);
+
   /*! Template of makeTreeInOutConsistent()
    */
   template <const cmaple::StateType num_states>
@@ -682,6 +986,135 @@ class Tree {
                                      const TreeSearchType tree_search_type,
                                      bool short_range_search);
 
+  /**
+   The SPR move (and/or the new branch length) found for a subtree
+   */
+  struct SubTreeSPR {
+    // the parent of the subtree when the move was sought
+    cmaple::Index parent_index;
+    // the placement cost (and the branch length) at the current position
+    cmaple::RealNumType best_lh = 0;
+    cmaple::RealNumType best_blength = 0;
+    bool blength_changed = false;
+    // TRUE if a new placement was sought
+    bool placement_sought = false;
+    cmaple::Index best_node_index;
+    // the parent of best_node_index when the move was sought
+    cmaple::Index best_node_parent_index;
+    cmaple::RealNumType best_lh_diff = MIN_NEGATIVE;
+    bool is_mid_node = false;
+    cmaple::Index best_child_index;
+    cmaple::RealNumType opt_appending_blength = -1;
+    cmaple::RealNumType opt_mid_top_blength = -1;
+    cmaple::RealNumType opt_mid_bottom_blength = -1;
+  };
+
+  /**
+   The subtree placement last sought for a node by seekSubTreeSPR()
+   */
+  struct CachedSubTreeSPR {
+    // the value of lh_clock when the placement was sought (0 if none)
+    uint64_t stamp = 0;
+    bool short_range_search = false;
+    // the placement cost at the current position when the placement was sought
+    cmaple::RealNumType start_lh = 0;
+    SubTreeSPR spr_move;
+    // the vector indexes of the nodes explored when seeking the placement
+    // (empty if there were more than MAX_CACHED_EXPLORED_NODES nodes, then the
+    // placement is only reused if no node has changed)
+    std::vector<cmaple::NumSeqsType> explored_nodes;
+  };
+
+  /**
+   The maximum number of explored nodes stored for a cached placement (to
+   bound the memory of spr_cache)
+   */
+  static constexpr size_t MAX_CACHED_EXPLORED_NODES = 128;
+
+  /**
+   The number of nodes whose SPRTA scores are computed concurrently (if
+   params->spr_batch_size is not specified) when the topology is kept
+   unchanged
+   */
+  static constexpr cmaple::PositionType SPRTA_BATCH_SIZE = 256;
+
+  /**
+   The subtree placements last sought for the nodes (indexed by their vector
+   indexes), reused while the likelihoods of the explored nodes are unchanged.
+   Only allocated during the tree search with params->spr_cache
+   */
+  std::vector<CachedSubTreeSPR> spr_cache;
+
+  /**
+   The value of lh_clock when the likelihoods at each node (indexed by its
+   vector index) last changed (only maintained if spr_cache is allocated)
+   */
+  std::vector<uint64_t> lh_stamps;
+
+  /**
+   A logical clock, increased whenever the likelihoods at a node change
+   */
+  uint64_t lh_clock = 0;
+
+  /**
+   Reset spr_cache (e.g., when the model changes)
+   @param allocate TRUE to allocate an (empty) entry for every node
+   */
+  void resetSPRCache(const bool allocate);
+
+  /**
+   Get the placement cached for the subtree rooted at a node if none of the
+   nodes explored to find it has changed since then
+   @param vec_index the vector index of the node
+   @param spr_move the move sought for the node, whose placement is filled
+   in from the cache. spr_move.best_lh must be already computed
+   @return TRUE if the cached placement was used
+   */
+  bool getCachedSubTreeSPR(const cmaple::NumSeqsType vec_index,
+                           const bool short_range_search,
+                           SubTreeSPR& spr_move) const;
+
+  /**
+   Seek an SPR move (and/or a better branch length) for a subtree rooted at
+   node without changing the tree
+   @param explored_nodes if not null, output the vector indexes of the nodes
+   explored when seeking a new placement
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  void seekSubTreeSPR(
+      const cmaple::Index index,
+      PhyloNode& node,
+      const TreeSearchType tree_search_type,
+      const bool short_range_search,
+      SubTreeSPR& spr_move,
+      std::vector<cmaple::NumSeqsType>* explored_nodes = nullptr);
+
+  /**
+   Apply an SPR move (and/or a new branch length) found by seekSubTreeSPR()
+   @return the improvement
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  cmaple::RealNumType applySubTreeSPR(const cmaple::Index index,
+                                      PhyloNode& node,
+                                      const TreeSearchType tree_search_type,
+                                      const bool short_range_search,
+                                      const SubTreeSPR& spr_move);
+
+  /**
+   Check if an SPR move found by seekSubTreeSPR() is still valid, i.e., the
+   subtree, its parent, and the target branch were not changed (marked as
+   outdated) by the moves applied after it was sought
+   */
+  bool isSubTreeSPRValid(const cmaple::Index index,
+                         const PhyloNode& node,
+                         const TreeSearchType tree_search_type,
+                         const bool short_range_search,
+                         const SubTreeSPR& spr_move);
+
   /**
    Calculate derivative starting from coefficients.
    @return derivative
@@ -1522,6 +1955,28 @@ bool isDiffFromOrigPlacement(
   template <const cmaple::StateType num_states>
   void calculate_aRLT(const bool allow_replacing_ML_tree);
 
+  /**
+   Calculate aLRT for all internal branches concurrently, without changing the
+   tree
+   @param[in] allow_replacing_ML_tree TRUE to allow replacing the ML tree by a
+   higher likelihood tree found when computing branch supports
+   @param[in] lh_at_root the likelihood at root of the current tree
+   @return FALSE (without recording any aLRT) if the ML tree should be
+   replaced by a better NNI neighbor, i.e., the aLRT must be calculated
+   serially
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  bool calculate_aRLTConcurrently(const bool allow_replacing_ML_tree,
+                                  cmaple::RealNumType lh_at_root);
+
+  /**
+   Show a warning if an NNI neighbor of the ML tree has a higher likelihood
+   (i.e., lh_diff > 0) than the ML tree itself
+   */
+  void warnBetterNNINeighbor(const cmaple::RealNumType lh_diff);
+
   /**
    Perform a DFS to calculate the Site-lh-contribution
    @throw std::logic\_error if unexpected values/behaviors found during the
@@ -1544,27 +1999,74 @@ bool isDiffFromOrigPlacement(
       const cmaple::RealNumType& LT1);
 
   /**
-   Count aLRT-SH for an internal branch
+   The site-lh differences between an NNI neighbor and the ML tree in a sparse
+   form, i.e., only the sites whose likelihood contributions differ
+   */
+  struct SiteLhDiffs {
+    // TRUE if the NNI neighbor is impossible (its likelihood is -inf)
+    bool impossible = false;
+    // the sites and their (non-zero) lh differences
+    std::vector<std::pair<cmaple::PositionType, cmaple::RealNumType>>
+        site_diffs;
+    // the lh differences proportional to the site rates (from R regions),
+    // recorded as breakpoints (pos, coefficient): the difference at each site
+    // from pos onwards changes by coefficient * the site rate
+    std::vector<std::pair<cmaple::PositionType, cmaple::RealNumType>>
+        rate_diffs;
+  };
+
+  /**
+   The dense buffers used when calculating the site-lh differences, they are
+   reused (and kept zeroed) across branches to avoid per-branch allocations;
+   only the positions recorded in updated_positions are read and reset
+   */
+  struct SiteLhDiffBuffers {
+    std::vector<cmaple::RealNumType> site_lh_diff;
+    std::vector<cmaple::RealNumType> site_lh_diff_old;
+    std::vector<cmaple::RealNumType> site_lh_root_diff;
+    // see the rate_breakpoints of SeqRegions::calculateSiteLhContributions()
+    std::vector<cmaple::RealNumType> rate_breakpoints;
+    std::vector<cmaple::RealNumType> rate_breakpoints_old;
+    // the positions written into the above buffers (possibly with duplicates)
+    std::vector<cmaple::PositionType> updated_positions;
+  };
+
+  /**
+   The maximum number of branches whose site-lh differences are kept in memory
+   at once when computing aLRT-SH
+   */
+  static constexpr size_t ALRT_SH_BATCH_SIZE = 1 << 14;
+
+  /**
+   Draw a RELL replicate when computing aLRT-SH by resampling seq_length sites
+   (with replacement) from the alignment. Each replicate has its own random
+   generator, thus, the replicates don't depend on the number of threads
+   @param[out] site_weights the number of times each site is drawn
+   */
+  void drawRELLReplicate(const cmaple::PositionType replicate,
+                         std::vector<uint16_t>& site_weights);
+
+  /**
+   Calculate the site-lh differences between the two NNI neighbors of an
+   internal branch and the ML tree (for aLRT-SH)
    @throw std::logic\_error if unexpected values/behaviors found during the
    operations
    */
   template <const cmaple::StateType num_states>
-  cmaple::PositionType count_aRLT_SH_branch(
-      std::vector<cmaple::RealNumType>& site_lh_contributions,
-      std::vector<cmaple::RealNumType>& site_lh_root,
-      PhyloNode& node,
-      const cmaple::RealNumType& LT1);
+  void calSiteLhDiffsBranch(SiteLhDiffBuffers& buffers,
+                            PhyloNode& node,
+                            SiteLhDiffs& site_lh_diffs_2,
+                            SiteLhDiffs& site_lh_diffs_3);
 
   /**
    Calculate the site-lh differences  between an NNI neighbor on the branch
    connecting to root and the ML tree
+   @return FALSE if the NNI neighbor is impossible
    @throw std::logic\_error if unexpected values/behaviors found during the
    operations
    */
   template <const cmaple::StateType num_states>
-  void calSiteLhDiffRoot(std::vector<cmaple::RealNumType>& site_lh_diff,
-                         std::vector<cmaple::RealNumType>& site_lh_root_diff,
-                         const std::vector<cmaple::RealNumType>& site_lh_root,
+  bool calSiteLhDiffRoot(SiteLhDiffBuffers& buffers,
                          std::unique_ptr<SeqRegions>& parent_new_lower_lh,
                          const cmaple::RealNumType& child_2_new_blength,
                          PhyloNode& current_node,
@@ -1577,14 +2079,13 @@ bool isDiffFromOrigPlacement(
   /**
    Calculate the site-lh differences  between an NNI neighbor on the branch
    connecting to a non-root node and the ML tree
+   @return FALSE if the NNI neighbor is impossible
    @throw std::logic\_error if unexpected values/behaviors found during the
    operations
    */
   template <const cmaple::StateType num_states>
-  void calSiteLhDiffNonRoot(
-      std::vector<cmaple::RealNumType>& site_lh_diff,
-      std::vector<cmaple::RealNumType>& site_lh_root_diff,
-      const std::vector<cmaple::RealNumType>& site_lh_root,
+  bool calSiteLhDiffNonRoot(
+      SiteLhDiffBuffers& buffers,
       std::unique_ptr<SeqRegions>& parent_new_lower_lh,
       const cmaple::RealNumType& child_2_new_blength,
       PhyloNode& current_node,
@@ -1596,14 +2097,14 @@ bool isDiffFromOrigPlacement(
 
   /**
    Calculate the site-lh differences  between an NNI neighbor and the ML tree
+   in the sparse form; the buffers are zeroed again afterwards
    @throw std::logic\_error if unexpected values/behaviors found during the
    operations
    */
   template <const cmaple::StateType num_states>
-  void calSiteLhDiff(std::vector<cmaple::RealNumType>& site_lh_diff,
-                     std::vector<cmaple::RealNumType>& site_lh_root_diff,
-                     const std::vector<cmaple::RealNumType>& site_lh_root,
-                     PhyloNode& current_node,
+  void calSiteLhDiff(SiteLhDiffs& site_lh_diffs,
+                     SiteLhDiffBuffers& buffers,
+                                    PhyloNode& current_node,
                      PhyloNode& child_1,
                      PhyloNode& child_2,
                      PhyloNode& sibling,
@@ -1852,6 +2353,24 @@ bool isDiffFromOrigPlacement(
   /**
    Seek a position for a sample placement starting at the start_node
 
+   @param read_only TRUE to leave the tree untouched (e.g., when seeking
+   placements for multiple samples concurrently). If the sample is less
+   informative than an existing leaf, selected_node_index then keeps the vector
+   index of that leaf (with an UNDEFINED mini-index) so that the caller can add
+   the sample into the list of less-informative sequences of that leaf later.
+   @param start_lh_diff the placement cost computed at the node above the
+   start_node (if any)
+   @param search_paths if not null, the search is restricted to the nodes on
+   the paths from the start_node to some seed nodes (mapped to TRUE for the
+   seeds, FALSE otherwise), the whole subtrees of the seeds, and the subtrees
+   hanging off those paths up to side_depth levels below their tops (or in
+   full if they improve the best placement). A node at the last of those
+   levels whose placement cost is still within side_margin (or within the
+   absolute value of the best cost, if larger) of the best cost found so far
+   gets another side_depth levels.
+   @param side_depth, side_margin see search_paths
+   @param examined_placements if not null, all placements examined during the
+   search are added into this vector
    @throw std::logic\_error if unexpected values/behaviors found during the
    operations
    */
@@ -1864,10 +2383,21 @@ bool isDiffFromOrigPlacement(
                            bool& is_mid_branch,
                            cmaple::RealNumType& best_up_lh_diff,
                            cmaple::RealNumType& best_down_lh_diff,
-                           cmaple::Index& best_child_index);
+                           cmaple::Index& best_child_index,
+                           const bool read_only = false,
+                           const cmaple::RealNumType start_lh_diff =
+                               MIN_NEGATIVE,
+                           const std::unordered_map<cmaple::NumSeqsType, bool>*
+                               search_paths = nullptr,
+                           const short int side_depth = 0,
+                           const cmaple::RealNumType side_margin = 0,
+                           std::vector<SamplePlacement>* examined_placements =
+                               nullptr);
 
   /**
    Seek a position for placing a subtree/sample starting at the start_node
+   @param explored_nodes if not null, the vector indexes of the nodes whose
+   likelihoods were used during the search are added to it
 
    @throw std::logic\_error if unexpected values/behaviors found during the
    operations
@@ -1885,15 +2415,72 @@ bool isDiffFromOrigPlacement(
       cmaple::RealNumType& removed_blength,
       cmaple::RealNumType& opt_appending_blength,
       cmaple::RealNumType& opt_mid_top_blength,
-      cmaple::RealNumType& opt_mid_bottom_blength);
+      cmaple::RealNumType& opt_mid_bottom_blength,
+      std::vector<cmaple::NumSeqsType>* explored_nodes = nullptr);
     
     /**
-     Seek the best root position
+     Seek the best root position. The scores of the root candidates are
+     computed concurrently by scoreRootCandidates(), then the candidates are
+     visited in the (serial) depth-first order to pick the best root
      @throw std::logic\_error if unexpected values/behaviors found during the
      operations
      */
     template <const cmaple::StateType num_states>
     NumSeqsType seekBestRoot();
+
+    /**
+     Flags of a node in the root assessment: the node is a root candidate
+     (with a score)
+     */
+    static constexpr uint8_t ROOT_CANDIDATE_SCORED = 1;
+
+    /**
+     Flags of a node in the root assessment: the children of the node have
+     been scored (if they are root candidates)
+     */
+    static constexpr uint8_t ROOT_CANDIDATE_EXPANDED = 2;
+
+    /**
+     The minimum number of root candidates (per thread) from which the
+     subtrees are explored concurrently in scoreRootCandidates()
+     */
+    static constexpr size_t ROOT_CANDIDATES_PER_THREAD = 16;
+
+    /**
+     A root candidate to explore in scoreRootCandidates() with a lower bound of
+     the best score that seekBestRoot() has found when visiting it
+     */
+    typedef std::pair<std::unique_ptr<RootCandidate>, cmaple::RealNumType>
+        RootCandidateTask;
+
+    /**
+     Compute (concurrently) the scores of all root candidates that
+     seekBestRoot() may visit. As the best score found so far depends on the
+     order of the visits, it is bounded from below by the scores found on the
+     path from the current root, thus, the traversal stops no sooner than that
+     of seekBestRoot()
+     @param[out] candidate_scores the scores of the candidates (indexed by the
+     vector indexes of the nodes)
+     @param[out] candidate_flags ROOT_CANDIDATE_SCORED and
+     ROOT_CANDIDATE_EXPANDED of each node
+     @throw std::logic\_error if unexpected values/behaviors found during the
+     operations
+     */
+    template <const cmaple::StateType num_states>
+    void scoreRootCandidates(std::vector<cmaple::RealNumType>& candidate_scores,
+                             std::vector<uint8_t>& candidate_flags);
+
+    /**
+     Score a root candidate, then add its children as new candidates to
+     explore (if the traversal may continue)
+     @throw std::logic\_error if unexpected values/behaviors found during the
+     operations
+     */
+    template <const cmaple::StateType num_states>
+    void scoreRootCandidate(RootCandidateTask& candidate_task,
+                            cmaple::RealNumType* const candidate_scores,
+                            uint8_t* const candidate_flags,
+                            std::vector<RootCandidateTask>& new_tasks);
     
     /**
      Compute the root supports
@@ -1963,6 +2550,23 @@ bool isDiffFromOrigPlacement(
   void resetSPRFlags(const bool update_outdated,
                      const bool n_outdated);
 
+  /**
+   Check the budget of the current tree search (params->search_time_limit and
+   params->max_spr_evaluations); also save the current tree (see
+   saveSearchCheckpoint()) every params->checkpoint_interval seconds
+   @return TRUE if the budget is exhausted (i.e., the search should stop)
+   @throw ios::failure if the current tree cannot be saved
+   */
+  bool checkSearchBudget();
+
+  /**
+   Save the current tree and its log likelihood to params->checkpoint_path
+   (see saveCheckpoint()), and the tree in NEWICK format to
+   params->checkpoint_path + ".treefile", both atomically
+   @throw ios::failure if the files cannot be written
+   */
+  void saveSearchCheckpoint();
+
   /**
    Try to improve the entire tree with SPR moves
    @return total improvement
@@ -1973,6 +2577,59 @@ bool isDiffFromOrigPlacement(
   cmaple::RealNumType improveEntireTree(const TreeSearchType tree_search_type,
                                         bool short_range_search);
 
+  /**
+   Try to improve the entire tree with SPR moves, which are sought for
+   batches of params->spr_batch_size (or SPRTA_BATCH_SIZE when computing
+   SPRTA without changing the topology) outdated nodes (in the DFS order) by
+   improveSubTreesInBatch()
+   @return total improvement
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  cmaple::RealNumType improveEntireTreeInBatches(
+      const TreeSearchType tree_search_type,
+      bool short_range_search);
+
+  /**
+   Try to improve subtrees rooted at batch_nodes with SPR moves, which are
+   sought concurrently (against the same tree), then applied one by one. A
+   move is re-sought against the updated tree if it was invalidated by an
+   earlier move in the batch (see isSubTreeSPRValid()). When computing SPRTA
+   (with lh_stamps allocated), a move is also re-sought if any node explored
+   to seek it was changed, thus, the SPRTA scores are the same as those of
+   the serial search.
+   @param improvements the output improvement of each subtree
+   @return total improvement
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  cmaple::RealNumType improveSubTreesInBatch(
+      const std::vector<cmaple::Index>& batch_nodes,
+      const TreeSearchType tree_search_type,
+      const bool short_range_search,
+      std::vector<cmaple::RealNumType>& improvements);
+
+  /**
+   Try to improve the entire tree with SPR moves, seeking the moves of the
+   outdated nodes from a priority queue keyed on their expected improvements,
+   i.e., (recent gain + 1 / (1 + age)) / log2(2 + subtree size), where the
+   recent gain is the (decayed) improvement recently obtained at/below the
+   node (see spr_gains), and the age is the number of rounds since the node
+   was outdated (i.e., its likelihoods changed). With params->spr_early_stop,
+   the round stops once the projected improvement of the remaining nodes
+   (estimated from the recently processed nodes) drops below
+   params->thresh_entire_tree_improvement.
+   @return total improvement
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  cmaple::RealNumType improveEntireTreeByPriority(
+      const TreeSearchType tree_search_type,
+      bool short_range_search);
+
   /**
    Try to optimize branch lengths of the tree by one round of tree traversal
    @return num of improvements
@@ -1982,6 +2639,17 @@ bool isDiffFromOrigPlacement(
   template <const cmaple::StateType num_states>
   cmaple::PositionType optimizeBranchIter();
 
+  /**
+   Like optimizeBranchIter() but in two phases: first, estimate the lengths of
+   all (outdated) branches concurrently from the current likelihoods; then,
+   apply the changed lengths and update the partial likelihoods in one pass
+   @return num of improvements
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  cmaple::PositionType optimizeBranchIterInBatch();
+
   /**
    Estimate the length of a branch using the derivative of the likelihood cost
    function wrt the branch length
@@ -2021,6 +2689,17 @@ bool isDiffFromOrigPlacement(
       const std::unique_ptr<SeqRegions>& child_regions,
       const cmaple::RealNumType blength);
 
+  /**
+   Calculate the placement cost of a subtree from the regions in either layout
+   (SeqRegions or SeqRegionsSoA)
+   @param child_regions: vector of regions of the new sample
+   */
+  template <const cmaple::StateType num_states, typename RegionsType>
+  cmaple::RealNumType calculateSubTreePlacementCostRegions(
+      const RegionsType& parent_regions,
+      const RegionsType& child_regions,
+      const cmaple::RealNumType blength);
+
   /**
    Update lower lh of a node
    @throw std::logic\_error if unexpected values/behaviors found during the
@@ -2058,6 +2737,33 @@ bool isDiffFromOrigPlacement(
       PhyloNode& neighbor_2,
       const cmaple::PositionType& seq_length);
 
+  /**
+   Update lower lh of a node and compute its likelihood contribution at the
+   same time (i.e., updateLowerLh() and computeLhContribution() in a single
+   merge). If the zero-length branches to its children need to be updated,
+   total_lh becomes NaN, i.e., the contributions must be recomputed
+   @throw std::logic\_error if unexpected values/behaviors found during the
+   operations
+   */
+  template <const cmaple::StateType num_states>
+  void updateLowerLhAndLhContribution(
+      cmaple::RealNumType& total_lh,
+      std::unique_ptr<SeqRegions>& new_lower_lh,
+      PhyloNode& node,
+      const std::unique_ptr<SeqRegions>& lower_lh_1,
+      const std::unique_ptr<SeqRegions>& lower_lh_2,
+      const cmaple::Index neighbor_1_index,
+      PhyloNode& neighbor_1,
+      const cmaple::Index neighbor_2_index,
+      PhyloNode& neighbor_2,
+      const cmaple::PositionType& seq_length);
+
+  /**
+   Record the likelihood contribution of a node (in node_lhs)
+   */
+  void setNodeLhContribution(PhyloNode& node,
+                             const cmaple::RealNumType lh_contribution);
+
   /**
    compute the likelihood contribution of (the upper branch of) a node
    @throw std::logic\_error if unexpected values/behaviors found during the
@@ -2161,6 +2867,9 @@ void cmaple::Tree::refreshAllLhs(bool avoid_using_upper_lr_lhs) {
   } else {
     performDFS<&cmaple::Tree::updateLowerLh<num_states>>();
   }
+  if (mutation_index.isActive()) {
+    indexAllNodes();
+  }
 
   // 2. update all the non-lower lhs along the tree
   refreshAllNonLowerLhs<num_states>();
@@ -2173,6 +2882,25 @@ RealNumType cmaple::Tree::improveEntireTree(const TreeSearchType tree_search_typ
   assert(model);
   assert(cumulative_rate);
   assert(nodes.size() > 0);
+
+  // seek SPR moves in the order of their expected improvements (if requested).
+  // SPRTA scores depend on the order of the nodes, thus they require the DFS
+  // order
+  if (params->spr_priority && !params->compute_SPRTA) {
+    return improveEntireTreeByPriority<num_states>(tree_search_type,
+                                                   short_range_search);
+  }
+
+  // seek SPR moves in batches (if requested). SPRTA scores are computed
+  // while seeking the moves, thus they require the serial search, unless the
+  // topology is kept unchanged and the likelihood changes are tracked (to
+  // recompute the scores affected by the branch lengths changed in a batch)
+  if ((params->spr_batch_size > 1 && !params->compute_SPRTA) ||
+      (params->compute_SPRTA && tree_search_type == FAST_TREE_SEARCH &&
+       !lh_stamps.empty())) {
+    return improveEntireTreeInBatches<num_states>(tree_search_type,
+                                                  short_range_search);
+  }
     
   // start from the root
   std::stack<Index> node_stack;
@@ -2254,6 +2982,12 @@ RealNumType cmaple::Tree::improveEntireTree(const TreeSearchType tree_search_typ
              << " nodes." << std::endl;
         count_node_1K = num_nodes;
       }
+
+      // stop if the budget of the tree search is exhausted
+      ++num_spr_evaluations;
+      if (checkSearchBudget()) {
+        break;
+      }
     }
   }
 
@@ -2288,7 +3022,13 @@ void cmaple::Tree::seekSamplePlacement(
     bool& is_mid_branch,
     RealNumType& best_up_lh_diff,
     RealNumType& best_down_lh_diff,
-    Index& best_child_index) {
+    Index& best_child_index,
+    const bool read_only,
+    const RealNumType start_lh_diff,
+    const std::unordered_map<NumSeqsType, bool>* search_paths,
+    const short int side_depth,
+    const RealNumType side_margin,
+    std::vector<SamplePlacement>* examined_placements) {
   assert(sample_regions && sample_regions->size() > 0);
   assert(seq_name_index >= 0);
   assert(aln);
@@ -2306,12 +3046,29 @@ void cmaple::Tree::seekSamplePlacement(
   PositionType seq_length = static_cast<PositionType>(aln->ref_seq.size());
   // stack of nodes to examine positions
   std::stack<TraversingNode> extended_node_stack;
-  extended_node_stack.push(TraversingNode(start_node_index, 0, MIN_NEGATIVE));
+  extended_node_stack.push(TraversingNode(start_node_index, 0, start_lh_diff));
+  // if the search is restricted to search_paths, the number of levels that
+  // can still be explored below each node of the stack (or one of the
+  // following values)
+  const short int unrestricted = -1;
+  const short int on_path = -2;
+  std::stack<short int> depth_stack;
+  if (search_paths) {
+    const auto it = search_paths->find(start_node_index.getVectorIndex());
+    depth_stack.push(it != search_paths->end() && it->second ? unrestricted
+                                                              : on_path);
+  }
 
   // recursively examine positions for placing the new sample
   while (!extended_node_stack.empty()) {
     TraversingNode current_extended_node = std::move(extended_node_stack.top());
     extended_node_stack.pop();
+    short int depth = unrestricted;
+    if (search_paths) {
+      depth = depth_stack.top();
+      depth_stack.pop();
+    }
+    const RealNumType prev_best_lh_diff = best_lh_diff;
     const NumSeqsType current_node_vec =
         current_extended_node.getIndex().getVectorIndex();
     PhyloNode& current_node = nodes[current_node_vec];
@@ -2333,8 +3090,12 @@ void cmaple::Tree::seekSamplePlacement(
         (current_node.getPartialLh(TOP)->compareWithSample(
              *sample_regions, seq_length, aln,
             collapse_only_ident_seqs) == 1)) {
-      current_node.addLessInfoSeqs(seq_name_index);
-      selected_node_index = Index();
+      if (read_only) {
+        selected_node_index = Index(current_node_vec, UNDEFINED);
+      } else {
+        current_node.addLessInfoSeqs(seq_name_index);
+        selected_node_index = Index();
+      }
       return;
     }
 
@@ -2365,6 +3126,16 @@ void cmaple::Tree::seekSamplePlacement(
       lh_diff_at_node = current_extended_node.getLhDiff();
     }
 
+    // record the placements examined at the current node
+    if (examined_placements) {
+      recordExaminedPlacement(examined_placements, current_node_vec, true,
+                              lh_diff_mid_branch);
+      if (root_vector_index == current_node_vec || current_node_blength > 0) {
+        recordExaminedPlacement(examined_placements, current_node_vec, false,
+                                lh_diff_at_node);
+      }
+    }
+
     // keep trying to place at children nodes, unless the number of attempts has
     // reaches the failure limit
     const short int failure_count = current_extended_node.getFailureCount();
@@ -2378,12 +3149,38 @@ void cmaple::Tree::seekSamplePlacement(
           extended_node_stack.push(TraversingNode(neighbor_index,
          current_extended_node.getFailureCount(), lh_diff_at_node));*/
       if (is_internal) {
-        extended_node_stack.push(
-            TraversingNode(current_node.getNeighborIndex(RIGHT), failure_count,
-                           lh_diff_at_node));
-        extended_node_stack.push(
-            TraversingNode(current_node.getNeighborIndex(LEFT), failure_count,
-                           lh_diff_at_node));
+        // a side subtree that improves the best placement is searched in full
+        // (as the search from the start node would do)
+        if (depth >= 0 && best_lh_diff > prev_best_lh_diff) {
+          depth = unrestricted;
+        }
+
+        for (const MiniIndex mini_index : {RIGHT, LEFT}) {
+          const Index child_index = current_node.getNeighborIndex(mini_index);
+          if (search_paths) {
+            short int child_depth = depth;
+            if (depth == on_path) {
+              const auto it = search_paths->find(child_index.getVectorIndex());
+              child_depth = it == search_paths->end()
+                                ? side_depth
+                                : (it->second ? unrestricted : on_path);
+            } else if (depth == 0) {
+              // keep searching below a node that is still close to the best
+              // placement (poorly matching samples have more distant
+              // alternatives, hence the margin grows with the best cost)
+              if (lh_diff_at_node <=
+                  best_lh_diff - std::max(side_margin, -best_lh_diff)) {
+                continue;
+              }
+              child_depth = side_depth;
+            } else if (depth > 0) {
+              child_depth = depth - 1;
+            }
+            depth_stack.push(child_depth);
+          }
+          extended_node_stack.push(
+              TraversingNode(child_index, failure_count, lh_diff_at_node));
+        }
       }
     }
   }
@@ -2401,6 +3198,12 @@ void cmaple::Tree::seekSamplePlacement(
     finetuneSamplePlacementAtNode<num_states>(
         nodes[selected_node_index.getVectorIndex()], best_down_lh_diff,
         best_child_index, sample_regions);
+    if (examined_placements &&
+        best_child_index.getMiniIndex() != UNDEFINED) {
+      recordExaminedPlacement(examined_placements,
+                              best_child_index.getVectorIndex(), true,
+                              best_down_lh_diff);
+    }
   }
 }
 
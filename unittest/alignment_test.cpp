@@ -257,6 +257,100 @@ TEST(Alignment, readMapleFile)
     EXPECT_THROW(aln.read(example_dir + "input.fa", "", cmaple::Alignment::IN_MAPLE), std::invalid_argument);
 }
 
+/*
+ Test groupIdenticalSeqs() via read()
+ */
+TEST(Alignment, groupIdenticalSeqs)
+{
+    // detect the path to the example directory
+    std::string example_dir = "../../example/";
+    if (!fileExists(example_dir + "example.maple"))
+        example_dir = "../example/";
+    
+    Alignment aln;
+    aln.read(example_dir + "test_5K.maple");
+    EXPECT_EQ(aln.representative_seqs.size(), aln.data.size());
+    
+    NumSeqsType num_identical_seqs = 0;
+    for (NumSeqsType i = 0; i < aln.data.size(); ++i)
+    {
+        const NumSeqsType rep = aln.representative_seqs[i];
+        EXPECT_LE(rep, i);
+        if (rep != i)
+        {
+            ++num_identical_seqs;
+            // a representative is its own representative
+            EXPECT_EQ(aln.representative_seqs[rep], rep);
+            // and has the same mutations
+            ASSERT_EQ(aln.data[rep].size(), aln.data[i].size());
+            for (std::vector<Mutation>::size_type j = 0; j < aln.data[i].size(); ++j)
+            {
+                EXPECT_EQ(aln.data[rep][j].type, aln.data[i][j].type);
+                EXPECT_EQ(aln.data[rep][j].position, aln.data[i][j].position);
+                EXPECT_EQ(aln.data[rep][j].getLength(), aln.data[i][j].getLength());
+            }
+        }
+    }
+    EXPECT_EQ(num_identical_seqs, 891);
+    
+    // no identical sequences in input.fa
+    aln.read(example_dir + "input.fa");
+    for (NumSeqsType i = 0; i < aln.data.size(); ++i)
+        EXPECT_EQ(aln.representative_seqs[i], i);
+}
+
+/*
+ Test readMapleSeq(std::istream& seq_stream, Sequence& sequence, PositionType& line_num)
+ */
+TEST(Alignment, readMapleSeq)
+{
+    // detect the path to the example directory
+    std::string example_dir = "../../example/";
+    if (!fileExists(example_dir + "example.maple"))
+        example_dir = "../example/";
+    
+    Alignment aln;
+    aln.read(example_dir + "example.maple");
+    const char mut_char = Alignment::convertState2Char((aln.ref_seq[4] + 1) % 4, aln.getSeqType());
+    
+    // samples end at an empty line or right before the next sample
+    std::stringstream seq_stream;
+    seq_stream << "\n>s1\nn\t1\t10\n" << mut_char << "\t5\n\n>s2\n>s3\n-\t20\t2\n";
+    Sequence sequence;
+    PositionType line_num = 0;
+    EXPECT_TRUE(aln.readMapleSeq(seq_stream, sequence, line_num));
+    EXPECT_EQ(sequence.seq_name, "s1");
+    ASSERT_EQ(sequence.size(), 2);
+    EXPECT_EQ(sequence[0].type, TYPE_N);
+    EXPECT_EQ(sequence[0].position, 0);
+    EXPECT_EQ(sequence[0].getLength(), 10);
+    EXPECT_EQ(sequence[1].type, (aln.ref_seq[4] + 1) % 4);
+    EXPECT_EQ(sequence[1].position, 4);
+    EXPECT_EQ(line_num, 5);
+    
+    EXPECT_TRUE(aln.readMapleSeq(seq_stream, sequence, line_num));
+    EXPECT_EQ(sequence.seq_name, "s2");
+    EXPECT_EQ(sequence.size(), 0);
+    
+    EXPECT_TRUE(aln.readMapleSeq(seq_stream, sequence, line_num));
+    EXPECT_EQ(sequence.seq_name, "s3");
+    ASSERT_EQ(sequence.size(), 1);
+    EXPECT_EQ(sequence[0].type, TYPE_DEL);
+    EXPECT_EQ(sequence[0].position, 19);
+    EXPECT_EQ(sequence[0].getLength(), 2);
+    
+    EXPECT_FALSE(aln.readMapleSeq(seq_stream, sequence, line_num));
+    
+    // a sample must start by its name
+    std::stringstream invalid_stream("N\t1\t10\n");
+    EXPECT_THROW(aln.readMapleSeq(invalid_stream, sequence, line_num), std::logic_error);
+    
+    // a mutation must differ from the reference
+    std::stringstream ref_stream;
+    ref_stream << ">s4\n" << Alignment::convertState2Char(aln.ref_seq[4], aln.getSeqType()) << "\t5\n";
+    EXPECT_THROW(aln.readMapleSeq(ref_stream, sequence, line_num), std::logic_error);
+}
+
 /*
  Test write()
  */
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "../alignment/cumulativebase.h"
+
+using namespace cmaple;
+
+/*
+ Check the counts of a CumulativeBase against the naive prefix counts
+ */
+void checkCounts(const CumulativeBase& cumulative_base,
+                 const std::vector<StateType>& ref_seq,
+                 const StateType num_states)
+{
+    std::vector<PositionType> counts(num_states, 0);
+    for (PositionType pos = 0; pos <= static_cast<PositionType>(ref_seq.size()); ++pos)
+    {
+        for (StateType i = 0; i < num_states; ++i)
+            EXPECT_EQ(cumulative_base.getCount(pos, i), counts[i]);
+        if (pos < static_cast<PositionType>(ref_seq.size()))
+            ++counts[ref_seq[pos]];
+    }
+
+    // counts in ranges
+    EXPECT_EQ(cumulative_base.getCount(0, 0, ref_seq[0]), 1);
+    EXPECT_EQ(cumulative_base.getCount(0, static_cast<PositionType>(ref_seq.size()) - 1, 0), counts[0]);
+}
+
+/*
+ Test build() and getCount() with both layouts
+ */
+TEST(CumulativeBase, build)
+{
+    CumulativeBase cumulative_base;
+    EXPECT_TRUE(cumulative_base.empty());
+    EXPECT_EQ(cumulative_base.getMemorySize(), 0);
+
+    // different lengths around the block size
+    for (PositionType length : {1, 255, 256, 257, 1000, 30000})
+    {
+        for (StateType num_states : {4, 20})
+        {
+            std::vector<StateType> ref_seq(length);
+            for (PositionType i = 0; i < length; ++i)
+                ref_seq[i] = (i * 7 + i / 3) % num_states;
+
+            cumulative_base.build(ref_seq, num_states, CumulativeBase::DENSE);
+            EXPECT_FALSE(cumulative_base.empty());
+            EXPECT_EQ(cumulative_base.getLayout(), CumulativeBase::DENSE);
+            checkCounts(cumulative_base, ref_seq, num_states);
+            const size_t dense_size = cumulative_base.getMemorySize();
+
+            cumulative_base.build(ref_seq, num_states, CumulativeBase::BLOCKED);
+            EXPECT_EQ(cumulative_base.getLayout(), CumulativeBase::BLOCKED);
+            checkCounts(cumulative_base, ref_seq, num_states);
+            EXPECT_LT(cumulative_base.getMemorySize(), dense_size);
+        }
+    }
+
+    // AUTO picks the dense layout for short genomes
+    cumulative_base.build(std::vector<StateType>(1000, 0), 4);
+    EXPECT_EQ(cumulative_base.getLayout(), CumulativeBase::DENSE);
+}
@@ -56,6 +56,8 @@ TEST(RateVariation, testMatrices)
 
     ModelDNARateVariation* rv_model = (ModelDNARateVariation*) tree.model;
     rv_model->setAllMatricesToDefault();
+    // all sites share the default matrix
+    EXPECT_EQ(rv_model->getNumMatrices(), 1);
 
     for(int i = 0; i < aln.ref_seq.size(); ++i) {
         for(StateType a = 0; a < 4; ++a) {
@@ -388,7 +388,7 @@ TEST(SeqRegions, areDiffFrom)
 }
 
 /*
- Test simplifyO(RealNumType* const partial_lh, StateType ref_state,
+ Test simplifyO(LhNumType* const partial_lh, StateType ref_state,
  StateType num_states, RealNumType threshold) const
  */
 TEST(SeqRegions, simplifyO)
@@ -424,6 +424,42 @@ TEST(SeqRegions, simplifyO)
 #endif
 }
 
+/*
+ Test writeCheckpoint() and readCheckpoint()
+ */
+TEST(SeqRegions, checkpoint)
+{
+    // init testing data
+    std::unique_ptr<SeqRegions> seqregions1 = cmaple::make_unique<SeqRegions>();
+    seqregions1->emplace_back(TYPE_R, 132, 0, 0.0023);
+    auto new_lh = cmaple::make_unique<SeqRegion::LHType>();
+    SeqRegion::LHType new_lh_value{0.1,0.3,0.2,0.4};
+    (*new_lh) = new_lh_value;
+    seqregions1->emplace_back(TYPE_O, 133, 1e-5, -1, std::move(new_lh));
+    seqregions1->emplace_back(2, 134, -1, 0.013);
+    seqregions1->emplace_back(TYPE_N, 3500);
+    std::unique_ptr<SeqRegions> seqregions2 = nullptr;
+    
+    // tests
+    std::stringstream stream;
+    BinaryWriter writer(stream);
+    SeqRegions::writeCheckpoint(writer, seqregions1, 4);
+    SeqRegions::writeCheckpoint(writer, seqregions2, 4);
+    std::string checkpoint = stream.str();
+    
+    BinaryReader reader(stream);
+    std::unique_ptr<SeqRegions> seqregions3 = SeqRegions::readCheckpoint(reader, 4);
+    std::unique_ptr<SeqRegions> seqregions4 = SeqRegions::readCheckpoint(reader, 4);
+    EXPECT_TRUE(seqregions3 && *seqregions3 == *seqregions1);
+    EXPECT_EQ(seqregions4, nullptr);
+    EXPECT_TRUE(reader.atEnd());
+    
+    // Test a truncated checkpoint
+    std::stringstream truncated_stream(checkpoint.substr(0, checkpoint.size() / 2));
+    BinaryReader truncated_reader(truncated_stream);
+    EXPECT_THROW(SeqRegions::readCheckpoint(truncated_reader, 4), std::logic_error);
+}
+
 /*
  Test computeAbsoluteLhAtRoot(const Alignment& aln, const ModelBase* model)
  */
@@ -0,0 +1,201 @@
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#pragma once
+
+namespace cmaple {
+/** Write plain data into a binary stream (in the native byte order) */
+class BinaryWriter {
+ private:
+  /**
+   The output stream
+   */
+  std::ostream& out_;
+
+ public:
+  /**
+   *  BinaryWriter constructor
+   */
+  explicit BinaryWriter(std::ostream& out) : out_(out) {}
+
+  /**
+   Write a value of a trivially copyable type
+   */
+  template <typename T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable types can be written directly");
+    out_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  /**
+   Write an array of num_items values
+   */
+  template <typename T>
+  void writeArray(const T* values, const size_t num_items) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable types can be written directly");
+    if (num_items) {
+      out_.write(reinterpret_cast<const char*>(values),
+                 static_cast<std::streamsize>(num_items * sizeof(T)));
+    }
+  }
+
+  /**
+   Write a vector (its size then its items)
+   */
+  template <typename T>
+  void writeVector(const std::vector<T>& values) {
+    write<uint64_t>(values.size());
+    writeArray(values.data(), values.size());
+  }
+
+  /**
+   Write a vector of booleans (its size then its items, one byte per item)
+   */
+  void writeVector(const std::vector<bool>& values) {
+    write<uint64_t>(values.size());
+    for (const bool value : values) {
+      write<uint8_t>(value);
+    }
+  }
+
+  /**
+   Write a string (its length then its characters)
+   */
+  void writeString(const std::string& value) {
+    write<uint64_t>(value.size());
+    writeArray(value.data(), value.size());
+  }
+};
+
+/** Read plain data written by BinaryWriter. The whole stream is read into
+ * memory at once, then values are copied from that buffer */
+class BinaryReader {
+ private:
+  /**
+   The content of the input stream
+   */
+  std::vector<char> buffer_;
+
+  /**
+   The position of the next value in buffer_
+   */
+  size_t pos_ = 0;
+
+  /**
+   Make sure the buffer still contains num_items items of item_size bytes
+   (without overflowing num_items * item_size)
+   @throw std::logic\_error if the buffer is exhausted
+   */
+  void require(const uint64_t num_items, const size_t item_size = 1) const {
+    if (num_items > (buffer_.size() - pos_) / item_size) {
+      throw std::logic_error("Unexpected end of the binary stream!");
+    }
+  }
+
+ public:
+  /**
+   *  BinaryReader constructor: reads the rest of the stream with a single
+   *  read if its size is known (seekable streams), byte by byte otherwise
+   *  @throw std::logic\_error if the stream can't be read
+   */
+  explicit BinaryReader(std::istream& in) {
+    const std::istream::pos_type start = in.tellg();
+    if (start != std::istream::pos_type(-1) &&
+        in.seekg(0, std::ios::end)) {
+      const std::istream::pos_type end = in.tellg();
+      in.seekg(start);
+      buffer_.resize(static_cast<size_t>(end - start));
+      if (!buffer_.empty() &&
+          !in.read(buffer_.data(),
+                   static_cast<std::streamsize>(buffer_.size()))) {
+        throw std::logic_error("Failed to read the binary stream!");
+      }
+    } else {
+      in.clear();
+      buffer_.assign(std::istreambuf_iterator<char>(in),
+                     std::istreambuf_iterator<char>());
+    }
+  }
+
+  /**
+   Check if all values have been read
+   */
+  bool atEnd() const { return pos_ == buffer_.size(); }
+
+  /**
+   Read a value of a trivially copyable type
+   @throw std::logic\_error if the stream is exhausted
+   */
+  template <typename T>
+  T read() {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable types can be read directly");
+    require(sizeof(T));
+    T value;
+    std::memcpy(&value, buffer_.data() + pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return value;
+  }
+
+  /**
+   Read an array of num_items values
+   @throw std::logic\_error if the stream is exhausted
+   */
+  template <typename T>
+  void readArray(T* values, const size_t num_items) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable types can be read directly");
+    if (num_items) {
+      require(num_items, sizeof(T));
+      std::memcpy(values, buffer_.data() + pos_, num_items * sizeof(T));
+      pos_ += num_items * sizeof(T);
+    }
+  }
+
+  /**
+   Read a vector written by BinaryWriter::writeVector()
+   @throw std::logic\_error if the stream is exhausted
+   */
+  template <typename T>
+  void readVector(std::vector<T>& values) {
+    const uint64_t num_items = read<uint64_t>();
+    require(num_items, sizeof(T));
+    values.resize(num_items);
+    readArray(values.data(), num_items);
+  }
+
+  /**
+   Read a vector of booleans written by BinaryWriter::writeVector()
+   @throw std::logic\_error if the stream is exhausted
+   */
+  void readVector(std::vector<bool>& values) {
+    const uint64_t num_items = read<uint64_t>();
+    require(num_items);
+    values.resize(num_items);
+    for (uint64_t i = 0; i < num_items; ++i) {
+      values[i] = read<uint8_t>();
+    }
+  }
+
+  /**
+   Read a string written by BinaryWriter::writeString()
+   @throw std::logic\_error if the stream is exhausted
+   */
+  std::string readString() {
+    const uint64_t length = read<uint64_t>();
+    require(length);
+    std::string value(buffer_.data() + pos_, static_cast<size_t>(length));
+    pos_ += length;
+    return value;
+  }
+};
+}  // namespace cmaple
@@ -0,0 +1,33 @@
+#pragma once
+//
+// The function pointers of the hand-vectorised 20-state kernels (matrix20.h)
+// for the runtime dispatch of the SIMD kernels (CMAPLE_SIMD_DISPATCH, see
+// matrix.h). This header is kept free of other includes, as it is also
+// compiled with the -m flags of each ISA level (matrix20_<isa>.cpp).
+//
+
+namespace cmaple {
+namespace simd {
+/** The 20-state kernels compiled for an ISA level */
+struct Kernels20 {
+  float (*dotProduct20Float)(const float*, const float*);
+  double (*dotProduct20Double)(const double*, const double*);
+  void (*matrixVectorProduct20)(const double*, const double*, double*);
+
+  /** Overloads to call the kernels like those of matrix20.h */
+  float dotProduct20(const float* p1, const float* p2) const {
+    return dotProduct20Float(p1, p2);
+  }
+  double dotProduct20(const double* p1, const double* p2) const {
+    return dotProduct20Double(p1, p2);
+  }
+};
+
+/** The kernels for the baseline (SSE4.2) and the AVX2 levels */
+extern const Kernels20 kernels20_sse42;
+extern const Kernels20 kernels20_avx2;
+
+/** The kernels picked for the CPU (those of the baseline until then) */
+extern Kernels20 kernels20;
+}  // namespace simd
+}  // namespace cmaple
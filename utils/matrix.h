@@ -28,60 +28,40 @@
 // Some math & matrix functions  (some using SSE/AVX/NEON for significantly better speed)
 //
 
-// let's include some x64 instrinsics from SIMDe; SIMDe will translate to Neon for ARM automatically
-#include <simde/x86/sse2.h>
-#include <simde/x86/sse4.1.h>
-#include <simde/x86/avx.h>
-
 #include "tools.h"
 
 #include <assert.h>
 #include <vector>
 
-// Multiply 4 floats by another 4 floats.
-// inspired by https://stackoverflow.com/a/59495197
-template<int offsetRegs>
-inline simde__m128 mul4(const float* p1, const float* p2)
-{
-  constexpr int lanes = offsetRegs * 4;
-  const simde__m128 a = simde_mm_loadu_ps(p1 + lanes);
-  const simde__m128 b = simde_mm_loadu_ps(p2 + lanes);
-  return simde_mm_mul_ps(a, b);
-}
-
-// Multiply 4 doubles by another 4 doubles.
-template<int offsetRegs>
-inline simde__m256d mul4(const double* p1, const double* p2)
-{
-  constexpr int lanes = offsetRegs * 4;
-  const simde__m256d a = simde_mm256_loadu_pd(p1 + lanes);
-  const simde__m256d b = simde_mm256_loadu_pd(p2 + lanes);
-  return simde_mm256_mul_pd(a, b);
-}
-
-// sum up 4 floats (SSE)
-// see https://stackoverflow.com/a/59495197
-inline float horiz_sum(simde__m128 v) {
-  // Add 4 values into 2
-  const simde__m128 r2 = simde_mm_add_ps(v, simde_mm_movehl_ps(v, v));
-  // Add 2 lower values into the final result
-  const simde__m128 r1 = simde_mm_add_ss(r2, simde_mm_movehdup_ps(r2));
-  // Return the lowest lane of the result vector.
-  // The intrinsic below compiles into noop, modern compilers return floats in the lowest lane of xmm0 register.
-  return simde_mm_cvtss_f32(r1);
-}
+// Runtime dispatch of the SIMD kernels (USE_SIMD_DISPATCH in CMakeLists.txt):
+// a function marked with CMAPLE_SIMD_KERNEL is compiled for several ISA levels
+// (the baseline SSE4.2, AVX2+FMA and AVX-512), and the best one for the CPU is
+// picked (via CPUID) once, when the binary is loaded. The helpers it inlines
+// (e.g., dotProduct(), updateLHwithMat()) are compiled for the same ISA. FMA
+// contraction is off, thus, all ISA levels give bit-identical results.
+// The hand-vectorised 20-state kernels (matrix20.h) use AVX intrinsics, which
+// the target_clones below can't map to AVX instructions (SIMDe picks the
+// instructions when preprocessing). Thus, they are compiled in their own
+// translation units (matrix20_<isa>.cpp, with the -m flags of each ISA level)
+// and called via the function pointers of kernels20, which are set to the best
+// ones for the CPU at load time.
+#ifdef CMAPLE_SIMD_DISPATCH
+#define CMAPLE_SIMD_KERNEL \
+  __attribute__((target_clones("default", "arch=x86-64-v3", "arch=x86-64-v4")))
+
+#include "kernels20.h"
+
+#define CMAPLE_SIMD_KERNELS20_CALL(kernel) cmaple::simd::kernels20.kernel
+#else
+#define CMAPLE_SIMD_KERNEL
 
-// sum up 4 doubles (AVX)
-// see https://stackoverflow.com/a/49943540
-inline double horiz_sum(simde__m256d v) {
-  simde__m128d vlow = simde_mm256_castpd256_pd128(v);
-  simde__m128d vhigh = simde_mm256_extractf128_pd(v, 1); // high 128
-  vlow = simde_mm_add_pd(vlow, vhigh);     // reduce down to 128
-
-  simde__m128d high64 = simde_mm_unpackhi_pd(vlow, vlow);
-  return  simde_mm_cvtsd_f64(simde_mm_add_sd(vlow, high64));  // reduce to scalar
-}
+// let's include some x64 instrinsics from SIMDe; SIMDe will translate to Neon for ARM automatically
+#define CMAPLE_SIMD_ISA native
+#include "matrix20.h"
+#undef CMAPLE_SIMD_ISA
 
+#define CMAPLE_SIMD_KERNELS20_CALL(kernel) cmaple::native::kernel
+#endif
 
 // Compute dot product of float vectors
 template <cmaple::StateType length, typename RealType>
@@ -99,50 +79,52 @@ inline RealType dotProduct(const RealType* p1, const RealType* p2)
 template <>
 inline float dotProduct<20>(const float* p1, const float* p2)
 {
-  // const int count = 20;
-  // const float* const p1End = p1 + count;
-
-  // Process all 20 values. Nothing to add yet, just multiplying.
-  auto dot0 = mul4<0>(p1, p2);
-  auto dot1 = mul4<1>(p1, p2);
-  auto dot2 = mul4<2>(p1, p2);
-  auto dot3 = mul4<3>(p1, p2);
-  auto dot4 = mul4<4>(p1, p2);
-
-  // 20 to 4
-  const auto dot01 = simde_mm_add_ps(dot0, dot1);
-  const auto dot23 = simde_mm_add_ps(dot2, dot3);
-  const auto dot401 = simde_mm_add_ps(dot4, dot01);
-  const auto dot23401 = simde_mm_add_ps(dot23, dot401);
-
-  return horiz_sum(dot23401);
+  return CMAPLE_SIMD_KERNELS20_CALL(dotProduct20)(p1, p2);
 }
 
 template <>
 inline double dotProduct<20>(const double* p1, const double* p2)
 {
-  // const int count = 20;
-  // const double* const p1End = p1 + count;
+  return CMAPLE_SIMD_KERNELS20_CALL(dotProduct20)(p1, p2);
+}
 
-  // Process all 20 values. Nothing to add yet, just multiplying.
-  auto dot0 = mul4<0>(p1, p2);
-  auto dot1 = mul4<1>(p1, p2);
-  auto dot2 = mul4<2>(p1, p2);
-  auto dot3 = mul4<3>(p1, p2);
-  auto dot4 = mul4<4>(p1, p2);
+// Compute dot product of vectors of different types (e.g., a row of a matrix
+// and a partial likelihood vector stored in float), accumulated in RealNumType
+template <cmaple::StateType length, typename RealType1, typename RealType2>
+inline cmaple::RealNumType dotProduct(const RealType1* p1, const RealType2* p2)
+{
+  cmaple::RealNumType result{ 0 };
+  for (cmaple::StateType j = 0; j < length; ++j)
+  {
+    result += static_cast<cmaple::RealNumType>(p1[j]) * p2[j];
+  }
+  return result;
+}
 
-  // 20 to 4
-  const auto dot01 = simde_mm256_add_pd(dot0, dot1);
-  const auto dot23 = simde_mm256_add_pd(dot2, dot3);
-  const auto dot401 = simde_mm256_add_pd(dot4, dot01);
-  const auto dot23401 = simde_mm256_add_pd(dot23, dot401);
 
-  return horiz_sum(dot23401);
+// Compute the product of a (row-major) length x length matrix and a vector,
+// i.e., result[i] = dotProduct<length>(mat + i * length, vec)
+template <cmaple::StateType length, typename RealType1, typename RealType2>
+inline void matrixVectorProduct(const RealType1* mat, const RealType2* vec,
+                                cmaple::RealNumType* const result)
+{
+  for (cmaple::StateType i = 0; i < length; ++i, mat += length)
+  {
+    result[i] = dotProduct<length>(mat, vec);
+  }
 }
 
+// The 20-state (AA) version (see matrixVectorProduct20() of matrix20.h)
+template <>
+inline void matrixVectorProduct<20, double, double>(const double* mat,
+                                                    const double* vec,
+                                                    double* const result)
+{
+  CMAPLE_SIMD_KERNELS20_CALL(matrixVectorProduct20)(mat, vec, result);
+}
 
-template <cmaple::StateType length>
-cmaple::RealNumType sumMutationByLh(const cmaple::RealNumType* const vec1, const cmaple::RealNumType* const vec2)
+template <cmaple::StateType length, typename LhRealType>
+cmaple::RealNumType sumMutationByLh(const LhRealType* const vec1, const cmaple::RealNumType* const vec2)
 {
     cmaple::RealNumType result{0};
     for (cmaple::StateType j = 0; j < length; ++j)
@@ -152,19 +134,22 @@ cmaple::RealNumType sumMutationByLh(const cmaple::RealNumType* const vec1, const
 }
 
 
-template <cmaple::StateType length>
-cmaple::RealNumType matrixEvolve(const cmaple::RealNumType* const vec1,
-                                 const cmaple::RealNumType* const vec2,
+template <cmaple::StateType length, typename LhRealType>
+cmaple::RealNumType matrixEvolve(const LhRealType* const vec1,
+                                 const LhRealType* const vec2,
                                  const cmaple::RealNumType* mutation_mat_row,
                                  const cmaple::RealNumType total_blength)
 {
+    cmaple::RealNumType mut_lh[length];
+    matrixVectorProduct<length>(mutation_mat_row, vec2, mut_lh);
+
     cmaple::RealNumType result{ 0 };
-    for (cmaple::StateType i = 0; i < length; ++i, mutation_mat_row += length)
+    for (cmaple::StateType i = 0; i < length; ++i)
   {
     // NHANLT NOTE:
     // tot2: likelihood of i evolves to j
     // tot2 = (1 + mut[i,i] * total_blength) * lh(seq2,i) + mut[i,j] * total_blength * lh(seq2,j)
-      cmaple::RealNumType tot2 = dotProduct<length>(mutation_mat_row, vec2);
+      cmaple::RealNumType tot2 = mut_lh[i];
 
     // NHANLT NOTE:
     // tot = the likelihood of observing i * the likelihood of i evolves to j
@@ -173,8 +158,8 @@ cmaple::RealNumType matrixEvolve(const cmaple::RealNumType* const vec1,
   return result;
 }
 
-template <cmaple::StateType length>
-cmaple::RealNumType matrixEvolveRoot(const cmaple::RealNumType* const vec2,
+template <cmaple::StateType length, typename LhRealType>
+cmaple::RealNumType matrixEvolveRoot(const LhRealType* const vec2,
                                      const cmaple::StateType seq1_state,
                                      const cmaple::RealNumType* model_root_freqs,
                                      const cmaple::RealNumType* transposed_mut_mat_row,
@@ -183,8 +168,11 @@ cmaple::RealNumType matrixEvolveRoot(const cmaple::RealNumType* const vec2,
                                      const cmaple::RealNumType seq1_region_plength_observation2node)
 {
   static bool negativeProbWarning = false;
+  cmaple::RealNumType mut_lh[length];
+  matrixVectorProduct<length>(mutation_mat_row, vec2, mut_lh);
+
   cmaple::RealNumType result{ 0 };
-  for(cmaple::StateType i = 0; i < length; ++i, mutation_mat_row += length)
+  for(cmaple::StateType i = 0; i < length; ++i)
   {
     // NHANLT NOTE: UNSURE
     // tot2: likelihood that we can observe seq1_state elvoving from i (from root)
@@ -212,14 +200,14 @@ cmaple::RealNumType matrixEvolveRoot(const cmaple::RealNumType* const vec2,
     // NHANLT NOTE:
     // tot3: likelihood of i evolves to j
     // tot3 = (1 + mut[i,i] * total_blength) * lh(seq2,i) + mut[i,j] * total_blength * lh(seq2,j)
-    cmaple::RealNumType tot3 = dotProduct<length>(mutation_mat_row, vec2);
+    cmaple::RealNumType tot3 = mut_lh[i];
     result += tot2 * (vec2[i] + total_blength * tot3);
   }
   return result;
 }
 
-template <cmaple::StateType length>
-cmaple::RealNumType updateVecWithState(cmaple::RealNumType* const update_vec, const cmaple::StateType seq1_state,
+template <cmaple::StateType length, typename LhRealType>
+cmaple::RealNumType updateVecWithState(LhRealType* const update_vec, const cmaple::StateType seq1_state,
                                const cmaple::RealNumType* const vec,
                                const cmaple::RealNumType factor)
 {
@@ -246,8 +234,8 @@ cmaple::RealNumType updateVecWithState(cmaple::RealNumType* const update_vec, co
   return result;
 }
 
-template <cmaple::StateType length>
-void setVecWithState(cmaple::RealNumType* const set_vec, const cmaple::StateType seq1_state,
+template <cmaple::StateType length, typename LhRealType>
+void setVecWithState(LhRealType* const set_vec, const cmaple::StateType seq1_state,
   const cmaple::RealNumType* const vec,
   const cmaple::RealNumType factor)
 {
@@ -257,9 +245,9 @@ void setVecWithState(cmaple::RealNumType* const set_vec, const cmaple::StateType
   set_vec[seq1_state] += 1.0;
 }
 
-template <cmaple::StateType length>
+template <cmaple::StateType length, typename LhRealType>
 void updateCoeffs(const cmaple::RealNumType* const root_freqs,
-        const cmaple::RealNumType* const transposed_mut_mat_row, cmaple::RealNumType* const likelihood,
+        const cmaple::RealNumType* const transposed_mut_mat_row, LhRealType* const likelihood,
         const cmaple::RealNumType* const mutation_mat_row, const cmaple::RealNumType factor,
         cmaple::RealNumType& coeff0, cmaple::RealNumType& coeff1)
 {
@@ -270,24 +258,24 @@ void updateCoeffs(const cmaple::RealNumType* const root_freqs,
     }
 }
 
-template <cmaple::StateType length>
-void setVecByProduct(cmaple::RealNumType* const set_vec,
-    const cmaple::RealNumType* const vec1, const cmaple::RealNumType* const vec2)
+template <cmaple::StateType length, typename LhRealType>
+void setVecByProduct(LhRealType* const set_vec,
+    const LhRealType* const vec1, const LhRealType* const vec2)
 {
     for (cmaple::StateType j = 0; j < length; ++j)
         set_vec[j] = vec1[j] * vec2[j];
 }
 
 /* NHANLT: I'm not sure if there is an AVX instruction to reset all entries of a vector to zero */
-template <cmaple::StateType length>
-void resetVec(cmaple::RealNumType* const set_vec)
+template <cmaple::StateType length, typename LhRealType>
+void resetVec(LhRealType* const set_vec)
 {
     for (cmaple::StateType i = 0; i < length; ++i)
         set_vec[i] = 0;
 }
 
-template <cmaple::StateType length>
-cmaple::RealNumType resetLhVecExceptState(cmaple::RealNumType* const set_vec,
+template <cmaple::StateType length, typename LhRealType>
+cmaple::RealNumType resetLhVecExceptState(LhRealType* const set_vec,
         const cmaple::StateType state, const cmaple::RealNumType state_lh)
 {
     resetVec<length>(set_vec);
@@ -0,0 +1,26 @@
+// The 20-state kernels of matrix20.h for the baseline ISA level (SSE4.2) and
+// the choice of the kernels for the CPU (with CMAPLE_SIMD_DISPATCH only)
+#define CMAPLE_SIMD_ISA sse42
+#include "matrix20.h"
+#include "kernels20.h"
+
+using namespace cmaple;
+
+const simd::Kernels20 cmaple::simd::kernels20_sse42 = {
+    &sse42::dotProduct20, &sse42::dotProduct20, &sse42::matrixVectorProduct20};
+
+// constant-initialized with the baseline kernels, thus, they are valid even
+// if used during the static initialization of other translation units
+simd::Kernels20 cmaple::simd::kernels20 = {
+    &sse42::dotProduct20, &sse42::dotProduct20, &sse42::matrixVectorProduct20};
+
+namespace {
+// pick the best kernels for the CPU when the binary is loaded
+const bool kernels20_picked = []() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    simd::kernels20 = simd::kernels20_avx2;
+  }
+  return true;
+}();
+}  // namespace
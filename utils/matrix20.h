@@ -0,0 +1,153 @@
+#pragma once
+//
+// The hand-vectorised 20-state (AA) kernels of matrix.h. They are defined in
+// the namespace cmaple::CMAPLE_SIMD_ISA, which the includer defines: with the
+// runtime dispatch of the SIMD kernels (CMAPLE_SIMD_DISPATCH), each
+// matrix20_<isa>.cpp compiles them with the -m flags of its ISA level (thus,
+// SIMDe maps the AVX intrinsics to AVX instructions instead of emulating them
+// with SSE), otherwise, matrix.h includes them (inline) directly.
+//
+
+#include <simde/x86/sse2.h>
+#include <simde/x86/sse4.1.h>
+#include <simde/x86/avx.h>
+
+#ifndef CMAPLE_SIMD_ISA
+#error "CMAPLE_SIMD_ISA must be defined before including matrix20.h"
+#endif
+
+namespace cmaple {
+namespace CMAPLE_SIMD_ISA {
+
+// Multiply 4 floats by another 4 floats.
+// inspired by https://stackoverflow.com/a/59495197
+template<int offsetRegs>
+inline simde__m128 mul4(const float* p1, const float* p2)
+{
+  constexpr int lanes = offsetRegs * 4;
+  const simde__m128 a = simde_mm_loadu_ps(p1 + lanes);
+  const simde__m128 b = simde_mm_loadu_ps(p2 + lanes);
+  return simde_mm_mul_ps(a, b);
+}
+
+// Multiply 4 doubles by another 4 doubles.
+template<int offsetRegs>
+inline simde__m256d mul4(const double* p1, const double* p2)
+{
+  constexpr int lanes = offsetRegs * 4;
+  const simde__m256d a = simde_mm256_loadu_pd(p1 + lanes);
+  const simde__m256d b = simde_mm256_loadu_pd(p2 + lanes);
+  return simde_mm256_mul_pd(a, b);
+}
+
+// sum up 4 floats (SSE)
+// see https://stackoverflow.com/a/59495197
+inline float horiz_sum(simde__m128 v) {
+  // Add 4 values into 2
+  const simde__m128 r2 = simde_mm_add_ps(v, simde_mm_movehl_ps(v, v));
+  // Add 2 lower values into the final result
+  const simde__m128 r1 = simde_mm_add_ss(r2, simde_mm_movehdup_ps(r2));
+  // Return the lowest lane of the result vector.
+  // The intrinsic below compiles into noop, modern compilers return floats in the lowest lane of xmm0 register.
+  return simde_mm_cvtss_f32(r1);
+}
+
+// sum up 4 doubles (AVX)
+// see https://stackoverflow.com/a/49943540
+inline double horiz_sum(simde__m256d v) {
+  simde__m128d vlow = simde_mm256_castpd256_pd128(v);
+  simde__m128d vhigh = simde_mm256_extractf128_pd(v, 1); // high 128
+  vlow = simde_mm_add_pd(vlow, vhigh);     // reduce down to 128
+
+  simde__m128d high64 = simde_mm_unpackhi_pd(vlow, vlow);
+  return  simde_mm_cvtsd_f64(simde_mm_add_sd(vlow, high64));  // reduce to scalar
+}
+
+// Compute dot product of two vectors of 20 floats
+inline float dotProduct20(const float* p1, const float* p2)
+{
+  // Process all 20 values. Nothing to add yet, just multiplying.
+  auto dot0 = mul4<0>(p1, p2);
+  auto dot1 = mul4<1>(p1, p2);
+  auto dot2 = mul4<2>(p1, p2);
+  auto dot3 = mul4<3>(p1, p2);
+  auto dot4 = mul4<4>(p1, p2);
+
+  // 20 to 4
+  const auto dot01 = simde_mm_add_ps(dot0, dot1);
+  const auto dot23 = simde_mm_add_ps(dot2, dot3);
+  const auto dot401 = simde_mm_add_ps(dot4, dot01);
+  const auto dot23401 = simde_mm_add_ps(dot23, dot401);
+
+  return horiz_sum(dot23401);
+}
+
+// Compute dot product of two vectors of 20 doubles
+inline double dotProduct20(const double* p1, const double* p2)
+{
+  // Process all 20 values. Nothing to add yet, just multiplying.
+  auto dot0 = mul4<0>(p1, p2);
+  auto dot1 = mul4<1>(p1, p2);
+  auto dot2 = mul4<2>(p1, p2);
+  auto dot3 = mul4<3>(p1, p2);
+  auto dot4 = mul4<4>(p1, p2);
+
+  // 20 to 4
+  const auto dot01 = simde_mm256_add_pd(dot0, dot1);
+  const auto dot23 = simde_mm256_add_pd(dot2, dot3);
+  const auto dot401 = simde_mm256_add_pd(dot4, dot01);
+  const auto dot23401 = simde_mm256_add_pd(dot23, dot401);
+
+  return horiz_sum(dot23401);
+}
+
+// Multiply a row of 20 doubles by a vector (v[0..4]) into 4 partial sums (in
+// the same order as dotProduct20())
+inline void mulRow20(const double* row, const simde__m256d* v,
+                     simde__m256d& sum)
+{
+  const auto dot0 = simde_mm256_mul_pd(simde_mm256_loadu_pd(row), v[0]);
+  const auto dot1 = simde_mm256_mul_pd(simde_mm256_loadu_pd(row + 4), v[1]);
+  const auto dot2 = simde_mm256_mul_pd(simde_mm256_loadu_pd(row + 8), v[2]);
+  const auto dot3 = simde_mm256_mul_pd(simde_mm256_loadu_pd(row + 12), v[3]);
+  const auto dot4 = simde_mm256_mul_pd(simde_mm256_loadu_pd(row + 16), v[4]);
+
+  const auto dot01 = simde_mm256_add_pd(dot0, dot1);
+  const auto dot23 = simde_mm256_add_pd(dot2, dot3);
+  const auto dot401 = simde_mm256_add_pd(dot4, dot01);
+  sum = simde_mm256_add_pd(dot23, dot401);
+}
+
+// The product of a (row-major) 20 x 20 matrix and a vector: the vector is
+// loaded once, and the partial sums of 4 rows are reduced together (instead
+// of one horizontal sum per row). Each entry gets the same sums (in the same
+// order) as with dotProduct20()
+inline void matrixVectorProduct20(const double* mat, const double* vec,
+                                  double* const result)
+{
+  const simde__m256d v[5] = {
+      simde_mm256_loadu_pd(vec), simde_mm256_loadu_pd(vec + 4),
+      simde_mm256_loadu_pd(vec + 8), simde_mm256_loadu_pd(vec + 12),
+      simde_mm256_loadu_pd(vec + 16)};
+
+  for (int i = 0; i < 20; i += 4, mat += 80)
+  {
+    simde__m256d a, b, c, d;
+    mulRow20(mat, v, a);
+    mulRow20(mat + 20, v, b);
+    mulRow20(mat + 40, v, c);
+    mulRow20(mat + 60, v, d);
+
+    // (a0 + a2, a1 + a3, c0 + c2, c1 + c3) and the same for b, d
+    const auto ac = simde_mm256_add_pd(simde_mm256_permute2f128_pd(a, c, 0x20),
+                                       simde_mm256_permute2f128_pd(a, c, 0x31));
+    const auto bd = simde_mm256_add_pd(simde_mm256_permute2f128_pd(b, d, 0x20),
+                                       simde_mm256_permute2f128_pd(b, d, 0x31));
+
+    // ((a0 + a2) + (a1 + a3), (b0 + b2) + (b1 + b3), ...)
+    simde_mm256_storeu_pd(result + i, simde_mm256_hadd_pd(ac, bd));
+  }
+}
+
+}  // namespace CMAPLE_SIMD_ISA
+}  // namespace cmaple
@@ -0,0 +1,10 @@
+// The 20-state kernels of matrix20.h for the AVX2 ISA level (this file is
+// compiled with -mavx2, see utils/CMakeLists.txt; with CMAPLE_SIMD_DISPATCH
+// only). They only use 256-bit vectors, thus, AVX-512 CPUs use them too.
+#define CMAPLE_SIMD_ISA avx2
+#include "matrix20.h"
+#include "kernels20.h"
+
+const cmaple::simd::Kernels20 cmaple::simd::kernels20_avx2 = {
+    &cmaple::avx2::dotProduct20, &cmaple::avx2::dotProduct20,
+    &cmaple::avx2::matrixVectorProduct20};
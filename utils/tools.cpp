@@ -207,6 +207,32 @@ auto cmaple::copyFile(const char SRC[], const char DEST[]) -> bool {
   return true;  // file copied successfully
 }
 
+void cmaple::writeFileAtomically(
+    const std::string& filename,
+    const std::function<void(std::ostream&)>& write_func,
+    const bool binary) {
+  // write to a temporary file
+  const std::string tmp_filename = filename + ".tmp";
+  std::ofstream out;
+  try {
+    out.exceptions(ios::failbit | ios::badbit);
+    out.open(tmp_filename, binary ? (ios::binary | ios::trunc) : ios::trunc);
+    write_func(out);
+    out.close();
+  } catch (ios::failure const& e) {
+    throw ios::failure("Failed to write to " + tmp_filename);
+  }
+
+  // replace the target file
+  if (std::rename(tmp_filename.c_str(), filename.c_str())) {
+    // rename() may fail if the file exists (e.g., on Windows)
+    std::remove(filename.c_str());
+    if (std::rename(tmp_filename.c_str(), filename.c_str())) {
+      throw ios::failure("Failed to write to " + filename);
+    }
+  }
+}
+
 auto cmaple::fileExists(const string& strFilename) -> bool {
   struct stat stFileInfo;
   bool blnReturn;
@@ -574,6 +600,21 @@ cmaple::Params::Params() {
   overwrite_output = false;
   threshold_prob = 1e-8;
   mutation_update_period = 25;
+  placement_batch_size = 1;
+  spr_batch_size = 1;
+  spr_priority = false;
+  spr_early_stop = false;
+  spr_cache = false;
+  batch_blength_opt = false;
+  use_mutation_index = false;
+  group_identical_seqs = true;
+  place_stream_path = "";
+  num_alt_placements = 0;
+  checkpoint_path = "";
+  restore_path = "";
+  search_time_limit = 0;
+  max_spr_evaluations = 0;
+  checkpoint_interval = 0;
   failure_limit_sample = 5;
   failure_limit_subtree = 4;
   failure_limit_subtree_short_search = 1;
@@ -1093,6 +1134,167 @@ void cmaple::parseArg(int argc, char* argv[], Params& params) {
 
         continue;
       }
+      if (strcmp(argv[cnt], "--placement-batch") == 0) {
+        ++cnt;
+        if (cnt >= argc || argv[cnt][0] == '-') {
+          outError("Use --placement-batch <NUMBER>");
+        }
+
+        try {
+          params.placement_batch_size = convert_int(argv[cnt]);
+        } catch (std::invalid_argument e) {
+          outError(e.what());
+        }
+
+        if (params.placement_batch_size <= 0) {
+          outError("<NUMBER> must be positive!");
+        }
+
+        continue;
+      }
+      if (strcmp(argv[cnt], "--spr-batch") == 0) {
+        ++cnt;
+        if (cnt >= argc || argv[cnt][0] == '-') {
+          outError("Use --spr-batch <NUMBER>");
+        }
+
+        try {
+          params.spr_batch_size = convert_int(argv[cnt]);
+        } catch (std::invalid_argument e) {
+          outError(e.what());
+        }
+
+        if (params.spr_batch_size <= 0) {
+          outError("<NUMBER> must be positive!");
+        }
+
+        continue;
+      }
+      if (strcmp(argv[cnt], "--spr-priority") == 0) {
+        params.spr_priority = true;
+        continue;
+      }
+      if (strcmp(argv[cnt], "--spr-early-stop") == 0) {
+        params.spr_priority = true;
+        params.spr_early_stop = true;
+        continue;
+      }
+      if (strcmp(argv[cnt], "--spr-cache") == 0) {
+        params.spr_cache = true;
+        continue;
+      }
+      if (strcmp(argv[cnt], "--blength-batch") == 0) {
+        params.batch_blength_opt = true;
+        continue;
+      }
+      if (strcmp(argv[cnt], "--mutation-index") == 0) {
+        params.use_mutation_index = true;
+        continue;
+      }
+      if (strcmp(argv[cnt], "--no-group-identical") == 0) {
+        params.group_identical_seqs = false;
+        continue;
+      }
+      if (strcmp(argv[cnt], "--place-stream") == 0) {
+        ++cnt;
+        // "-" stands for the standard input
+        if (cnt >= argc ||
+            (argv[cnt][0] == '-' && strcmp(argv[cnt], "-") != 0)) {
+          outError("Use --place-stream <FILE>");
+        }
+
+        params.place_stream_path = argv[cnt];
+
+        continue;
+      }
+      if (strcmp(argv[cnt], "--alt-placements") == 0) {
+        ++cnt;
+        if (cnt >= argc || argv[cnt][0] == '-') {
+          outError("Use --alt-placements <NUMBER>");
+        }
+
+        try {
+          params.num_alt_placements = convert_int(argv[cnt]);
+        } catch (std::invalid_argument e) {
+          outError(e.what());
+        }
+
+        continue;
+      }
+      if (strcmp(argv[cnt], "--checkpoint") == 0) {
+        ++cnt;
+        if (cnt >= argc || argv[cnt][0] == '-') {
+          outError("Use --checkpoint <FILE>");
+        }
+
+        params.checkpoint_path = argv[cnt];
+
+        continue;
+      }
+      if (strcmp(argv[cnt], "--restore") == 0) {
+        ++cnt;
+        if (cnt >= argc || argv[cnt][0] == '-') {
+          outError("Use --restore <FILE>");
+        }
+
+        params.restore_path = argv[cnt];
+
+        continue;
+      }
+      if (strcmp(argv[cnt], "--time-limit") == 0) {
+        ++cnt;
+        if (cnt >= argc || argv[cnt][0] == '-') {
+          outError("Use --time-limit <SECONDS>");
+        }
+
+        try {
+          params.search_time_limit = convert_real_number(argv[cnt]);
+        } catch (std::invalid_argument e) {
+          outError(e.what());
+        }
+
+        if (params.search_time_limit <= 0) {
+          outError("<SECONDS> must be positive!");
+        }
+
+        continue;
+      }
+      if (strcmp(argv[cnt], "--max-spr-evals") == 0) {
+        ++cnt;
+        if (cnt >= argc || argv[cnt][0] == '-') {
+          outError("Use --max-spr-evals <NUMBER>");
+        }
+
+        try {
+          params.max_spr_evaluations = convert_int64(argv[cnt]);
+        } catch (std::invalid_argument e) {
+          outError(e.what());
+        }
+
+        if (params.max_spr_evaluations <= 0) {
+          outError("<NUMBER> must be positive!");
+        }
+
+        continue;
+      }
+      if (strcmp(argv[cnt], "--checkpoint-interval") == 0) {
+        ++cnt;
+        if (cnt >= argc || argv[cnt][0] == '-') {
+          outError("Use --checkpoint-interval <SECONDS>");
+        }
+
+        try {
+          params.checkpoint_interval = convert_real_number(argv[cnt]);
+        } catch (std::invalid_argument e) {
+          outError(e.what());
+        }
+
+        if (params.checkpoint_interval <= 0) {
+          outError("<SECONDS> must be positive!");
+        }
+
+        continue;
+      }
       if (strcmp(argv[cnt], "--failure-limit") == 0 ||
           strcmp(argv[cnt], "-fail-limit") == 0) {
         ++cnt;
@@ -1414,6 +1616,17 @@ void cmaple::parseArg(int argc, char* argv[], Params& params) {
                 "if SPRTA is not computed. Please use "
                 "`--sprta` if you want to compute SPRTA.");
   }
+  if ((params.search_time_limit > 0 || params.max_spr_evaluations > 0)
+      && params.compute_SPRTA)
+  {
+      outError("Unable to compute SPRTA if the tree search may be stopped "
+                "early by `--time-limit` or `--max-spr-evals`.");
+  }
+  if (params.checkpoint_interval > 0 && !params.checkpoint_path.length())
+  {
+      outError("Unable to save the current tree periodically without a "
+                "checkpoint file. Please use `--checkpoint <FILE>`.");
+  }
   if(params.rate_variation && params.site_specific_rate_matrix) {
       outError("Unable to use rate-variation and site-specific rate matrices.\n"
                 "Please choose either:\n\t \"--rate-variation\" for a rate multiplier at each genomic site, or \n"
@@ -1505,6 +1718,65 @@ void cmaple::usage_cmaple() {
       << "  --mut-update <NUM>   Set the period to update the substitution "
          "rates."
       << endl
+      << "  --placement-batch <NUM> Seek placements for <NUM> samples at a"
+      << endl
+      << "                       time (in parallel with `-nt`). Default: 1."
+      << endl
+      << "  --spr-batch <NUM>    Seek SPR moves for <NUM> nodes at a time"
+      << endl
+      << "                       (in parallel with `-nt`). Default: 1." << endl
+      << "  --spr-priority       Seek SPR moves at the nodes with the highest"
+      << endl
+      << "                       expected improvements first." << endl
+      << "  --spr-early-stop     Like `--spr-priority`, but stop each round"
+      << endl
+      << "                       once the projected improvement is small."
+      << endl
+      << "  --spr-cache          Reuse the SPR moves found in previous rounds"
+      << endl
+      << "                       if their neighborhoods are unchanged." << endl
+      << "  --blength-batch      Estimate all branch lengths at a time (in"
+      << endl
+      << "                       parallel with `-nt`), then apply them." << endl
+      << "  --mutation-index     Restrict the search for sample placements to"
+      << endl
+      << "                       the regions around the nodes sharing the most"
+      << endl
+      << "                       mutations with the samples (a heuristic:"
+      << endl
+      << "                       the placements may rarely differ)." << endl
+      << "  --no-group-identical Place identical sequences one by one instead"
+      << endl
+      << "                       of only placing the first one of them." << endl
+      << "  --place-stream <FILE> Place new samples (MAPLE format, without"
+      << endl
+      << "                       the reference) read one by one from <FILE>"
+      << endl
+      << "                       (`-` for stdin) on the tree without changing"
+      << endl
+      << "                       it. The tree is not inferred if it is given"
+      << endl
+      << "                       by `-t` or `--restore`." << endl
+      << "  --alt-placements <NUM> Output up to <NUM> alternative placements"
+      << endl
+      << "                       for each sample with `--place-stream`." << endl
+      << "  --checkpoint <FILE>  Save the tree (with its partial likelihoods)"
+      << endl
+      << "                       and the model to <FILE> after the placement."
+      << endl
+      << "  --restore <FILE>     Restore the tree and the model from a" << endl
+      << "                       checkpoint instead of placing the samples."
+      << endl
+      << "  --time-limit <SECONDS> Stop the tree search after <SECONDS>."
+      << endl
+      << "  --max-spr-evals <NUM> Stop the tree search after seeking SPR"
+      << endl
+      << "                       moves for <NUM> nodes." << endl
+      << "  --checkpoint-interval <SECONDS> Save the current tree (and a"
+      << endl
+      << "                       checkpoint) every <SECONDS> during the tree"
+      << endl
+      << "                       search. Requires `--checkpoint`." << endl
       << "  --max-subs <NUM>     Specify the maximum #substitutions per site" << endl
       << "                       that CMAPLE is effective. Default: 0.067."
       << endl
@@ -1529,7 +1801,9 @@ void cmaple::usage_cmaple() {
       << "                       branch supports (aLRT-SH)." << endl
       << "  -nt <NUM_THREADS>    Set the number of threads for computing"
       << endl
-      << "                       branch supports. Use `-nt AUTO` " << endl
+      << "                       branch supports and placing samples in"
+      << endl
+      << "                       batches. Use `-nt AUTO` " << endl
       << "                       to employ all available CPU cores." << endl
       << endl
       << "ASSESSING SPRTA BRANCH SUPPORTS:" << endl
@@ -35,6 +35,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -198,6 +199,18 @@ typedef int32_t LengthTypeLarge;
  */
 typedef double RealNumType;
 
+/**
+    Type of the partial likelihoods (and the lengths) stored in the regions of
+    sequences: float when built with USE_FLOAT_LH=ON (to halve their memory),
+    otherwise, RealNumType. Log-likelihoods are always accumulated in
+    RealNumType
+ */
+#ifdef CMAPLE_FLOAT_LH
+typedef float LhNumType;
+#else
+typedef RealNumType LhNumType;
+#endif
+
 /**
     vector of real number number
  */
@@ -543,6 +556,108 @@ class Params {
    */
   PositionType mutation_update_period;
 
+  /**
+   * The number of samples whose placements are sought concurrently (against
+   * the same tree) before being added to the tree. Default: 1 (i.e., place
+   * samples one by one)
+   */
+  PositionType placement_batch_size;
+
+  /**
+   * The number of (outdated) nodes whose SPR moves are sought concurrently
+   * (against the same tree) during the tree search, before being applied one
+   * by one. Default: 1 (i.e., seek SPR moves node by node)
+   */
+  PositionType spr_batch_size;
+
+  /**
+   * TRUE to seek SPR moves of the outdated nodes in the order of their
+   * expected improvements (see Tree::improveEntireTreeByPriority()) instead of
+   * the DFS order (not used when computing SPRTA). Default: FALSE
+   */
+  bool spr_priority;
+
+  /**
+   * TRUE to stop a round of SPR moves (sought in the order of the expected
+   * improvements) once the projected improvement of the remaining nodes drops
+   * below thresh_entire_tree_improvement. Default: FALSE
+   */
+  bool spr_early_stop;
+
+  /**
+   * TRUE to reuse the subtree placement found for a node in a previous SPR
+   * round if the likelihoods in the region it explored have not changed since
+   * then (not used when computing SPRTA). Default: FALSE
+   */
+  bool spr_cache;
+
+  /**
+   * TRUE to estimate the lengths of all branches concurrently (from the same
+   * likelihoods) before applying them, in each round of branch length
+   * optimization (see Tree::optimizeBranchIterInBatch()). Default: FALSE
+   */
+  bool batch_blength_opt;
+
+  /**
+   * TRUE to restrict the search for the placement of a sample to the regions
+   * around the nodes that share the most mutations with that sample (found by
+   * an inverted index from mutations to nodes). Default: FALSE
+   */
+  bool use_mutation_index;
+
+  /**
+   * TRUE to place only one sequence from each group of identical sequences;
+   * the others are added as less-informative sequences of its leaf.
+   * Default: TRUE
+   */
+  bool group_identical_seqs;
+
+  /**
+   * Name of a file (or a pipe; "-" for the standard input) of new samples (in
+   * MAPLE format, without the reference sequence) to be placed, one by one,
+   * on the final tree without changing it. If the tree is given (by an input
+   * tree or a checkpoint), it is not inferred. Default: "" (none)
+   */
+  std::string place_stream_path;
+
+  /**
+   * The maximum number of alternative placements to output for each sample
+   * read from place_stream_path. Default: 0
+   */
+  int num_alt_placements;
+
+  /**
+   * Name of a binary checkpoint file, to which the tree (with all partial
+   * likelihoods) and the model are saved after the placement, so that the
+   * tree search could be resumed from it. Default: "" (none)
+   */
+  std::string checkpoint_path;
+
+  /**
+   * Name of a binary checkpoint file, from which the tree and the model are
+   * restored (instead of placing the samples). Default: "" (none)
+   */
+  std::string restore_path;
+
+  /**
+   * The maximum wall-clock time (in seconds) of the tree search (i.e., the
+   * SPR rounds after the placement). Default: 0 (unlimited)
+   */
+  RealNumType search_time_limit;
+
+  /**
+   * The maximum number of nodes whose SPR moves are evaluated during the tree
+   * search. Default: 0 (unlimited)
+   */
+  int64_t max_spr_evaluations;
+
+  /**
+   * The interval (in seconds) to save the current tree to checkpoint_path
+   * during the tree search. Default: 0 (only save it when the tree search is
+   * stopped by search_time_limit or max_spr_evaluations)
+   */
+  RealNumType checkpoint_interval;
+
   /**
   *  Name of the output alignment
   */
@@ -1001,6 +1116,18 @@ bool copyFile(const char SRC[], const char DEST[]);
  */
 bool fileExists(const std::string& strFilename);
 
+/**
+ * Write a file atomically, i.e., write to a temporary file, then rename it to
+ * the target file, thus, the target file is never left partially written
+ * @param filename the target file
+ * @param write_func the function writing the content to a stream
+ * @param binary TRUE to open the file in binary mode
+ * @throw ios::failure if the file cannot be written
+ */
+void writeFileAtomically(const std::string& filename,
+                         const std::function<void(std::ostream&)>& write_func,
+                         const bool binary = false);
+
 /**
     Check that path is a directory
  */
@@ -1109,7 +1236,8 @@ void normalize_frequencies_from_index(RealNumType* freqs,
     @param num_entries the number of entries
     @param sum_entries Precomputed sum of all original state frequencies
  */
-inline void normalize_arr(RealNumType* const entries,
+template <typename T>
+inline void normalize_arr(T* const entries,
                           const int num_entries,
                           RealNumType sum_entries) {
   assert(num_entries > 0);
@@ -1130,7 +1258,8 @@ inline void normalize_arr(RealNumType* const entries,
     @param entries original entries
     @param num_entries the number of entries
  */
-inline void normalize_arr(RealNumType* const entries, const int num_entries) {
+template <typename T>
+inline void normalize_arr(T* const entries, const int num_entries) {
   RealNumType sum_entries = 0;
   for (int i = 0; i < num_entries; ++i)
     sum_entries += entries[i];